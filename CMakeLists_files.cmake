@@ -43,8 +43,14 @@ list (APPEND MAIN_SOURCE_FILES
 # originally generated with the command:
 # find tests -name '*.cpp' -a ! -wholename '*/not-unit/*' -printf '\t%p\n' | sort
 list (APPEND TEST_SOURCE_FILES
+	tests/common/blackoil_equilibration_test.cpp
+	tests/common/blackoil_equilibrium_test.cpp
+	tests/common/blackoil_transport_test.cpp
 	tests/common/boundaryconditions_test.cpp
 	tests/common/matrix_test.cpp
+	tests/common/metrics_test.cpp
+	tests/common/nonlineartrace_test.cpp
+	tests/common/uniformtablebilinear_test.cpp
 	)
 
 # originally generated with the command:
@@ -57,13 +63,18 @@ list (APPEND TEST_DATA_FILES
 list (APPEND EXAMPLE_SOURCE_FILES
 	examples/aniso_implicitcap_test.cpp
 	examples/aniso_simulator_test.cpp
+	examples/blackoil_pvt_benchmark.cpp
+	examples/blackoil_upwind_benchmark.cpp
+	examples/blackoil_wells_benchmark.cpp
 	examples/co2_blackoil_pvt.cpp
 	examples/implicitcap_test.cpp
 	examples/known_answer_test.cpp
 	examples/mimetic_aniso_solver_test.cpp
 	examples/mimetic_periodic_test.cpp
 	examples/mimetic_solver_test.cpp
+	examples/sim_blackoil_ensemble.cpp
 	examples/sim_blackoil_impes.cpp
+	examples/sim_blackoil_implicit.cpp
 	examples/sim_co2_impes.cpp
 	examples/sim_steadystate_explicit.cpp
 	examples/sim_steadystate_implicit.cpp
@@ -83,13 +94,16 @@ list (APPEND ATTIC_FILES
 # programs listed here will not only be compiled, but also marked for
 # installation
 list (APPEND PROGRAM_SOURCE_FILES
+	examples/sim_blackoil_ensemble.cpp
 	examples/sim_blackoil_impes.cpp
+	examples/sim_blackoil_implicit.cpp
 	examples/sim_co2_impes.cpp
 	)
 
 # originally generated with the command:
 # find opm -name '*.h*' -a ! -name '*-pch.hpp' -a ! -wholename '*/twophase2/*' -printf '\t%p\n' | sort
 list (APPEND PUBLIC_HEADER_FILES
+	opm/porsol/blackoil/BlackoilEnsemble.hpp
 	opm/porsol/blackoil/BlackoilFluid.hpp
 	opm/porsol/blackoil/BlackoilInitialization.hpp
 	opm/porsol/blackoil/BlackoilSimulator.hpp
@@ -107,16 +121,23 @@ list (APPEND PUBLIC_HEADER_FILES
 	opm/porsol/blackoil/fluid/MiscibilityLiveOil.hpp
 	opm/porsol/blackoil/fluid/MiscibilityProps.hpp
 	opm/porsol/blackoil/fluid/MiscibilityWater.hpp
+	opm/porsol/blackoil/ImplicitCompositionalTransport.hpp
+	opm/porsol/blackoil/TimeStepControl.hpp
+	opm/porsol/common/AsyncOutputWriter.hpp
 	opm/porsol/common/BCRSMatrixBlockAssembler.hpp
 	opm/porsol/common/blas_lapack.hpp
 	opm/porsol/common/BoundaryConditions.hpp
 	opm/porsol/common/BoundaryPeriodicity.hpp
+	opm/porsol/common/FieldArena.hpp
 	opm/porsol/common/fortran.hpp
 	opm/porsol/common/GridInterfaceEuler.hpp
 	opm/porsol/common/ImplicitTransportDefs.hpp
 	opm/porsol/common/Matrix.hpp
 	opm/porsol/common/MatrixInverse.hpp
+	opm/porsol/common/Metrics.hpp
+	opm/porsol/common/NonlinearTrace.hpp
 	opm/porsol/common/PeriodicHelpers.hpp
+	opm/porsol/common/PersistentLinearSolverIstl.hpp
 	opm/porsol/common/ReservoirPropertyCapillaryAnisotropicRelperm.hpp
 	opm/porsol/common/ReservoirPropertyCapillaryAnisotropicRelperm_impl.hpp
 	opm/porsol/common/ReservoirPropertyCapillary.hpp
@@ -134,6 +155,7 @@ list (APPEND PUBLIC_HEADER_FILES
 	opm/porsol/common/SimulatorBase.hpp
 	opm/porsol/common/SimulatorTraits.hpp
 	opm/porsol/common/SimulatorUtilities.hpp
+	opm/porsol/common/UniformTableBilinear.hpp
 	opm/porsol/common/Wells.hpp
 	opm/porsol/euler/CflCalculator.hpp
 	opm/porsol/euler/EulerUpstream.hpp
@@ -0,0 +1,153 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "config.h"
+
+#include <opm/porsol/blackoil/fluid/BlackoilPVT.hpp>
+#include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <opm/core/utility/StopWatch.hpp>
+#include <opm/core/utility/Units.hpp>
+#include <opm/parser/eclipse/Parser/Parser.hpp>
+#include <opm/parser/eclipse/Parser/ParseContext.hpp>
+#include <opm/parser/eclipse/Deck/Deck.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Micro-benchmark of the black-oil PVT evaluation: the separate
+// dBdp(), dRdp() and getViscosity() passes against the fused
+// BlackoilPVT::evalAll() engine, on the same random states, and
+// finally the fused engine on uniformly resampled tables.
+//
+// Example:
+//   blackoil_pvt_benchmark filename=SPE9.DATA num_cells=1000000 repeats=5
+
+typedef Opm::BlackoilPVT::PhaseVec PhaseVec;
+typedef Opm::BlackoilPVT::CompVec CompVec;
+
+namespace
+{
+    double maxRelDiff(const std::vector<PhaseVec>& a, const std::vector<PhaseVec>& b)
+    {
+        double md = 0.0;
+        for (size_t i = 0; i < a.size(); ++i) {
+            for (int phase = 0; phase < Opm::BlackoilPVT::numPhases; ++phase) {
+                double scale = std::max(std::fabs(a[i][phase]), 1e-20);
+                md = std::max(md, std::fabs(a[i][phase] - b[i][phase])/scale);
+            }
+        }
+        return md;
+    }
+}
+
+
+int main(int argc, char** argv)
+try
+{
+    Opm::parameter::ParameterGroup param(argc, argv);
+    Opm::ParseContext parseContext;
+    Opm::ParserPtr parser(new Opm::Parser());
+    Opm::DeckConstPtr deck = parser->parseFile(param.get<std::string>("filename"), parseContext);
+    Opm::BlackoilPVT pvt;
+    pvt.init(deck);
+
+    const int num_cells = param.getDefault("num_cells", 1000000);
+    const int repeats = param.getDefault("repeats", 5);
+    const double pmin = Opm::unit::convert::from(param.getDefault("pmin_bar", 50.0), Opm::unit::barsa);
+    const double pmax = Opm::unit::convert::from(param.getDefault("pmax_bar", 400.0), Opm::unit::barsa);
+    const double max_gor = param.getDefault("max_gas_oil_ratio", 200.0);
+
+    // Random but reproducible states.
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    std::vector<PhaseVec> p(num_cells);
+    std::vector<CompVec> z(num_cells);
+    for (int i = 0; i < num_cells; ++i) {
+        p[i] = pmin + (pmax - pmin)*unif(gen);
+        z[i][Opm::BlackoilPVT::Water] = 0.3*unif(gen);
+        z[i][Opm::BlackoilPVT::Oil] = 0.1 + 0.9*unif(gen);
+        z[i][Opm::BlackoilPVT::Gas] = max_gor*unif(gen)*z[i][Opm::BlackoilPVT::Oil];
+    }
+
+    std::vector<PhaseVec> B, dB, R, dR, mu;
+    std::vector<PhaseVec> fB, fdB, fR, fdR, fmu;
+
+    // Warm up (and size) all outputs.
+    pvt.dBdp(p, z, B, dB);
+    pvt.dRdp(p, z, R, dR);
+    pvt.getViscosity(p, z, mu);
+    pvt.evalAll(p, z, fB, fdB, fR, fdR, fmu);
+
+    Opm::time::StopWatch clock;
+    clock.start();
+    for (int rep = 0; rep < repeats; ++rep) {
+        pvt.dBdp(p, z, B, dB);
+        pvt.dRdp(p, z, R, dR);
+        pvt.getViscosity(p, z, mu);
+    }
+    clock.stop();
+    const double separate_time = clock.secsSinceStart()/repeats;
+
+    clock.start();
+    for (int rep = 0; rep < repeats; ++rep) {
+        pvt.evalAll(p, z, fB, fdB, fR, fdR, fmu);
+    }
+    clock.stop();
+    const double fused_time = clock.secsSinceStart()/repeats;
+
+    std::cout << "Cells:                 " << num_cells << '\n'
+              << "Separate passes (secs): " << separate_time << '\n'
+              << "Fused pass (secs):      " << fused_time << '\n'
+              << "Speedup:               " << separate_time/fused_time << '\n'
+              << "Max relative difference (B, dB, R, dR, mu): "
+              << maxRelDiff(B, fB) << ' ' << maxRelDiff(dB, fdB) << ' '
+              << maxRelDiff(R, fR) << ' ' << maxRelDiff(dR, fdR) << ' '
+              << maxRelDiff(mu, fmu) << std::endl;
+
+    if (param.getDefault("tabulate", true)) {
+        // Same fused pass, on uniformly resampled tables.
+        const int pressure_samples = param.getDefault("pvt_pressure_samples", 1025);
+        const int ratio_samples = param.getDefault("pvt_ratio_samples", 257);
+        const double reported_err = pvt.tabulate(pressure_samples, ratio_samples);
+        std::vector<PhaseVec> tB, tdB, tR, tdR, tmu;
+        pvt.evalAll(p, z, tB, tdB, tR, tdR, tmu);
+        clock.start();
+        for (int rep = 0; rep < repeats; ++rep) {
+            pvt.evalAll(p, z, tB, tdB, tR, tdR, tmu);
+        }
+        clock.stop();
+        const double tabulated_time = clock.secsSinceStart()/repeats;
+        std::cout << "Tabulated fused pass (secs): " << tabulated_time << '\n'
+                  << "Speedup over separate:       " << separate_time/tabulated_time << '\n'
+                  << "Reported table deviation:    " << reported_err << '\n'
+                  << "Max relative difference (B, R, mu): "
+                  << maxRelDiff(B, tB) << ' ' << maxRelDiff(R, tR) << ' '
+                  << maxRelDiff(mu, tmu) << std::endl;
+    }
+}
+catch (const std::exception &e) {
+    std::cerr << "Program threw an exception: " << e.what() << "\n";
+    throw;
+}
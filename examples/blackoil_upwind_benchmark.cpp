@@ -0,0 +1,155 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "config.h"
+
+#include <opm/porsol/blackoil/BlackoilFluid.hpp>
+#include <opm/porsol/common/Rock.hpp>
+
+#include <dune/common/version.hh>
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 3)
+#include <dune/common/parallel/mpihelper.hh>
+#else
+#include <dune/common/mpihelper.hh>
+#endif
+#include <dune/grid/CpGrid.hpp>
+
+#include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <opm/core/utility/StopWatch.hpp>
+#include <opm/core/utility/Units.hpp>
+#include <opm/parser/eclipse/Parser/Parser.hpp>
+#include <opm/parser/eclipse/Parser/ParseContext.hpp>
+#include <opm/parser/eclipse/Deck/Deck.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Thread scaling of AllFluidData::computeUpwindProperties() on a
+// cartesian grid, for 1, 2, 4, ... up to max_threads threads.
+//
+// Example:
+//   blackoil_upwind_benchmark filename=SPE9.DATA nx=100 ny=100 nz=20 max_threads=32
+
+typedef Dune::CpGrid Grid;
+typedef Opm::BlackoilFluid::PhaseVec PhaseVec;
+typedef Opm::BlackoilFluid::CompVec CompVec;
+
+
+int main(int argc, char** argv)
+try
+{
+    Opm::parameter::ParameterGroup param(argc, argv);
+    Dune::MPIHelper::instance(argc, argv);
+
+    Grid grid;
+    std::array<int, 3> dims = {{ param.getDefault<int>("nx", 100),
+                                  param.getDefault<int>("ny", 100),
+                                  param.getDefault<int>("nz", 20) }};
+    std::array<double, 3> cellsz = {{ param.getDefault<double>("dx", 10.0),
+                                       param.getDefault<double>("dy", 10.0),
+                                       param.getDefault<double>("dz", 2.0) }};
+    grid.createCartesian(dims, cellsz);
+    Opm::Rock<Grid::dimension> rock;
+    rock.init(grid.size(0), 0.2, Opm::unit::convert::from(100.0, Opm::prefix::milli*Opm::unit::darcy));
+
+    Opm::ParseContext parseContext;
+    Opm::ParserPtr parser(new Opm::Parser());
+    Opm::DeckConstPtr deck = parser->parseFile(param.get<std::string>("filename"), parseContext);
+    Opm::BlackoilFluid fluid;
+    fluid.init(deck);
+
+    const int repeats = param.getDefault("repeats", 10);
+    const int max_threads = param.getDefault("max_threads", 32);
+    const double p0 = Opm::unit::convert::from(param.getDefault("pressure_bar", 200.0), Opm::unit::barsa);
+
+    // A hydrostatic-like pressure and a gas-oil-water mixture
+    // varying with depth, so that all phases flow both ways.
+    const int num_cells = grid.numCells();
+    const int num_faces = grid.numFaces();
+    Grid::Vector gravity(0.0);
+    gravity[2] = Opm::unit::gravity;
+    std::vector<PhaseVec> cell_pressure(num_cells);
+    std::vector<CompVec> cell_z(num_cells);
+    for (int cell = 0; cell < num_cells; ++cell) {
+        const double depth = grid.cellCentroid(cell)[2];
+        cell_pressure[cell] = p0 + 800.0*Opm::unit::gravity*depth;
+        const double w = double(cell % 7)/7.0;
+        cell_z[cell][Opm::BlackoilFluid::Water] = 0.1 + 0.2*w;
+        cell_z[cell][Opm::BlackoilFluid::Oil] = 0.7 - 0.2*w;
+        cell_z[cell][Opm::BlackoilFluid::Gas] = 50.0 + 100.0*w;
+    }
+    std::vector<PhaseVec> face_pressure(num_faces);
+    for (int face = 0; face < num_faces; ++face) {
+        const int c0 = grid.faceCell(face, 0);
+        const int c1 = grid.faceCell(face, 1);
+        if (c0 >= 0 && c1 >= 0) {
+            face_pressure[face] = cell_pressure[c0];
+            face_pressure[face] += cell_pressure[c1];
+            face_pressure[face] *= 0.5;
+        } else {
+            face_pressure[face] = cell_pressure[c0 >= 0 ? c0 : c1];
+        }
+    }
+    CompVec bdy_z(0.0);
+    bdy_z[Opm::BlackoilFluid::Water] = 1.0;
+
+    Opm::AllFluidData data;
+    data.computeNew(grid, rock, fluid, gravity, cell_pressure, face_pressure,
+                    cell_z, bdy_z, Opm::unit::day);
+
+    std::cout << "Cells: " << num_cells << "  Faces: " << num_faces << '\n'
+              << "Threads    Time (secs)    Speedup    Efficiency" << std::endl;
+    double serial_time = 0.0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+#ifdef _OPENMP
+        omp_set_num_threads(threads);
+#else
+        if (threads > 1) {
+            std::cout << "Built without OpenMP, stopping." << std::endl;
+            break;
+        }
+#endif
+        // Warm up, also builds the face geometry cache.
+        data.computeUpwindProperties(grid, fluid, gravity, cell_pressure, face_pressure, cell_z, bdy_z);
+        Opm::time::StopWatch clock;
+        clock.start();
+        for (int rep = 0; rep < repeats; ++rep) {
+            data.computeUpwindProperties(grid, fluid, gravity, cell_pressure, face_pressure, cell_z, bdy_z);
+        }
+        clock.stop();
+        const double secs = clock.secsSinceStart()/repeats;
+        if (threads == 1) {
+            serial_time = secs;
+        }
+        std::cout << threads << "    " << secs << "    " << serial_time/secs
+                  << "    " << serial_time/(secs*threads) << std::endl;
+    }
+}
+catch (const std::exception &e) {
+    std::cerr << "Program threw an exception: " << e.what() << "\n";
+    throw;
+}
@@ -0,0 +1,141 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "config.h"
+
+#include <opm/porsol/blackoil/BlackoilWells.hpp>
+#include <opm/porsol/common/Rock.hpp>
+
+#include <dune/common/version.hh>
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 3)
+#include <dune/common/parallel/mpihelper.hh>
+#else
+#include <dune/common/mpihelper.hh>
+#endif
+#include <dune/grid/CpGrid.hpp>
+
+#include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <opm/core/utility/StopWatch.hpp>
+#include <opm/core/utility/Units.hpp>
+#include <opm/parser/eclipse/Parser/Parser.hpp>
+#include <opm/parser/eclipse/Parser/ParseContext.hpp>
+#include <opm/parser/eclipse/Deck/Deck.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <array>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Startup cost of BlackoilWells::init() on a synthetic deck with
+// num_wells vertical producers on a cartesian grid, each completed
+// in every layer by one COMPDAT record per layer. Well indices are
+// computed from the Peaceman model (CF given as 0).
+//
+// Example:
+//   blackoil_wells_benchmark nx=500 ny=500 nz=40 num_wells=2000
+
+typedef Dune::CpGrid Grid;
+
+
+int main(int argc, char** argv)
+try
+{
+    Opm::parameter::ParameterGroup param(argc, argv);
+    Dune::MPIHelper::instance(argc, argv);
+
+    Grid grid;
+    std::array<int, 3> dims = {{ param.getDefault<int>("nx", 200),
+                                  param.getDefault<int>("ny", 200),
+                                  param.getDefault<int>("nz", 20) }};
+    std::array<double, 3> cellsz = {{ param.getDefault<double>("dx", 10.0),
+                                       param.getDefault<double>("dy", 10.0),
+                                       param.getDefault<double>("dz", 2.0) }};
+    Opm::time::StopWatch clock;
+    clock.start();
+    grid.createCartesian(dims, cellsz);
+    Opm::Rock<Grid::dimension> rock;
+    rock.init(grid.size(0), 0.2, Opm::unit::convert::from(100.0, Opm::prefix::milli*Opm::unit::darcy));
+    clock.stop();
+    const double grid_time = clock.secsSinceStart();
+
+    // Wells spread evenly over the areal grid.
+    const int num_wells = param.getDefault("num_wells", 1000);
+    const int num_columns = dims[0]*dims[1];
+    if (num_wells < 1 || num_wells > num_columns) {
+        OPM_THROW(std::runtime_error, "Need 1 <= num_wells <= nx*ny.");
+    }
+    std::ostringstream deckstr;
+    deckstr << "WELSPECS\n";
+    for (int w = 0; w < num_wells; ++w) {
+        const int column = int((double(w) + 0.5)*num_columns/num_wells);
+        deckstr << "'P" << w << "' 'G' " << column % dims[0] + 1 << ' ' << column / dims[0] + 1
+                << " 0.0 'OIL' /\n";
+    }
+    deckstr << "/\nCOMPDAT\n";
+    for (int w = 0; w < num_wells; ++w) {
+        const int column = int((double(w) + 0.5)*num_columns/num_wells);
+        for (int k = 1; k <= dims[2]; ++k) {
+            deckstr << "'P" << w << "' " << column % dims[0] + 1 << ' ' << column / dims[0] + 1
+                    << ' ' << k << ' ' << k << " 'OPEN' 0 -1 0.3 /\n";
+        }
+    }
+    deckstr << "/\nWCONPROD\n";
+    for (int w = 0; w < num_wells; ++w) {
+        deckstr << "'P" << w << "' 'OPEN' 'BHP' 5* 100 /\n";
+    }
+    deckstr << "/\n";
+
+    clock.start();
+    Opm::ParseContext parseContext;
+    Opm::ParserPtr parser(new Opm::Parser());
+    Opm::DeckConstPtr deck = parser->parseString(deckstr.str(), parseContext);
+    clock.stop();
+    const double parse_time = clock.secsSinceStart();
+
+    clock.start();
+    Opm::BlackoilWells wells;
+    wells.init(deck, grid, rock);
+    clock.stop();
+    const double init_time = clock.secsSinceStart();
+
+    int num_perfs = 0;
+    for (int w = 0; w < wells.numWells(); ++w) {
+        num_perfs += wells.numPerforations(w);
+    }
+#ifdef _OPENMP
+    const int threads = omp_get_max_threads();
+#else
+    const int threads = 1;
+#endif
+    std::cout << "Cells: " << grid.numCells() << "  Wells: " << wells.numWells()
+              << "  Completions: " << num_perfs << "  Threads: " << threads << '\n'
+              << "Grid setup (secs)          " << grid_time << '\n'
+              << "Deck parsing (secs)        " << parse_time << '\n'
+              << "BlackoilWells::init (secs) " << init_time << std::endl;
+}
+catch (const std::exception &e) {
+    std::cerr << "Program threw an exception: " << e.what() << "\n";
+    throw;
+}
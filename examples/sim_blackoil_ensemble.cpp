@@ -0,0 +1,73 @@
+/*
+  Copyright 2010 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "config.h"
+
+#include <opm/porsol/blackoil/fluid/BlackoilPVT.hpp>
+#include <opm/porsol/blackoil/BlackoilFluid.hpp>
+
+#include <opm/porsol/blackoil/BlackoilSimulator.hpp>
+#include <opm/porsol/blackoil/BlackoilEnsemble.hpp>
+
+#include <dune/common/version.hh>
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 3)
+#include <dune/common/parallel/mpihelper.hh>
+#else
+#include <dune/common/mpihelper.hh>
+#endif
+
+#include <dune/grid/CpGrid.hpp>
+#include <opm/porsol/common/Rock.hpp>
+#include <opm/porsol/mimetic/TpfaCompressible.hpp>
+#include <opm/porsol/blackoil/BlackoilWells.hpp>
+#include <opm/porsol/blackoil/ComponentTransport.hpp>
+
+#include <iostream>
+
+// Runs the realizations listed in realizations_file (or
+// num_realizations copies of the model deck) concurrently in one
+// process, see Opm::BlackoilEnsemble. Example:
+//   sim_blackoil_ensemble fileformat=eclipse filename=BASE.DATA
+//       realizations_file=realizations.txt num_threads=8
+
+typedef Dune::CpGrid Grid;
+typedef Opm::Rock<Grid::dimension> Rock;
+typedef Opm::BlackoilFluid Fluid;
+typedef Opm::BlackoilWells Wells;
+typedef Opm::BasicBoundaryConditions<true, false>  FBC;
+typedef Opm::TpfaCompressible<Grid, Rock, Fluid, Wells, FBC> FlowSolver;
+typedef Opm::ExplicitCompositionalTransport<Grid, Rock, Fluid, Wells> TransportSolver;
+
+
+typedef Opm::BlackoilSimulator<Grid, Rock, Fluid, Wells, FlowSolver, TransportSolver> Simulator;
+
+
+int main(int argc, char** argv)
+try
+{
+    Opm::parameter::ParameterGroup param(argc, argv);
+    Dune::MPIHelper::instance(argc,argv);
+
+    Opm::BlackoilEnsemble<Simulator> ensemble;
+    ensemble.init(param);
+    return ensemble.run() == 0 ? 0 : 1;
+}
+catch (const std::exception &e) {
+    std::cerr << "Program threw an exception: " << e.what() << "\n";
+    throw;
+}
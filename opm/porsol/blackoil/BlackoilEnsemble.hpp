@@ -0,0 +1,208 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_BLACKOILENSEMBLE_HEADER_INCLUDED
+#define OPM_BLACKOILENSEMBLE_HEADER_INCLUDED
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <opm/parser/eclipse/Parser/Parser.hpp>
+#include <opm/parser/eclipse/Parser/ParseContext.hpp>
+#include <opm/parser/eclipse/Deck/Deck.hpp>
+#include <dune/common/exceptions.hh>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Opm
+{
+
+    /// Runs many realizations of the same model concurrently, each in
+    /// its own BlackoilSimulator. The grid, fluid (PVT and relperm
+    /// tables) and deck are set up once and shared read-only, see
+    /// BlackoilSimulator::SharedModel.
+    ///
+    /// Parameters, in addition to those of the simulator:
+    ///   realizations_file        Text file with one deck per line,
+    ///                            giving the rock properties (PORO,
+    ///                            PERMX, ...) and/or the wells of one
+    ///                            realization. A '-' line runs the
+    ///                            model deck as it is.
+    ///   num_realizations         Used if there is no realizations_file,
+    ///                            runs the model deck this many times.
+    ///   num_threads              Realizations run at the same time.
+    ///   threads_per_realization  OpenMP threads of each realization.
+    /// Realization k writes to output_dir/realization-k.
+    template <class Simulator>
+    class BlackoilEnsemble
+    {
+    public:
+        typedef typename Simulator::SharedModel SharedModel;
+        typedef typename Simulator::RealizationInput RealizationInput;
+
+        BlackoilEnsemble()
+            : num_threads_(1), threads_per_realization_(1), param_(0)
+        {
+        }
+
+        void init(const Opm::parameter::ParameterGroup& param)
+        {
+            param_ = &param;
+            model_ = Simulator::createModel(param);
+            if (param.has("realizations_file")) {
+                const std::string filename = param.get<std::string>("realizations_file");
+                std::ifstream is(filename.c_str());
+                if (!is) {
+                    OPM_THROW(std::runtime_error, "Could not open realizations file " << filename);
+                }
+                std::string line;
+                while (std::getline(is, line)) {
+                    std::istringstream ls(line);
+                    std::string deck;
+                    if (ls >> deck) {
+                        deck_files_.push_back(deck == "-" ? std::string() : deck);
+                    }
+                }
+            } else {
+                deck_files_.assign(param.getDefault("num_realizations", 1), std::string());
+            }
+            num_threads_ = param.getDefault("num_threads", int(std::thread::hardware_concurrency()));
+            num_threads_ = std::max(1, std::min(num_threads_, int(deck_files_.size())));
+            threads_per_realization_ = param.getDefault("threads_per_realization", 1);
+            output_dir_ = param.getDefault<std::string>("output_dir", "output");
+        }
+
+        /// Run all realizations, and report the throughput. Returns the
+        /// number of realizations that failed.
+        int run()
+        {
+            const int num = deck_files_.size();
+            next_ = 0;
+            failed_.assign(num, 0);
+            seconds_.assign(num, 0.0);
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            std::vector<std::thread> workers;
+            for (int t = 0; t < num_threads_; ++t) {
+                workers.push_back(std::thread(&BlackoilEnsemble::work, this));
+            }
+            for (int t = 0; t < num_threads_; ++t) {
+                workers[t].join();
+            }
+            const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            int num_failed = 0;
+            double busy = 0.0;
+            for (int k = 0; k < num; ++k) {
+                num_failed += failed_[k];
+                busy += seconds_[k];
+            }
+            std::cout << "\n\nEnsemble: " << num << " realizations (" << num_failed << " failed), "
+                      << num_threads_ << " at a time with " << threads_per_realization_ << " thread(s) each\n"
+                      << "Wall clock time (secs):            " << wall << '\n'
+                      << "Mean time per realization (secs):  " << (num > 0 ? busy/num : 0.0) << '\n'
+                      << "Throughput (realizations/hour):    " << (wall > 0.0 ? 3600.0*(num - num_failed)/wall : 0.0)
+                      << std::endl;
+            return num_failed;
+        }
+
+    private:
+        std::shared_ptr<const SharedModel> model_;
+        std::vector<std::string> deck_files_;
+        int num_threads_;
+        int threads_per_realization_;
+        std::string output_dir_;
+        const Opm::parameter::ParameterGroup* param_;
+
+        std::atomic<int> next_;
+        std::vector<int> failed_;
+        std::vector<double> seconds_;
+        // The parameter group records which parameters are used, and
+        // the deck parser is not known to be thread safe, so
+        // Simulator::init() is serialized.
+        std::mutex init_mutex_;
+        std::mutex cout_mutex_;
+
+        void reportFailure(const int k, const std::string& what)
+        {
+            failed_[k] = 1;
+            std::lock_guard<std::mutex> lock(cout_mutex_);
+            std::cerr << "Realization " << k << " failed: " << what << std::endl;
+        }
+
+        void work()
+        {
+#ifdef _OPENMP
+            omp_set_num_threads(threads_per_realization_);
+#endif
+            const int num = deck_files_.size();
+            for (int k = next_++; k < num; k = next_++) {
+                const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                try {
+                    // Only one simulator per worker is alive at a time,
+                    // so memory use does not grow with the ensemble size.
+                    std::unique_ptr<Simulator> sim(new Simulator);
+                    {
+                        std::lock_guard<std::mutex> lock(init_mutex_);
+                        RealizationInput input;
+                        if (!deck_files_[k].empty()) {
+                            Opm::ParseContext parseContext;
+                            Opm::ParserPtr parser(new Opm::Parser());
+                            input.deck = parser->parseFile(deck_files_[k], parseContext);
+                        }
+                        std::ostringstream dir;
+                        dir << output_dir_ << "/realization-" << k;
+                        input.output_dir = dir.str();
+                        sim->init(*param_, model_, input);
+                    }
+                    sim->simulate();
+                } catch (const std::exception& e) {
+                    reportFailure(k, e.what());
+                } catch (const Dune::Exception& e) {
+                    // Not a std::exception, thrown by ISTL and the grid.
+                    reportFailure(k, e.what());
+                } catch (...) {
+                    // Nothing may escape a worker thread, that would
+                    // terminate the whole ensemble.
+                    reportFailure(k, "unknown exception");
+                }
+                seconds_[k] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                std::lock_guard<std::mutex> lock(cout_mutex_);
+                std::cout << "Realization " << k << (failed_[k] ? " failed after " : " done in ")
+                          << seconds_[k] << " secs" << std::endl;
+            }
+        }
+    };
+
+} // namespace Opm
+
+#endif // OPM_BLACKOILENSEMBLE_HEADER_INCLUDED
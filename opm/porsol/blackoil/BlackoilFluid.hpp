@@ -25,6 +25,8 @@
 #include <opm/porsol/blackoil/fluid/FluidStateBlackoil.hpp>
 #include <opm/porsol/blackoil/fluid/BlackoilPVT.hpp>
 #include <dune/common/fvector.hh>
+#include <algorithm>
+#include <cassert>
 #include <vector>
 
 
@@ -44,6 +46,11 @@ namespace Opm
         typedef FluidStateBlackoil FluidState;
         typedef BlackoilFluidData FluidData;
 
+        BlackoilFluid()
+            : batch_equilibrium_(false)
+        {
+        }
+
         void init(Opm::DeckConstPtr deck)
         {
             fmi_params_.init(deck);
@@ -81,6 +88,21 @@ namespace Opm
             return surface_densities_;
         }
 
+        /// Evaluate PVT properties from uniformly resampled tables,
+        /// see BlackoilPVT::tabulate(). Returns the largest relative
+        /// deviation from the exact tables.
+        double tabulatePvt(int num_pressure_samples, int num_ratio_samples)
+        {
+            return pvt_.tabulate(num_pressure_samples, num_ratio_samples);
+        }
+
+        /// Use the closed-form, blocked kernel computeEquilibriumBlock()
+        /// in computePvtDepending() instead of the per-cell one.
+        void setBatchEquilibrium(bool batch)
+        {
+            batch_equilibrium_ = batch;
+        }
+
         /// \param[in] A state matrix in fortran ordering
         PhaseVec phaseDensities(const double* A) const
         {
@@ -101,12 +123,13 @@ namespace Opm
         template <class States>
         void computeBAndR(States& states) const
         {
-            const std::vector<PhaseVec>& p = states.phase_pressure;
-            const std::vector<CompVec>& z = states.surface_volume_density;
-            std::vector<PhaseVec>& B = states.formation_volume_factor;
-            std::vector<PhaseVec>& R = states.solution_factor;
-            pvt_.B(p, z, B);
-            pvt_.R(p, z, R);
+            int num = states.phase_pressure.size();
+            states.resize(num);
+            PvtBatchOutput output;
+            output.B = states.formation_volume_factor.data();
+            output.R = states.solution_factor.data();
+            pvt_.evalAll(num, states.phase_pressure.data(),
+                         states.surface_volume_density.data(), output);
         }
 
         /// Input: p, z
@@ -114,11 +137,14 @@ namespace Opm
         template <class States>
         void computePvtNoDerivs(States& states) const
         {
-            computeBAndR(states);
-            const std::vector<PhaseVec>& p = states.phase_pressure;
-            const std::vector<CompVec>& z = states.surface_volume_density;
-            std::vector<PhaseVec>& mu = states.viscosity;
-            pvt_.getViscosity(p, z, mu);
+            int num = states.phase_pressure.size();
+            states.resize(num);
+            PvtBatchOutput output;
+            output.B = states.formation_volume_factor.data();
+            output.R = states.solution_factor.data();
+            output.viscosity = states.viscosity.data();
+            pvt_.evalAll(num, states.phase_pressure.data(),
+                         states.surface_volume_density.data(), output);
         }
 
         /// Input: p, z
@@ -126,16 +152,17 @@ namespace Opm
         template <class States>
         void computePvt(States& states) const
         {
-            const std::vector<PhaseVec>& p = states.phase_pressure;
-            const std::vector<CompVec>& z = states.surface_volume_density;
-            std::vector<PhaseVec>& B = states.formation_volume_factor;
-            std::vector<PhaseVec>& dB = states.formation_volume_factor_deriv;
-            std::vector<PhaseVec>& R = states.solution_factor;
-            std::vector<PhaseVec>& dR = states.solution_factor_deriv;
-            std::vector<PhaseVec>& mu = states.viscosity;
-            pvt_.dBdp(p, z, B, dB);
-            pvt_.dRdp(p, z, R, dR);
-            pvt_.getViscosity(p, z, mu);
+            int num = states.phase_pressure.size();
+            assert(int(states.surface_volume_density.size()) == num);
+            states.resize(num);
+            PvtBatchOutput output;
+            output.B = states.formation_volume_factor.data();
+            output.dBdp = states.formation_volume_factor_deriv.data();
+            output.R = states.solution_factor.data();
+            output.dRdp = states.solution_factor_deriv.data();
+            output.viscosity = states.viscosity.data();
+            pvt_.evalAll(num, states.phase_pressure.data(),
+                         states.surface_volume_density.data(), output);
         }
 
         /// Input: B, R
@@ -144,7 +171,7 @@ namespace Opm
         void computeStateMatrix(States& states) const
         {
             int num = states.formation_volume_factor.size();
-            states.state_matrix.resize(num);
+            states.resize(num);
 #pragma omp parallel for
             for (int i = 0; i < num; ++i) {
                 const PhaseVec& B = states.formation_volume_factor[i];
@@ -169,13 +196,16 @@ namespace Opm
         void computePvtDepending(States& states) const
         {
             int num = states.formation_volume_factor.size();
-            states.state_matrix.resize(num);
-            states.phase_volume_density.resize(num);
-            states.total_phase_volume_density.resize(num);
-            states.saturation.resize(num);
-            states.phase_compressibility.resize(num);
-            states.total_compressibility.resize(num);
-            states.experimental_term.resize(num);
+            states.resize(num);
+            if (batch_equilibrium_) {
+                const int num_blocks = (num + EquilibriumBlockSize - 1)/EquilibriumBlockSize;
+#pragma omp parallel for
+                for (int block = 0; block < num_blocks; ++block) {
+                    const int begin = block*EquilibriumBlockSize;
+                    computeEquilibriumBlock(states, begin, std::min(num, begin + EquilibriumBlockSize));
+                }
+                return;
+            }
 #pragma omp parallel for
             for (int i = 0; i < num; ++i) {
                 const CompVec& z = states.surface_volume_density[i];
@@ -196,14 +226,93 @@ namespace Opm
             }
         }
 
+        enum { EquilibriumBlockSize = 64 };
+
+        /// Same as computeSingleEquilibrium() for the cells [begin, end)
+        /// of states, with end - begin <= EquilibriumBlockSize. The inputs
+        /// are copied to one array per quantity, so that the arithmetic
+        /// runs as plain loops the compiler can vectorize, and the
+        /// closed-form inverse of the block structured A is used: water
+        /// is decoupled, and the oil-gas block has determinant
+        /// (1 - R_v R_l)/(B_l B_v). With C = A^{-1} dA/dp the phase
+        /// compressibilities are the column sums of C, and the
+        /// experimental term sum(A^{-1} dA A^{-1} z) = sum(C u) = c.u.
+        template <class States>
+        static void computeEquilibriumBlock(States& states, const int begin, const int end)
+        {
+            const int n = end - begin;
+            assert(n >= 0 && n <= EquilibriumBlockSize);
+            double Bw[EquilibriumBlockSize], Bl[EquilibriumBlockSize], Bv[EquilibriumBlockSize];
+            double dBw[EquilibriumBlockSize], dBl[EquilibriumBlockSize], dBv[EquilibriumBlockSize];
+            double Rl[EquilibriumBlockSize], Rv[EquilibriumBlockSize];
+            double dRl[EquilibriumBlockSize], dRv[EquilibriumBlockSize];
+            double zw[EquilibriumBlockSize], zo[EquilibriumBlockSize], zg[EquilibriumBlockSize];
+            for (int k = 0; k < n; ++k) {
+                const int i = begin + k;
+                const PhaseVec& B = states.formation_volume_factor[i];
+                const PhaseVec& dB = states.formation_volume_factor_deriv[i];
+                const PhaseVec& R = states.solution_factor[i];
+                const PhaseVec& dR = states.solution_factor_deriv[i];
+                const CompVec& z = states.surface_volume_density[i];
+                Bw[k] = B[Aqua];    Bl[k] = B[Liquid];    Bv[k] = B[Vapour];
+                dBw[k] = dB[Aqua];  dBl[k] = dB[Liquid];  dBv[k] = dB[Vapour];
+                Rl[k] = R[Liquid];  Rv[k] = R[Vapour];
+                dRl[k] = dR[Liquid];  dRv[k] = dR[Vapour];
+                zw[k] = z[Water];   zo[k] = z[Oil];       zg[k] = z[Gas];
+            }
+
+            double uw[EquilibriumBlockSize], ul[EquilibriumBlockSize], uv[EquilibriumBlockSize];
+            double cw[EquilibriumBlockSize], cl[EquilibriumBlockSize], cv[EquilibriumBlockSize];
+            for (int k = 0; k < n; ++k) {
+                const double inv_det = 1.0/(1.0 - Rv[k]*Rl[k]);
+                uw[k] = Bw[k]*zw[k];
+                uv[k] = Bv[k]*(zg[k] - Rl[k]*zo[k])*inv_det;
+                ul[k] = Bl[k]*(zo[k] - Rv[k]*zg[k])*inv_det;
+                // Nonzeros of dA/dp, as dAt in computeSingleEquilibrium().
+                const double dA_lo = -dBl[k]/(Bl[k]*Bl[k]);
+                const double dA_lg = dA_lo*Rl[k] + dRl[k]/Bl[k];
+                const double dA_vg = -dBv[k]/(Bv[k]*Bv[k]);
+                const double dA_vo = dA_vg*Rv[k] + dRv[k]/Bv[k];
+                cw[k] = -dBw[k]/Bw[k];
+                cl[k] = (Bl[k]*(dA_lo - Rv[k]*dA_lg) + Bv[k]*(dA_lg - Rl[k]*dA_lo))*inv_det;
+                cv[k] = (Bl[k]*(dA_vo - Rv[k]*dA_vg) + Bv[k]*(dA_vg - Rl[k]*dA_vo))*inv_det;
+            }
+
+            for (int k = 0; k < n; ++k) {
+                const int i = begin + k;
+                PhaseToCompMatrix& At = states.state_matrix[i];
+                At = 0.0;
+                At[Aqua][Water] = 1.0/Bw[k];
+                At[Vapour][Gas] = 1.0/Bv[k];
+                At[Liquid][Gas] = Rl[k]/Bl[k];
+                At[Vapour][Oil] = Rv[k]/Bv[k];
+                At[Liquid][Oil] = 1.0/Bl[k];
+                const double tot = uw[k] + uv[k] + ul[k];
+                PhaseVec& u = states.phase_volume_density[i];
+                u[Aqua] = uw[k];
+                u[Liquid] = ul[k];
+                u[Vapour] = uv[k];
+                states.total_phase_volume_density[i] = tot;
+                PhaseVec& s = states.saturation[i];
+                s[Aqua] = uw[k]/tot;
+                s[Liquid] = ul[k]/tot;
+                s[Vapour] = uv[k]/tot;
+                PhaseVec& cp = states.phase_compressibility[i];
+                cp[Aqua] = cw[k];
+                cp[Liquid] = cl[k];
+                cp[Vapour] = cv[k];
+                states.total_compressibility[i] = cp*s;
+                states.experimental_term[i] = cw[k]*uw[k] + cl[k]*ul[k] + cv[k]*uv[k];
+            }
+        }
+
         /// Input: s, mu
         /// Output: kr, lambda
         template <class States>
         void computeMobilitiesNoDerivs(States& states) const
         {
             int num = states.saturation.size();
-            states.relperm.resize(num);
-            states.mobility.resize(num);
+            states.resize(num);
 #pragma omp parallel for
             for (int i = 0; i < num; ++i) {
                 const CompVec& s = states.saturation[i];
@@ -224,10 +333,7 @@ namespace Opm
         void computeMobilities(States& states) const
         {
             int num = states.saturation.size();
-            states.relperm.resize(num);
-            states.relperm_deriv.resize(num);
-            states.mobility.resize(num);
-            states.mobility_deriv.resize(num);
+            states.resize(num);
 #pragma omp parallel for
             for (int i = 0; i < num; ++i) {
                 const CompVec& s = states.saturation[i];
@@ -254,6 +360,7 @@ namespace Opm
         BlackoilPVT pvt_;
         FluidMatrixInteractionBlackoilParams<double> fmi_params_;
         CompVec surface_densities_;
+        bool batch_equilibrium_;
 
 
     /*!
@@ -264,25 +371,18 @@ namespace Opm
     template <class FluidState>
     void computeEquilibrium(FluidState& fluid_state) const
     {
-        // Get B and R factors.
+        // Get B and R factors, their derivatives and the
+        // viscosities, in one fused evaluation.
         const PhaseVec& p = fluid_state.phase_pressure_;
         const CompVec& z = fluid_state.surface_volume_;
         PhaseVec& B = fluid_state.formation_volume_factor_;
-        B[Aqua]   = pvt_.B(p[Aqua],   z, Aqua);
-        B[Vapour] = pvt_.B(p[Vapour], z, Vapour);
-        B[Liquid] = pvt_.B(p[Liquid], z, Liquid);
         PhaseVec& R = fluid_state.solution_factor_; 
-        R[Aqua]   = 0.0;
-        R[Vapour] = pvt_.R(p[Vapour], z, Vapour);
-        R[Liquid] = pvt_.R(p[Liquid], z, Liquid);
+        PhaseVec& mu = fluid_state.viscosity_;
         PhaseVec dB;
-        dB[Aqua]   = pvt_.dBdp(p[Aqua],   z, Aqua);
-        dB[Vapour] = pvt_.dBdp(p[Vapour], z, Vapour);
-        dB[Liquid] = pvt_.dBdp(p[Liquid], z, Liquid);
         PhaseVec dR;
-        dR[Aqua]   = 0.0;
-        dR[Vapour] = pvt_.dRdp(p[Vapour], z, Vapour);
-        dR[Liquid] = pvt_.dRdp(p[Liquid], z, Liquid);
+        pvt_.evalAll(p, z, B, dB, R, dR, mu);
+        R[Aqua]   = 0.0;
+        dR[Aqua]  = 0.0;
 
         // Convenience vars.
         PhaseToCompMatrix& At = fluid_state.phase_to_comp_;
@@ -296,12 +396,6 @@ namespace Opm
         computeSingleEquilibrium(B, dB, R, dR, z,
                                  At, u, tot_phase_vol_dens,
                                  s, cp, tot_comp, exp_term);
-
-        // Compute viscosities.
-        PhaseVec& mu = fluid_state.viscosity_;
-        mu[Aqua]   = pvt_.getViscosity(p[Aqua],   z, Aqua);
-        mu[Vapour] = pvt_.getViscosity(p[Vapour], z, Vapour);
-        mu[Liquid] = pvt_.getViscosity(p[Liquid], z, Liquid);
     }
 
 
@@ -378,27 +472,77 @@ namespace Opm
 
 
 
+    /// Face counterpart of AllFluidStates, with the same storage. The
+    /// face pressures refer to the caller's array, set with
+    /// setPressure(), the face z values are computed and owned.
     struct FaceFluidData : public BlackoilDefs
     {
         // Canonical state variables.
-        std::vector<CompVec> surface_volume_density;         // z
-        std::vector<PhaseVec> phase_pressure;                // p
+        FieldArray<CompVec> surface_volume_density;         // z
+        FieldArray<const PhaseVec> phase_pressure;          // p
 
         // Variables from PVT functions.
-        std::vector<PhaseVec> formation_volume_factor;       // B
-        std::vector<PhaseVec> solution_factor;               // R
+        FieldArray<PhaseVec> formation_volume_factor;       // B
+        FieldArray<PhaseVec> solution_factor;               // R
 
         // Variables computed from PVT data.
         // The A matrices are all in Fortran order (or, equivalently,
         // we store the transposes).
-        std::vector<PhaseToCompMatrix> state_matrix;         // A' = (RB^{-1})'
+        FieldArray<PhaseToCompMatrix> state_matrix;         // A' = (RB^{-1})'
 
         // Variables computed from saturation.
-        std::vector<PhaseVec> mobility;                      // lambda
-        std::vector<PhaseJacobian> mobility_deriv;           // dlambda/ds
+        FieldArray<PhaseVec> mobility;                      // lambda
+        FieldArray<PhaseJacobian> mobility_deriv;           // dlambda/ds
 
         // Gravity and/or capillary pressure potential differences.
-        std::vector<PhaseVec> gravity_potential;             // (\rho g \delta z)-ish contribution per face
+        FieldArray<PhaseVec> gravity_potential;             // (\rho g \delta z)-ish contribution per face
+
+        FaceFluidData()
+        {
+        }
+
+        FaceFluidData(const FaceFluidData& other)
+            : phase_pressure(other.phase_pressure)
+        {
+            arena_.assign(*this, other.arena_);
+        }
+
+        FaceFluidData& operator=(const FaceFluidData& other)
+        {
+            if (this != &other) {
+                phase_pressure = other.phase_pressure;
+                arena_.assign(*this, other.arena_);
+            }
+            return *this;
+        }
+
+        /// Refer to the given face pressures, see AllFluidStates::setInput().
+        void setPressure(const std::vector<PhaseVec>& p)
+        {
+            phase_pressure = FieldArray<const PhaseVec>(p.data(), p.size());
+        }
+
+        /// Set the number of faces of all computed fields.
+        void resize(const int num)
+        {
+            arena_.resize(*this, num);
+        }
+
+        /// Calls op(field) for every computed field.
+        template <class Op>
+        void forEachField(Op& op)
+        {
+            op(surface_volume_density);
+            op(formation_volume_factor);
+            op(solution_factor);
+            op(state_matrix);
+            op(mobility);
+            op(mobility_deriv);
+            op(gravity_potential);
+        }
+
+    private:
+        FieldArena arena_;
     };
 
 
@@ -432,8 +576,9 @@ namespace Opm
             static_assert(np == 3, "");
 
             // p, z -> B, dB, R, dR, mu, A, dA, u, sum(u), s, c, cT, ex, kr, dkr, lambda, dlambda.
-            cell_data.phase_pressure = cell_pressure;
-            cell_data.surface_volume_density = cell_z;
+            // The pressures and z values are read in place, not copied.
+            cell_data.setInput(cell_pressure, cell_z);
+            cell_data.resize(num_cells);
             fluid.computePvt(cell_data);
             fluid.computePvtDepending(cell_data);
             fluid.computeMobilities(cell_data);
@@ -456,7 +601,7 @@ namespace Opm
 
             // Compute state matrices for faces.
             // p, z -> B, R, A
-            face_data.phase_pressure = face_pressure;
+            face_data.setPressure(face_pressure);
             fluid.computeBAndR(face_data);
             fluid.computeStateMatrix(face_data);
         }
@@ -473,109 +618,321 @@ namespace Opm
         {
             int num_faces = face_pressure.size();
             assert(num_faces == grid.numFaces());
+            int num_cells = cell_z.size();
             bool nonzero_gravity = gravity.two_norm() > 0.0;
-            face_data.state_matrix.resize(num_faces);
-            face_data.mobility.resize(num_faces);
-            face_data.mobility_deriv.resize(num_faces);
-            face_data.gravity_potential.resize(num_faces);
-            face_data.surface_volume_density.resize(num_faces);
-#pragma omp parallel for
+            face_data.resize(num_faces);
+            updateFaceGeometry(grid, gravity);
+
+            // Phase densities are needed on both sides of every face,
+            // compute them once per cell.
+            if (nonzero_gravity) {
+                cell_phase_density_.resize(num_cells);
+#pragma omp parallel for schedule(static)
+                for (int cell = 0; cell < num_cells; ++cell) {
+                    cell_phase_density_[cell] = fluid.phaseDensities(&cell_data.state_matrix[cell][0][0]);
+                }
+            }
+
+            // The work per face is nearly uniform, except at inflow
+            // boundaries, so a static schedule is used.
+#pragma omp parallel for schedule(static)
             for (int face = 0; face < num_faces; ++face) {
+                computeUpwindFace(face, fluid, nonzero_gravity,
+                                  cell_pressure, face_pressure, cell_z, bdy_z);
+            }
+        }
+
+
+        /// Recompute the cell properties of the given cells only, and
+        /// the upwind properties and state matrices of the faces
+        /// incident to them. All other data must be valid from an
+        /// earlier call to computeNew() with the same grid, gravity and
+        /// pressures, so this is meant for updates after a change of
+        /// cell_z in a few cells, as in explicit transport substeps.
+        template <class Grid, class Rock>
+        void computeIncremental(const Grid& grid,
+                                const Rock& rock,
+                                const BlackoilFluid& fluid,
+                                const typename Grid::Vector gravity,
+                                const std::vector<PhaseVec>& cell_pressure,
+                                const std::vector<PhaseVec>& face_pressure,
+                                const std::vector<CompVec>& cell_z,
+                                const CompVec& bdy_z,
+                                const double dt,
+                                const std::vector<int>& cells)
+        {
+            const int num_cells = cell_z.size();
+            assert(int(cell_data.saturation.size()) == num_cells);
+            assert(face_data.state_matrix.size() == face_pressure.size());
+            assert(face_cells_.size() == 2*face_pressure.size());
+            const int num = cells.size();
+
+            // The arrays may have been reallocated since computeNew().
+            cell_data.setInput(cell_pressure, cell_z);
+            face_data.setPressure(face_pressure);
+
+            // p, z -> all cell properties, for the given cells only.
+            // These are gathered, so here p and z must be copied.
+            sub_cell_pressure_.resize(num);
+            sub_cell_z_.resize(num);
+            for (int i = 0; i < num; ++i) {
+                sub_cell_pressure_[i] = cell_pressure[cells[i]];
+                sub_cell_z_[i] = cell_z[cells[i]];
+            }
+            sub_cell_data_.setInput(sub_cell_pressure_, sub_cell_z_);
+            sub_cell_data_.resize(num);
+            fluid.computePvt(sub_cell_data_);
+            fluid.computePvtDepending(sub_cell_data_);
+            fluid.computeMobilities(sub_cell_data_);
+            const bool nonzero_gravity = gravity.two_norm() > 0.0;
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < num; ++i) {
+                const int cell = cells[i];
+                copyCellData(sub_cell_data_, i, cell_data, cell);
+                double pv = rock.porosity(cell)*grid.cellVolume(cell);
+                voldiscr[cell] = (cell_data.total_phase_volume_density[cell] - 1.0)*pv/dt;
+                relvoldiscr[cell] = std::fabs(cell_data.total_phase_volume_density[cell] - 1.0);
+                if (nonzero_gravity) {
+                    cell_phase_density_[cell] = fluid.phaseDensities(&cell_data.state_matrix[cell][0][0]);
+                }
+            }
+
+            // Find the faces incident to the changed cells. A face
+            // between two changed cells is taken from the lower one.
+            // The mask is all zero between calls, so only the entries
+            // set here are reset.
+            if (int(changed_cell_mask_.size()) != num_cells) {
+                changed_cell_mask_.assign(num_cells, 0);
+            }
+            for (int i = 0; i < num; ++i) {
+                changed_cell_mask_[cells[i]] = 1;
+            }
+            changed_faces_.clear();
+            for (int i = 0; i < num; ++i) {
+                const int cell = cells[i];
+                const int num_local_faces = grid.numCellFaces(cell);
+                for (int local = 0; local < num_local_faces; ++local) {
+                    const int face = grid.cellFace(cell, local);
+                    const int* c = &face_cells_[2*face];
+                    const int other = c[0] == cell ? c[1] : c[0];
+                    if (other < 0 || !changed_cell_mask_[other] || cell < other) {
+                        changed_faces_.push_back(face);
+                    }
+                }
+            }
+            for (int i = 0; i < num; ++i) {
+                changed_cell_mask_[cells[i]] = 0;
+            }
+            std::sort(changed_faces_.begin(), changed_faces_.end());
+            const int num_changed_faces = changed_faces_.size();
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < num_changed_faces; ++i) {
+                computeUpwindFace(changed_faces_[i], fluid, nonzero_gravity,
+                                  cell_pressure, face_pressure, cell_z, bdy_z);
+            }
+
+            // p, z -> B, R, A for the same faces.
+            sub_face_pressure_.resize(num_changed_faces);
+            for (int i = 0; i < num_changed_faces; ++i) {
+                sub_face_pressure_[i] = face_pressure[changed_faces_[i]];
+            }
+            sub_face_data_.setPressure(sub_face_pressure_);
+            sub_face_data_.resize(num_changed_faces);
+            for (int i = 0; i < num_changed_faces; ++i) {
+                sub_face_data_.surface_volume_density[i] = face_data.surface_volume_density[changed_faces_[i]];
+            }
+            fluid.computeBAndR(sub_face_data_);
+            fluid.computeStateMatrix(sub_face_data_);
+            for (int i = 0; i < num_changed_faces; ++i) {
+                const int face = changed_faces_[i];
+                face_data.formation_volume_factor[face] = sub_face_data_.formation_volume_factor[i];
+                face_data.solution_factor[face] = sub_face_data_.solution_factor[i];
+                face_data.state_matrix[face] = sub_face_data_.state_matrix[i];
+            }
+        }
+
+        /// The two cells of every face (-1 outside the grid), as set by
+        /// the last computeNew().
+        const std::vector<int>& faceCells() const
+        {
+            return face_cells_;
+        }
+
+        /// (face centroid - cell centroid)*gravity for the two sides of
+        /// every face, as in faceCells().
+        const std::vector<double>& faceGravityDz() const
+        {
+            return face_gravity_dz_;
+        }
+
+
+    private:
+        // Upwind mobilities, face z and gravity potential of one face.
+        void computeUpwindFace(const int face,
+                               const BlackoilFluid& fluid,
+                               const bool nonzero_gravity,
+                               const std::vector<PhaseVec>& cell_pressure,
+                               const std::vector<PhaseVec>& face_pressure,
+                               const std::vector<CompVec>& cell_z,
+                               const CompVec& bdy_z)
+        {
             // Obtain properties from both sides of the face.
-                typedef typename Grid::Vector Vec;
-                Vec fc = grid.faceCentroid(face);
-                int c[2] = { grid.faceCell(face, 0), grid.faceCell(face, 1) };
-
-                // Get pressures and compute gravity contributions,
-                // to decide upwind directions.
-                PhaseVec phase_p[2];
-                PhaseVec gravcontrib[2];
-                for (int j = 0; j < 2; ++j) {
-                    if (c[j] >= 0) {
-                        // Pressures
-                        phase_p[j] = cell_pressure[c[j]];
-                        // Gravity contribution.
-                        if (nonzero_gravity) {
-                            Vec cdiff = fc;
-                            cdiff -= grid.cellCentroid(c[j]);
-                            gravcontrib[j] = fluid.phaseDensities(&cell_data.state_matrix[c[j]][0][0]);
-                            gravcontrib[j] *= (cdiff*gravity);
-                        } else {
-                            gravcontrib[j] = 0.0;
-                        }
+            const int* c = &face_cells_[2*face];
+
+            // Get pressures and compute gravity contributions,
+            // to decide upwind directions.
+            PhaseVec phase_p[2];
+            PhaseVec gravcontrib[2];
+            for (int j = 0; j < 2; ++j) {
+                if (c[j] >= 0) {
+                    // Pressures
+                    phase_p[j] = cell_pressure[c[j]];
+                    // Gravity contribution.
+                    if (nonzero_gravity) {
+                        gravcontrib[j] = cell_phase_density_[c[j]];
+                        gravcontrib[j] *= face_gravity_dz_[2*face + j];
                     } else {
-                        // Pressures
-                        phase_p[j] = face_pressure[face];
-                        // Gravity contribution.
                         gravcontrib[j] = 0.0;
                     }
+                } else {
+                    // Pressures
+                    phase_p[j] = face_pressure[face];
+                    // Gravity contribution.
+                    gravcontrib[j] = 0.0;
                 }
+            }
 
-                // Gravity contribution:
-                //    gravcapf = rho_1*g*(z_12 - z_1) - rho_2*g*(z_12 - z_2)
-                // where _1 and _2 refers to two neigbour cells, z is the
-                // z coordinate of the centroid, and z_12 is the face centroid.
-                // Also compute the potentials.
-                PhaseVec pot[2];
-                for (int phase = 0; phase < numPhases; ++phase) {
-                    face_data.gravity_potential[face][phase] = gravcontrib[0][phase] - gravcontrib[1][phase];
-                    pot[0][phase] = phase_p[0][phase] + face_data.gravity_potential[face][phase];
-                    pot[1][phase] = phase_p[1][phase];
-                }
+            // Gravity contribution:
+            //    gravcapf = rho_1*g*(z_12 - z_1) - rho_2*g*(z_12 - z_2)
+            // where _1 and _2 refers to two neigbour cells, z is the
+            // z coordinate of the centroid, and z_12 is the face centroid.
+            // Also compute the potentials.
+            PhaseVec pot[2];
+            for (int phase = 0; phase < numPhases; ++phase) {
+                face_data.gravity_potential[face][phase] = gravcontrib[0][phase] - gravcontrib[1][phase];
+                pot[0][phase] = phase_p[0][phase] + face_data.gravity_potential[face][phase];
+                pot[1][phase] = phase_p[1][phase];
+            }
 
-                // Now we can easily find the upwind direction for every phase,
-                // we can also tell which boundary faces are inflow bdys.
+            // Now we can easily find the upwind direction for every phase,
+            // we can also tell which boundary faces are inflow bdys.
+
+            // Compute face_z, which is averaged from the cells, unless on outflow or noflow bdy.
+            // Get mobilities and derivatives.
+            CompVec face_z(0.0);
+            double face_z_factor = 0.5;
+            PhaseVec phase_mob[2];
+            PhaseJacobian phasemob_deriv[2];
+            for (int j = 0; j < 2; ++j) {
+                if (c[j] >= 0) {
+                    face_z += cell_z[c[j]];
+                    phase_mob[j] = cell_data.mobility[c[j]];
+                    phasemob_deriv[j] = cell_data.mobility_deriv[c[j]];
+                } else if (pot[j][Liquid] > pot[(j+1)%2][Liquid]) {
+                    // Inflow boundary.
+                    face_z += bdy_z;
+                    FluidStateBlackoil bdy_state = fluid.computeState(face_pressure[face], bdy_z);
+                    phase_mob[j] = bdy_state.mobility_;
+                    phasemob_deriv[j] = bdy_state.dmobility_;
+                } else {
+                    // For outflow or noflow boundaries, only cell z is used.
+                    face_z_factor = 1.0;
+                    // Also, make sure the boundary data are not used for mobilities.
+                    pot[j] = -1e100;
+                }
+            }
+            face_z *= face_z_factor;
+            face_data.surface_volume_density[face] = face_z;
 
-                // Compute face_z, which is averaged from the cells, unless on outflow or noflow bdy.
-                // Get mobilities and derivatives.
-                CompVec face_z(0.0);
-                double face_z_factor = 0.5;
-                PhaseVec phase_mob[2];
-                PhaseJacobian phasemob_deriv[2];
-                for (int j = 0; j < 2; ++j) {
-                    if (c[j] >= 0) {
-                        face_z += cell_z[c[j]];
-                        phase_mob[j] = cell_data.mobility[c[j]];
-                        phasemob_deriv[j] = cell_data.mobility_deriv[c[j]];
-                    } else if (pot[j][Liquid] > pot[(j+1)%2][Liquid]) {
-                        // Inflow boundary.
-                        face_z += bdy_z;
-                        FluidStateBlackoil bdy_state = fluid.computeState(face_pressure[face], bdy_z);
-                        phase_mob[j] = bdy_state.mobility_;
-                        phasemob_deriv[j] = bdy_state.dmobility_;
-                    } else {
-                        // For outflow or noflow boundaries, only cell z is used.
-                        face_z_factor = 1.0;
-                        // Also, make sure the boundary data are not used for mobilities.
-                        pot[j] = -1e100;
+            // Computing upwind mobilities and derivatives
+            for (int phase = 0; phase < numPhases; ++phase) {
+                if (pot[0][phase] == pot[1][phase]) {
+                    // Average.
+                    double aver = 0.5*(phase_mob[0][phase] + phase_mob[1][phase]);
+                    face_data.mobility[face][phase] = aver;
+                    for (int p2 = 0; p2 < numPhases; ++p2) {
+                        face_data.mobility_deriv[face][phase][p2] = phasemob_deriv[0][phase][p2]
+                            + phasemob_deriv[1][phase][p2];
+                    }
+                } else {
+                    // Upwind.
+                    int upwind = pot[0][phase] > pot[1][phase] ? 0 : 1;
+                    face_data.mobility[face][phase] = phase_mob[upwind][phase];
+                    for (int p2 = 0; p2 < numPhases; ++p2) {
+                        face_data.mobility_deriv[face][phase][p2] = phasemob_deriv[upwind][phase][p2];
                     }
                 }
-                face_z *= face_z_factor;
-                face_data.surface_volume_density[face] = face_z;
+            }
+        }
 
-                // Computing upwind mobilities and derivatives
-                for (int phase = 0; phase < numPhases; ++phase) {
-                    if (pot[0][phase] == pot[1][phase]) {
-                        // Average.
-                        double aver = 0.5*(phase_mob[0][phase] + phase_mob[1][phase]);
-                        face_data.mobility[face][phase] = aver;
-                        for (int p2 = 0; p2 < numPhases; ++p2) {
-                            face_data.mobility_deriv[face][phase][p2] = phasemob_deriv[0][phase][p2]
-                                + phasemob_deriv[1][phase][p2];
-                        }
+        static void copyCellData(const AllFluidStates& src, const int i,
+                                 AllFluidStates& dst, const int j)
+        {
+            dst.formation_volume_factor[j] = src.formation_volume_factor[i];
+            dst.formation_volume_factor_deriv[j] = src.formation_volume_factor_deriv[i];
+            dst.solution_factor[j] = src.solution_factor[i];
+            dst.solution_factor_deriv[j] = src.solution_factor_deriv[i];
+            dst.viscosity[j] = src.viscosity[i];
+            dst.state_matrix[j] = src.state_matrix[i];
+            dst.phase_volume_density[j] = src.phase_volume_density[i];
+            dst.total_phase_volume_density[j] = src.total_phase_volume_density[i];
+            dst.saturation[j] = src.saturation[i];
+            dst.phase_compressibility[j] = src.phase_compressibility[i];
+            dst.total_compressibility[j] = src.total_compressibility[i];
+            dst.experimental_term[j] = src.experimental_term[i];
+            dst.relperm[j] = src.relperm[i];
+            dst.relperm_deriv[j] = src.relperm_deriv[i];
+            dst.mobility[j] = src.mobility[i];
+            dst.mobility_deriv[j] = src.mobility_deriv[i];
+        }
+
+        // Face neighbours and gravity terms (face centroid - cell
+        // centroid)*gravity for both sides of every face, stored
+        // contiguously. They only change with the grid or gravity.
+        std::vector<int> face_cells_;
+        std::vector<double> face_gravity_dz_;
+        std::vector<double> cached_gravity_;
+        const void* cached_grid_ = 0;
+        // Per-cell phase densities, for the gravity contributions.
+        std::vector<PhaseVec> cell_phase_density_;
+        // Work space for computeIncremental().
+        AllFluidStates sub_cell_data_;
+        FaceFluidData sub_face_data_;
+        std::vector<PhaseVec> sub_cell_pressure_;
+        std::vector<CompVec> sub_cell_z_;
+        std::vector<PhaseVec> sub_face_pressure_;
+        std::vector<char> changed_cell_mask_;
+        std::vector<int> changed_faces_;
+
+        template <class Grid>
+        void updateFaceGeometry(const Grid& grid, const typename Grid::Vector& gravity)
+        {
+            const int num_faces = grid.numFaces();
+            if (cached_grid_ == &grid && int(face_cells_.size()) == 2*num_faces
+                && int(cached_gravity_.size()) == int(gravity.size())
+                && std::equal(cached_gravity_.begin(), cached_gravity_.end(), gravity.begin())) {
+                return;
+            }
+            face_cells_.resize(2*num_faces);
+            face_gravity_dz_.resize(2*num_faces);
+#pragma omp parallel for schedule(static)
+            for (int face = 0; face < num_faces; ++face) {
+                const typename Grid::Vector fc = grid.faceCentroid(face);
+                for (int j = 0; j < 2; ++j) {
+                    const int cell = grid.faceCell(face, j);
+                    face_cells_[2*face + j] = cell;
+                    if (cell >= 0) {
+                        typename Grid::Vector cdiff = fc;
+                        cdiff -= grid.cellCentroid(cell);
+                        face_gravity_dz_[2*face + j] = cdiff*gravity;
                     } else {
-                        // Upwind.
-                        int upwind = pot[0][phase] > pot[1][phase] ? 0 : 1;
-                        face_data.mobility[face][phase] = phase_mob[upwind][phase];
-                        for (int p2 = 0; p2 < numPhases; ++p2) {
-                            face_data.mobility_deriv[face][phase][p2] = phasemob_deriv[upwind][phase][p2];
-                        }
+                        face_gravity_dz_[2*face + j] = 0.0;
                     }
                 }
             }
+            cached_gravity_.assign(gravity.begin(), gravity.end());
+            cached_grid_ = &grid;
         }
-
-
     };
 
 
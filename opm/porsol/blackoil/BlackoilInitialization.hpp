@@ -24,7 +24,12 @@
 #include <opm/common/ErrorMacros.hpp>
 #include <opm/core/utility/Units.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 
 namespace Opm
 {
@@ -325,6 +330,321 @@ namespace Opm
 
     };
 
+
+
+    /// Hydrostatic equilibration for general (corner-point) grids.
+    ///
+    /// For every equilibration region the pressure is integrated from
+    /// the datum depth over the depth range of the region's cells,
+    /// dp/dd = rho(p) g, with an adaptive Runge-Kutta (Bogacki-Shampine
+    /// 3(2)) method, splitting the range at the contacts since rho
+    /// jumps there. The accepted steps form a depth table of p and
+    /// dp/dd, which is interpolated (cubic Hermite) to all cell
+    /// centroids in parallel. Depth is measured along gravity.
+    ///
+    /// Above the gas-oil contact the cells hold the gas cap mixture
+    /// and connate water, between the contacts the oil mixture and
+    /// connate water, and below the water-oil contact water and
+    /// residual oil. Capillary pressures are zero. Parameters, which
+    /// may be given per region r = 1, 2, ... as name_r:
+    ///   datum_depth, datum_pressure (barsa),
+    ///   go_contact_depth, wo_contact_depth (default: no contacts),
+    ///   connate_water_saturation, residual_oil_saturation,
+    ///   initial_mixture_oil, initial_mixture_gas (oil zone z),
+    ///   gas_cap_mixture_gas, gas_cap_mixture_oil (gas cap z),
+    /// and equil_rtol, the relative pressure tolerance of the steps.
+    template <class Simulator>
+    class EquilibrationInitialization : public BlackoilInitialization<Simulator>
+    {
+    public:
+        typedef typename Simulator::State State;
+        typedef typename Simulator::Grid Grid;
+        typedef typename Simulator::Fluid Fluid;
+        typedef typename Fluid::CompVec CompVec;
+        typedef typename Fluid::PhaseVec PhaseVec;
+
+        /// Equilibration region (from 0) of every cell, for instance
+        /// EQLNUM - 1. Without this all cells are in one region.
+        void setRegions(const std::vector<int>& cell_region)
+        {
+            cell_region_ = cell_region;
+        }
+
+        virtual void init(const Opm::parameter::ParameterGroup& param,
+                          const Grid& grid,
+                          const Fluid& fluid,
+                          typename Grid::Vector gravity,
+                          State& simstate)
+        {
+            const int num_cells = grid.numCells();
+            if (!cell_region_.empty() && int(cell_region_.size()) != num_cells) {
+                OPM_THROW(std::runtime_error, "Equilibration regions given for " << cell_region_.size()
+                          << " cells, the grid has " << num_cells);
+            }
+            const double g = gravity.two_norm();
+            std::vector<double> depth(num_cells);
+#pragma omp parallel for schedule(static)
+            for (int cell = 0; cell < num_cells; ++cell) {
+                depth[cell] = g > 0.0 ? (grid.cellCentroid(cell)*gravity)/g : grid.cellCentroid(cell)[2];
+            }
+
+            // Depth range of each region.
+            int num_regions = 1;
+            if (!cell_region_.empty()) {
+                num_regions = *std::max_element(cell_region_.begin(), cell_region_.end()) + 1;
+            }
+            std::vector<double> min_depth(num_regions, 1e100);
+            std::vector<double> max_depth(num_regions, -1e100);
+            for (int cell = 0; cell < num_cells; ++cell) {
+                const int r = region(cell);
+                if (r < 0) {
+                    OPM_THROW(std::runtime_error, "Negative equilibration region for cell " << cell);
+                }
+                min_depth[r] = std::min(min_depth[r], depth[cell]);
+                max_depth[r] = std::max(max_depth[r], depth[cell]);
+            }
+
+            // Pressure tables, once per region.
+            const double rtol = param.getDefault("equil_rtol", 1e-10);
+            std::vector<Region> regions(num_regions);
+            for (int r = 0; r < num_regions; ++r) {
+                if (min_depth[r] <= max_depth[r]) {
+                    regions[r].init(param, r, fluid, g, rtol, min_depth[r], max_depth[r]);
+                }
+            }
+
+            simstate.cell_pressure_.resize(num_cells);
+            simstate.cell_z_.resize(num_cells);
+            // Fluid::computeState() is called from several threads here.
+            // BlackoilFluid only reads its PVT and saturation tables in
+            // it. There is no fluid using the CO2-brine flash of
+            // BlackoilCo2PVT, which is not known to be re-entrant; such
+            // a fluid would need this loop to be serial.
+#pragma omp parallel for schedule(static)
+            for (int cell = 0; cell < num_cells; ++cell) {
+                const Region& reg = regions[region(cell)];
+                const double p = reg.pressure(depth[cell]);
+                simstate.cell_pressure_[cell] = PhaseVec(p);
+                simstate.cell_z_[cell] = reg.mixture(fluid, p, depth[cell]);
+            }
+        }
+
+    private:
+        std::vector<int> cell_region_;
+
+        int region(const int cell) const
+        {
+            return cell_region_.empty() ? 0 : cell_region_[cell];
+        }
+
+        // A parameter that may be given for region r as name_r.
+        static double regionParam(const Opm::parameter::ParameterGroup& param,
+                                  const std::string& name, const int r, const double default_value)
+        {
+            std::ostringstream region_name;
+            region_name << name << '_' << r + 1;
+            if (param.has(region_name.str())) {
+                return param.get<double>(region_name.str());
+            }
+            return param.getDefault(name, default_value);
+        }
+
+        class Region
+        {
+        public:
+            void init(const Opm::parameter::ParameterGroup& param, const int r,
+                      const Fluid& fluid, const double g, const double rtol,
+                      const double min_depth, const double max_depth)
+            {
+                datum_depth_ = regionParam(param, "datum_depth", r, min_depth);
+                datum_pressure_ = Opm::unit::convert::from(regionParam(param, "datum_pressure", r, 200.0),
+                                                           Opm::unit::barsa);
+                go_contact_ = regionParam(param, "go_contact_depth", r, -1e100);
+                wo_contact_ = regionParam(param, "wo_contact_depth", r, 1e100);
+                if (go_contact_ > wo_contact_) {
+                    OPM_THROW(std::runtime_error, "Gas-oil contact below water-oil contact in equilibration region " << r + 1);
+                }
+                swc_ = regionParam(param, "connate_water_saturation", r, 0.0);
+                sor_ = regionParam(param, "residual_oil_saturation", r, 0.0);
+                oil_sample_ = 0.0;
+                oil_sample_[Fluid::Oil] = regionParam(param, "initial_mixture_oil", r, 1.0);
+                oil_sample_[Fluid::Gas] = regionParam(param, "initial_mixture_gas", r, 0.0);
+                gas_sample_ = 0.0;
+                gas_sample_[Fluid::Gas] = regionParam(param, "gas_cap_mixture_gas", r, 1.0);
+                gas_sample_[Fluid::Oil] = regionParam(param, "gas_cap_mixture_oil", r, 0.0);
+                water_sample_ = 0.0;
+                water_sample_[Fluid::Water] = 1.0;
+                g_ = g;
+                rtol_ = rtol;
+
+                // Integrate from the datum up and down, stopping at
+                // the contacts and the ends of the depth range.
+                const double top = std::min(min_depth, datum_depth_);
+                const double bottom = std::max(max_depth, datum_depth_);
+                std::vector<double> breaks;
+                breaks.push_back(top);
+                breaks.push_back(bottom);
+                breaks.push_back(datum_depth_);
+                if (go_contact_ > top && go_contact_ < bottom) {
+                    breaks.push_back(go_contact_);
+                }
+                if (wo_contact_ > top && wo_contact_ < bottom) {
+                    breaks.push_back(wo_contact_);
+                }
+                std::sort(breaks.begin(), breaks.end());
+                breaks.erase(std::unique(breaks.begin(), breaks.end()), breaks.end());
+                const int datum_ix = std::find(breaks.begin(), breaks.end(), datum_depth_) - breaks.begin();
+                const int num_segments = int(breaks.size()) - 1;
+                segments_.resize(std::max(num_segments, 1));
+                if (num_segments == 0) {
+                    // A single depth, no integration needed.
+                    Segment& seg = segments_[0];
+                    seg.depth.assign(1, datum_depth_);
+                    seg.pressure.assign(1, datum_pressure_);
+                    seg.deriv.assign(1, 0.0);
+                    return;
+                }
+                double p = datum_pressure_;
+                for (int s = datum_ix - 1; s >= 0; --s) {
+                    p = integrate(fluid, breaks[s + 1], breaks[s], p, segments_[s]);
+                }
+                p = datum_pressure_;
+                for (int s = datum_ix; s < num_segments; ++s) {
+                    p = integrate(fluid, breaks[s], breaks[s + 1], p, segments_[s]);
+                }
+            }
+
+            /// Pressure at depth d, within the depth range.
+            double pressure(const double d) const
+            {
+                // Find the segment, then the step containing d.
+                int s = 0;
+                while (s + 1 < int(segments_.size()) && d > segments_[s].depth.back()) {
+                    ++s;
+                }
+                const Segment& seg = segments_[s];
+                const int n = seg.depth.size();
+                if (n == 1 || d <= seg.depth.front()) {
+                    return seg.pressure.front() + (d - seg.depth.front())*seg.deriv.front();
+                }
+                if (d >= seg.depth.back()) {
+                    return seg.pressure.back() + (d - seg.depth.back())*seg.deriv.back();
+                }
+                const int i = std::upper_bound(seg.depth.begin(), seg.depth.end(), d) - seg.depth.begin() - 1;
+                const double h = seg.depth[i + 1] - seg.depth[i];
+                const double t = (d - seg.depth[i])/h;
+                const double t2 = t*t;
+                const double t3 = t2*t;
+                return (2.0*t3 - 3.0*t2 + 1.0)*seg.pressure[i] + (t3 - 2.0*t2 + t)*h*seg.deriv[i]
+                    + (-2.0*t3 + 3.0*t2)*seg.pressure[i + 1] + (t3 - t2)*h*seg.deriv[i + 1];
+            }
+
+            /// Surface volumes per pore volume at pressure p, for the
+            /// zone of depth d.
+            CompVec mixture(const Fluid& fluid, const double p, const double d) const
+            {
+                const CompVec& hc_sample = d < go_contact_ ? gas_sample_ : oil_sample_;
+                const double sw = d >= wo_contact_ ? 1.0 - sor_ : swc_;
+                const PhaseVec press(p);
+                CompVec z(0.0);
+                if (sw < 1.0) {
+                    typename Fluid::FluidState hc_state = fluid.computeState(press, hc_sample);
+                    z = hc_sample;
+                    z *= (1.0 - sw)/hc_state.total_phase_volume_density_;
+                }
+                if (sw > 0.0) {
+                    typename Fluid::FluidState w_state = fluid.computeState(press, water_sample_);
+                    CompVec zw = water_sample_;
+                    zw *= sw/w_state.total_phase_volume_density_;
+                    z += zw;
+                }
+                return z;
+            }
+
+        private:
+            // Accepted steps of one segment between breaks, by
+            // increasing depth.
+            struct Segment
+            {
+                std::vector<double> depth;
+                std::vector<double> pressure;
+                std::vector<double> deriv;
+            };
+            double datum_depth_;
+            double datum_pressure_;
+            double go_contact_;
+            double wo_contact_;
+            double swc_;
+            double sor_;
+            CompVec oil_sample_;
+            CompVec gas_sample_;
+            CompVec water_sample_;
+            double g_;
+            double rtol_;
+            std::vector<Segment> segments_;
+
+            // dp/dd in the zone of zone_depth.
+            double rhs(const Fluid& fluid, const double p, const double zone_depth) const
+            {
+                return g_*(mixture(fluid, p, zone_depth)*fluid.surfaceDensities());
+            }
+
+            // Integrate from d0 to d1 (either direction), starting with
+            // pressure p0. Returns the pressure at d1.
+            double integrate(const Fluid& fluid, const double d0, const double d1,
+                             const double p0, Segment& seg) const
+            {
+                const double zone_depth = 0.5*(d0 + d1);
+                const double length = std::fabs(d1 - d0);
+                const double dir = d1 > d0 ? 1.0 : -1.0;
+                std::vector<double> depth(1, d0);
+                std::vector<double> pressure(1, p0);
+                std::vector<double> deriv(1, rhs(fluid, p0, zone_depth));
+                double d = d0;
+                double p = p0;
+                double k1 = deriv.back();
+                double h = std::min(length, 10.0);
+                const int max_steps = 100000;
+                int steps = 0;
+                while (d != d1) {
+                    if (++steps > max_steps) {
+                        OPM_THROW(std::runtime_error, "Equilibration did not reach depth " << d1);
+                    }
+                    const bool last = h >= std::fabs(d1 - d);
+                    if (last) {
+                        h = std::fabs(d1 - d);
+                    }
+                    const double hs = dir*h;
+                    const double k2 = rhs(fluid, p + 0.5*hs*k1, zone_depth);
+                    const double k3 = rhs(fluid, p + 0.75*hs*k2, zone_depth);
+                    const double p_new = p + hs*(2.0*k1 + 3.0*k2 + 4.0*k3)/9.0;
+                    const double k4 = rhs(fluid, p_new, zone_depth);
+                    const double err = std::fabs(hs*(-5.0*k1/72.0 + k2/12.0 + k3/9.0 - k4/8.0));
+                    const double tol = rtol_*std::max(std::fabs(p_new), 1.0);
+                    if (err <= tol) {
+                        d = last ? d1 : d + hs;
+                        p = p_new;
+                        k1 = k4;
+                        depth.push_back(d);
+                        pressure.push_back(p);
+                        deriv.push_back(k4);
+                    }
+                    const double factor = err > 0.0 ? 0.9*std::cbrt(tol/err) : 5.0;
+                    h *= std::min(5.0, std::max(0.2, factor));
+                }
+                if (dir < 0.0) {
+                    std::reverse(depth.begin(), depth.end());
+                    std::reverse(pressure.begin(), pressure.end());
+                    std::reverse(deriv.begin(), deriv.end());
+                }
+                seg.depth.swap(depth);
+                seg.pressure.swap(pressure);
+                seg.deriv.swap(deriv);
+                return p;
+            }
+        };
+    };
+
 } // namespace Opm
 
 #endif // OPM_BLACKOILINITIALIZATION_HEADER_INCLUDED
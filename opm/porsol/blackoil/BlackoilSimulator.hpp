@@ -28,16 +28,29 @@
 #include <opm/core/utility/parameters/ParameterGroup.hpp>
 #include <opm/porsol/common/BoundaryConditions.hpp>
 #include <opm/porsol/blackoil/BlackoilInitialization.hpp>
+#include <opm/porsol/blackoil/TimeStepControl.hpp>
+#include <opm/porsol/common/AsyncOutputWriter.hpp>
+#include <opm/porsol/common/Metrics.hpp>
 #include <opm/porsol/common/SimulatorUtilities.hpp>
 #include <opm/parser/eclipse/Parser/Parser.hpp>
 #include <opm/parser/eclipse/Parser/ParseContext.hpp>
 #include <opm/parser/eclipse/Deck/Deck.hpp>
 #include <boost/filesystem/convenience.hpp>
 #include <boost/lexical_cast.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <numeric>
+#include <time.h>
 
 
 namespace Opm
@@ -47,12 +60,38 @@ namespace Opm
     class BlackoilSimulator
     {
     public:
-        void init(const Opm::parameter::ParameterGroup& param);
-        void simulate();
-
         typedef GridT Grid;
         typedef FluidT Fluid;
 
+        /// Grid, fluid and input deck. They are read-only once set up,
+        /// so that several simulators can share them, see
+        /// BlackoilEnsemble.
+        struct SharedModel
+        {
+            Grid grid;
+            Fluid fluid;
+            Opm::DeckConstPtr deck;
+        };
+
+        /// What differs between simulators sharing a model.
+        struct RealizationInput
+        {
+            /// Overrides the model deck: the rock properties are taken
+            /// from it if it has PERMX, the wells if it has WELSPECS.
+            Opm::DeckConstPtr deck;
+            /// Overrides the output_dir parameter if not empty.
+            std::string output_dir;
+        };
+
+        /// Read the deck and set up grid and fluid, as init() does.
+        static std::shared_ptr<SharedModel> createModel(const Opm::parameter::ParameterGroup& param);
+
+        void init(const Opm::parameter::ParameterGroup& param);
+        void init(const Opm::parameter::ParameterGroup& param,
+                  std::shared_ptr<const SharedModel> model,
+                  const RealizationInput& realization);
+        void simulate();
+
         typedef typename Fluid::CompVec CompVec;
         typedef typename Fluid::PhaseVec PhaseVec;
 
@@ -64,12 +103,21 @@ namespace Opm
             std::vector<double> well_perf_pressure_;
             std::vector<double> well_perf_flux_;
             std::vector<CompVec> cell_z_;
+
+            void swap(State& other)
+            {
+                cell_pressure_.swap(other.cell_pressure_);
+                face_pressure_.swap(other.face_pressure_);
+                well_bhp_pressure_.swap(other.well_bhp_pressure_);
+                well_perf_pressure_.swap(other.well_perf_pressure_);
+                well_perf_flux_.swap(other.well_perf_flux_);
+                cell_z_.swap(other.cell_z_);
+            }
         };
 
     private:
-        Grid grid_;
+        std::shared_ptr<const SharedModel> model_;
         Rock rock_;
-        Fluid fluid_;
         Wells wells_;
         FlowSolver flow_solver_;
         TransportSolver transport_solver_;
@@ -78,7 +126,15 @@ namespace Opm
         typename Grid::Vector gravity_;
         std::vector<double> src_;
 
+        // The state at the start of the current step (the last accepted
+        // state), and the trial state the solvers write into. An
+        // accepted step swaps them, a rejected one just drops next_state_.
         State state_;
+        State next_state_;
+
+        // Face pressures of the initial state, used by the flow solver
+        // for Dirichlet faces given a negative pressure value.
+        std::vector<PhaseVec> initial_face_pressure_;
 
         PhaseVec bdy_pressure_;
         CompVec bdy_z_;
@@ -89,18 +145,138 @@ namespace Opm
         double stepsize_increase_factor_;
         double minimum_stepsize_;
         double maximum_stepsize_;
+        std::unique_ptr<TimeStepControlInterface> step_control_;
+        bool adapt_report_steps_;
         std::vector<double> report_times_;
         bool do_impes_;
         bool ignore_impes_stability_;
         std::string output_dir_;
         int output_interval_;
+        bool output_vtk_;
+        Dune::VTK::OutputType vtk_output_type_;
+        enum DumpFormat { NoDump, TextDump, BinaryDump };
+        DumpFormat dump_format_;
+        std::unique_ptr<AsyncOutputWriter> writer_;
+        int checkpoint_interval_;
+        // Timers, counters and histograms of the solvers, current while
+        // simulate() runs, written to metrics_file_ at the end.
+        MetricsRegistry metrics_;
+        std::string metrics_file_;
+
+        // Where the time loop stands, the part of a checkpoint that is
+        // not State. Set by init() when restarting.
+        struct RunPosition
+        {
+            RunPosition()
+                : current_time(0.0), step(0), stepsize(0.0),
+                  num_accepted(0), num_rejected(0)
+            {
+            }
+            double current_time;
+            int step;
+            double stepsize;
+            int num_accepted;
+            int num_rejected;
+            std::vector<PhaseVec> prev_sat;
+        };
+        RunPosition start_;
+
+        // Everything written for one report step. Owned by the output
+        // job, so that writing may run while the simulation continues.
+        struct OutputSnapshot
+        {
+            int step;
+            std::string filebase;
+            // Multi-component fields are flattened, as Dune's vtk writer wants.
+            std::vector<double> cell_pressure;
+            std::vector<double> cell_velocity;
+            std::vector<double> z;
+            std::vector<double> sat;
+            std::vector<double> mass_frac;
+            std::vector<double> totflvol_dens;
+            // Well report.
+            std::vector<int> perf_cell;
+            std::vector<double> perf_pressure;
+            std::vector<double> perf_cell_pressure;
+            std::vector<double> perf_mass_rate;  // Per day, numComponents per perforation.
+        };
+
+        void output(const std::vector<double>& face_flux,
+                    const int step,
+                    const std::string& filebase);
+
+        static void takeSnapshot(const Grid& grid,
+                                 const Fluid& fluid,
+                                 const Wells& wells,
+                                 const State& simstate,
+                                 const std::vector<double>& face_flux,
+                                 OutputSnapshot& snap);
 
-        static void output(const Grid& grid,
-                           const Fluid& fluid,
-                           const State& simstate,
-                           const std::vector<double>& face_flux,
-                           const int step,
-                           const std::string& filebase);
+        static void writeVtk(const Grid& grid,
+                             const OutputSnapshot& snap,
+                             const Dune::VTK::OutputType type);
+
+        static void writeTextDump(const OutputSnapshot& snap);
+
+        static void writeBinaryDump(const OutputSnapshot& snap);
+
+        void writeCheckpoint(const RunPosition& pos) const;
+
+        // CPU seconds used by the calling thread.
+        static double threadCpuSeconds()
+        {
+            timespec ts;
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+            return ts.tv_sec + 1e-9*ts.tv_nsec;
+        }
+
+        // CPU seconds used by the threads of the OpenMP team of the
+        // calling thread. Unlike std::clock() this leaves out other
+        // simulators running in the same process, as in
+        // BlackoilEnsemble, whose worker threads have a team each.
+        // Differences of this are only meaningful if the team is made
+        // of the same threads at both calls. The clocks are
+        // cumulative, so they also count time spin waiting between
+        // parallel regions and any other work the team threads did in
+        // between. threadCpuSeconds() of the thread that owns the
+        // simulator does not depend on the team, but misses the work
+        // of the other team threads.
+        static double teamCpuSeconds()
+        {
+            double seconds = 0.0;
+#pragma omp parallel reduction(+:seconds)
+            {
+                seconds += threadCpuSeconds();
+            }
+            return seconds;
+        }
+
+        void readCheckpoint(const std::string& filename);
+
+        // PhaseVec and CompVec are fixed size vectors of doubles.
+        template <class Vec>
+        static std::vector<double> flatten(const std::vector<Vec>& v)
+        {
+            std::vector<double> flat;
+            flat.reserve(v.size()*Vec::dimension);
+            for (std::size_t i = 0; i < v.size(); ++i) {
+                flat.insert(flat.end(), v[i].begin(), v[i].end());
+            }
+            return flat;
+        }
+
+        template <class Vec>
+        static bool unflatten(const std::vector<double>& flat, std::vector<Vec>& v)
+        {
+            if (flat.size() % Vec::dimension != 0) {
+                return false;
+            }
+            v.resize(flat.size()/Vec::dimension);
+            for (std::size_t i = 0; i < v.size(); ++i) {
+                std::copy(flat.begin() + i*Vec::dimension, flat.begin() + (i + 1)*Vec::dimension, v[i].begin());
+            }
+            return true;
+        }
     };
 
 
@@ -110,25 +286,20 @@ namespace Opm
 
 
 template<class Grid, class Rock, class Fluid, class Wells, class FlowSolver, class TransportSolver>
-void
+std::shared_ptr<typename BlackoilSimulator<Grid, Rock, Fluid, Wells, FlowSolver, TransportSolver>::SharedModel>
 BlackoilSimulator<Grid, Rock, Fluid, Wells, FlowSolver, TransportSolver>::
-init(const Opm::parameter::ParameterGroup& param)
+createModel(const Opm::parameter::ParameterGroup& param)
 {
-    using namespace Opm;
+    std::shared_ptr<SharedModel> model(new SharedModel);
     std::string fileformat = param.getDefault<std::string>("fileformat", "cartesian");
+    Opm::ParseContext parseContext;
+    Opm::ParserPtr parser(new Opm::Parser());
+    model->deck = parser->parseFile(param.get<std::string>("filename") , parseContext);
     if (fileformat == "eclipse") {
-        Opm::ParseContext parseContext;
-        Opm::ParserPtr parser(new Opm::Parser());
-        Opm::DeckConstPtr deck = parser->parseFile(param.get<std::string>("filename") , parseContext);
         double z_tolerance = param.getDefault<double>("z_tolerance", 0.0);
         bool periodic_extension = param.getDefault<bool>("periodic_extension", false);
         bool turn_normals = param.getDefault<bool>("turn_normals", false);
-        grid_.processEclipseFormat(deck, z_tolerance, periodic_extension, turn_normals);
-        double perm_threshold_md = param.getDefault("perm_threshold_md", 0.0);
-        double perm_threshold = Opm::unit::convert::from(perm_threshold_md, Opm::prefix::milli*Opm::unit::darcy);
-        rock_.init(deck, grid_.globalCell(), perm_threshold);
-        fluid_.init(deck);
-        wells_.init(deck, grid_, rock_);
+        model->grid.processEclipseFormat(model->deck, z_tolerance, periodic_extension, turn_normals);
     } else if (fileformat == "cartesian") {
         std::array<int, 3> dims = {{ param.getDefault<int>("nx", 1),
                                       param.getDefault<int>("ny", 1),
@@ -136,20 +307,70 @@ init(const Opm::parameter::ParameterGroup& param)
         std::array<double, 3> cellsz = {{ param.getDefault<double>("dx", 1.0),
                                            param.getDefault<double>("dy", 1.0),
                                            param.getDefault<double>("dz", 1.0) }};
-        grid_.createCartesian(dims, cellsz);
+        model->grid.createCartesian(dims, cellsz);
+    } else {
+        OPM_THROW(std::runtime_error, "Unknown file format string: " << fileformat);
+    }
+    model->fluid.init(model->deck);
+    if (param.getDefault("pvt_tabulation", false)) {
+        // Trade some accuracy for search-free PVT lookups.
+        const int pressure_samples = param.getDefault("pvt_pressure_samples", 1025);
+        const int ratio_samples = param.getDefault("pvt_ratio_samples", 257);
+        const double max_err = model->fluid.tabulatePvt(pressure_samples, ratio_samples);
+        std::cout << "PVT tables resampled on " << pressure_samples << " x " << ratio_samples
+                  << " uniform grid, max relative deviation: " << max_err << std::endl;
+    }
+    // Closed-form, blocked equilibrium kernel (same results up to rounding).
+    model->fluid.setBatchEquilibrium(param.getDefault("batch_equilibrium", false));
+    return model;
+}
+
+
+
+template<class Grid, class Rock, class Fluid, class Wells, class FlowSolver, class TransportSolver>
+void
+BlackoilSimulator<Grid, Rock, Fluid, Wells, FlowSolver, TransportSolver>::
+init(const Opm::parameter::ParameterGroup& param)
+{
+    init(param, createModel(param), RealizationInput());
+}
+
+
+
+template<class Grid, class Rock, class Fluid, class Wells, class FlowSolver, class TransportSolver>
+void
+BlackoilSimulator<Grid, Rock, Fluid, Wells, FlowSolver, TransportSolver>::
+init(const Opm::parameter::ParameterGroup& param,
+     std::shared_ptr<const SharedModel> model,
+     const RealizationInput& realization)
+{
+    using namespace Opm;
+    model_ = model;
+
+    // Rock properties and wells, unless given by the realization
+    // deck, from the model deck (or uniform for cartesian grids).
+    std::string fileformat = param.getDefault<std::string>("fileformat", "cartesian");
+    Opm::DeckConstPtr rock_deck;
+    if (realization.deck && realization.deck->hasKeyword("PERMX")) {
+        rock_deck = realization.deck;
+    } else if (fileformat == "eclipse") {
+        rock_deck = model_->deck;
+    }
+    if (rock_deck) {
+        double perm_threshold_md = param.getDefault("perm_threshold_md", 0.0);
+        double perm_threshold = Opm::unit::convert::from(perm_threshold_md, Opm::prefix::milli*Opm::unit::darcy);
+        rock_.init(rock_deck, model_->grid.globalCell(), perm_threshold);
+    } else {
         double default_poro = param.getDefault("default_poro", 1.0);
         double default_perm_md = param.getDefault("default_perm_md", 100.0);
         double default_perm = unit::convert::from(default_perm_md, prefix::milli*unit::darcy);
         OPM_MESSAGE("Warning: For generated cartesian grids, we use uniform rock properties.");
-        rock_.init(grid_.size(0), default_poro, default_perm);
-
-        Opm::ParseContext parseContext;
-        Opm::ParserPtr parser(new Opm::Parser());
-        Opm::DeckConstPtr deck = parser->parseFile(param.get<std::string>("filename") , parseContext);
-        fluid_.init(deck);
-        wells_.init(deck, grid_, rock_);
+        rock_.init(model_->grid.size(0), default_poro, default_perm);
+    }
+    if (realization.deck && realization.deck->hasKeyword("WELSPECS")) {
+        wells_.init(realization.deck, model_->grid, rock_);
     } else {
-        OPM_THROW(std::runtime_error, "Unknown file format string: " << fileformat);
+        wells_.init(model_->deck, model_->grid, rock_);
     }
     flow_solver_.init(param);
     transport_solver_.init(param);
@@ -163,6 +384,9 @@ init(const Opm::parameter::ParameterGroup& param)
         assert(!report_times_.empty());
         total_time_ = report_times_.back();
         initial_stepsize_ = report_times_.front();
+        increase_stepsize_ = false;
+        stepsize_increase_factor_ = 1.0;
+        maximum_stepsize_ = 1e100;
     } else {
         total_time_ = param.getDefault("total_time", 30*unit::day);
         initial_stepsize_ = param.getDefault("initial_stepsize", 1.0*unit::day);
@@ -176,12 +400,62 @@ init(const Opm::parameter::ParameterGroup& param)
         }
     }
     minimum_stepsize_ = param.getDefault("minimum_stepsize", 0.0);
+    // Step size control. The simple policy is the classic one, with
+    // given report times it always steps to the next report time.
+    std::string step_control = param.getDefault<std::string>("timestep_control", "simple");
+    if (step_control == "simple") {
+        step_control_.reset(new SimpleTimeStepControl(stepsize_increase_factor_, maximum_stepsize_));
+        adapt_report_steps_ = false;
+    } else if (step_control == "pid") {
+        maximum_stepsize_ = param.getDefault("maximum_stepsize", maximum_stepsize_);
+        step_control_.reset(new PIDTimeStepControl(param, minimum_stepsize_, maximum_stepsize_));
+        adapt_report_steps_ = true;
+    } else {
+        OPM_THROW(std::runtime_error, "Unknown timestep_control: " << step_control);
+    }
     do_impes_ = param.getDefault("do_impes", false);
     if (do_impes_) {
         ignore_impes_stability_ = param.getDefault("ignore_impes_stability", false);
     }
-    output_dir_ = param.getDefault<std::string>("output_dir", "output");
+    output_dir_ = realization.output_dir.empty()
+        ? param.getDefault<std::string>("output_dir", "output")
+        : realization.output_dir;
     output_interval_ = param.getDefault("output_interval", 1);
+    // Keep the pressure trace of each realization apart.
+    boost::filesystem::path trace_file(param.getDefault<std::string>("trace_file", "pressure-trace.bin"));
+    if (trace_file.is_relative()) {
+        trace_file = boost::filesystem::path(output_dir_) / trace_file;
+    }
+    flow_solver_.setTraceFile(trace_file.string());
+    std::string vtk_format = param.getDefault<std::string>("output_vtk_format", "ascii");
+    output_vtk_ = true;
+    if (vtk_format == "ascii") {
+        vtk_output_type_ = Dune::VTK::ascii;
+    } else if (vtk_format == "binary") {
+        vtk_output_type_ = Dune::VTK::appendedraw;
+    } else if (vtk_format == "base64") {
+        vtk_output_type_ = Dune::VTK::appendedbase64;
+    } else if (vtk_format == "none") {
+        output_vtk_ = false;
+    } else {
+        OPM_THROW(std::runtime_error, "Unknown output_vtk_format: " << vtk_format);
+    }
+    std::string dump_format = param.getDefault<std::string>("output_dump_format", "text");
+    if (dump_format == "text") {
+        dump_format_ = TextDump;
+    } else if (dump_format == "binary") {
+        dump_format_ = BinaryDump;
+    } else if (dump_format == "none") {
+        dump_format_ = NoDump;
+    } else {
+        OPM_THROW(std::runtime_error, "Unknown output_dump_format: " << dump_format);
+    }
+    writer_.reset(new AsyncOutputWriter(param.getDefault("output_async", false),
+                                        param.getDefault("output_max_pending", 2)));
+    checkpoint_interval_ = param.getDefault("checkpoint_interval", 0);
+    if (param.getDefault("write_metrics", true)) {
+        metrics_file_ = output_dir_ + "/" + param.getDefault<std::string>("metrics_file", "metrics.json");
+    }
 
     // Boundary conditions.
     typedef Opm::FlowBC BC;
@@ -208,98 +482,117 @@ init(const Opm::parameter::ParameterGroup& param)
         }
     }
 
-    // Initial state.
-    if (param.getDefault("spe9_init", false)) {
-        SPE9Initialization<BlackoilSimulator> initializer;
-        initializer.init(param, grid_, fluid_, gravity_, state_);
-    } else {
-        BasicInitialization<BlackoilSimulator> initializer;
-        initializer.init(param, grid_, fluid_, gravity_, state_);
-    }
-
-
-
-    // Write initial state to std::cout
-    /*
-      for (int cell = 0; cell < grid_.numCells(); ++cell) {         
-      std::cout.precision(2);
-      std::cout << std::fixed << std::showpoint;
-            
-      std::cout << std::setw(5) << cell << std::setw(12) << grid_.cellCentroid(cell)[0]
-      << std::setw(12) << grid_.cellCentroid(cell)[1]
-      << std::setw(12) << grid_.cellCentroid(cell)[2] 
-      << std::setw(20) << state_.cell_pressure_[cell][0]
-      << std::setw(15) << state_.cell_z_[cell][0]
-      << std::setw(15) << state_.cell_z_[cell][1]
-      << std::setw(15) << state_.cell_z_[cell][2]
-      << std::endl;
-      if ((cell+1)%nz == 0) {
-      std::cout << "------------------------------------------------------------------------------------------------------------------" << std::endl;
-      }
-            
-      }
-    */
-
+    // Initial state, either computed or read from a checkpoint.
     bdy_z_ = flow_solver_.inflowMixture();
     bdy_pressure_ = 300.0*Opm::unit::barsa;
     // PhaseVec bdy_pressure_(100.0*Opm::unit::barsa); // WELLS
-    // Rescale z values so that pore volume is filled exactly
-    // (to get zero initial volume discrepancy).
-    for (int cell = 0; cell < grid_.numCells(); ++cell) {
-        typename Fluid::FluidState state = fluid_.computeState(state_.cell_pressure_[cell], state_.cell_z_[cell]);
-        double fluid_vol_dens = state.total_phase_volume_density_;
-        state_.cell_z_[cell] *= 1.0/fluid_vol_dens;
-    }
-    int num_faces = grid_.numFaces();
-    state_.face_pressure_.resize(num_faces);
-    for (int face = 0; face < num_faces; ++face) {
-        int bid = grid_.boundaryId(face);
-        if (flow_bc_.flowCond(bid).isDirichlet() && flow_bc_.flowCond(bid).pressure() >= 0.0) {
-            state_.face_pressure_[face] = flow_bc_.flowCond(bid).pressure();
+    const std::string restart_file = param.getDefault<std::string>("restart_file", "");
+    start_ = RunPosition();
+    start_.stepsize = initial_stepsize_;
+    if (!restart_file.empty()) {
+        readCheckpoint(restart_file);
+    } else {
+        if (param.getDefault("spe9_init", false)) {
+            SPE9Initialization<BlackoilSimulator> initializer;
+            initializer.init(param, model_->grid, model_->fluid, gravity_, state_);
+        } else if (param.getDefault("equil_init", false)) {
+            EquilibrationInitialization<BlackoilSimulator> initializer;
+            if (model_->deck && model_->deck->hasKeyword("EQLNUM")) {
+                const std::vector<int>& eqlnum = model_->deck->getKeyword("EQLNUM").getIntData();
+                const std::vector<int>& global_cell = model_->grid.globalCell();
+                std::vector<int> region(global_cell.size());
+                for (std::size_t cell = 0; cell < global_cell.size(); ++cell) {
+                    region[cell] = eqlnum[global_cell[cell]] - 1;
+                }
+                initializer.setRegions(region);
+            }
+            initializer.init(param, model_->grid, model_->fluid, gravity_, state_);
         } else {
-            int c[2] = { grid_.faceCell(face, 0), grid_.faceCell(face, 1) };
-            state_.face_pressure_[face] = 0.0;
-            int num = 0;
-            for (int j = 0; j < 2; ++j) {
-                if (c[j] >= 0) {
-                    state_.face_pressure_[face] += state_.cell_pressure_[c[j]];
-                    ++num;
+            BasicInitialization<BlackoilSimulator> initializer;
+            initializer.init(param, model_->grid, model_->fluid, gravity_, state_);
+        }
+        // Write initial state to std::cout
+        /*
+          for (int cell = 0; cell < model_->grid.numCells(); ++cell) {         
+          std::cout.precision(2);
+          std::cout << std::fixed << std::showpoint;
+            
+          std::cout << std::setw(5) << cell << std::setw(12) << model_->grid.cellCentroid(cell)[0]
+          << std::setw(12) << model_->grid.cellCentroid(cell)[1]
+          << std::setw(12) << model_->grid.cellCentroid(cell)[2] 
+          << std::setw(20) << state_.cell_pressure_[cell][0]
+          << std::setw(15) << state_.cell_z_[cell][0]
+          << std::setw(15) << state_.cell_z_[cell][1]
+          << std::setw(15) << state_.cell_z_[cell][2]
+          << std::endl;
+          if ((cell+1)%nz == 0) {
+          std::cout << "------------------------------------------------------------------------------------------------------------------" << std::endl;
+          }
+            
+          }
+        */
+
+        // Rescale z values so that pore volume is filled exactly
+        // (to get zero initial volume discrepancy).
+        for (int cell = 0; cell < model_->grid.numCells(); ++cell) {
+            typename Fluid::FluidState state = model_->fluid.computeState(state_.cell_pressure_[cell], state_.cell_z_[cell]);
+            double fluid_vol_dens = state.total_phase_volume_density_;
+            state_.cell_z_[cell] *= 1.0/fluid_vol_dens;
+        }
+        int num_faces = model_->grid.numFaces();
+        state_.face_pressure_.resize(num_faces);
+        for (int face = 0; face < num_faces; ++face) {
+            int bid = model_->grid.boundaryId(face);
+            if (flow_bc_.flowCond(bid).isDirichlet() && flow_bc_.flowCond(bid).pressure() >= 0.0) {
+                state_.face_pressure_[face] = flow_bc_.flowCond(bid).pressure();
+            } else {
+                int c[2] = { model_->grid.faceCell(face, 0), model_->grid.faceCell(face, 1) };
+                state_.face_pressure_[face] = 0.0;
+                int num = 0;
+                for (int j = 0; j < 2; ++j) {
+                    if (c[j] >= 0) {
+                        state_.face_pressure_[face] += state_.cell_pressure_[c[j]];
+                        ++num;
+                    }
                 }
+                state_.face_pressure_[face] /= double(num);
             }
-            state_.face_pressure_[face] /= double(num);
         }
+        initial_face_pressure_ = state_.face_pressure_;
     }
 
     // Flow solver setup.
-    flow_solver_.setup(grid_, rock_, fluid_, wells_, gravity_, flow_bc_, &(state_.face_pressure_));
+    flow_solver_.setup(model_->grid, rock_, model_->fluid, wells_, gravity_, flow_bc_, &initial_face_pressure_);
 
     // Transport solver setup.
-    transport_solver_.setup(grid_, rock_, fluid_, wells_, flow_solver_.faceTransmissibilities(), gravity_);
+    transport_solver_.setup(model_->grid, rock_, model_->fluid, wells_, flow_solver_.faceTransmissibilities(), gravity_);
 
     // Simple source terms.
-    src_.resize(grid_.numCells(), 0.0);
-
-    // Set initial well perforation pressures equal to cell pressures,
-    // and perforation fluxes equal to zero.
-    // Set initial well bhp values to the target if bhp well, or to
-    // first perforation pressure if not.
-    state_.well_perf_pressure_.clear();
-    for (int well = 0; well < wells_.numWells(); ++well) {
-        int num_perf = wells_.numPerforations(well);
-        for (int perf = 0; perf < num_perf; ++perf) {
-            int cell = wells_.wellCell(well, perf);
-            state_.well_perf_pressure_.push_back(state_.cell_pressure_[cell][Fluid::Liquid]);
-        }
-        if (wells_.control(well) == Wells::Pressure) {
-            state_.well_bhp_pressure_.push_back(wells_.target(well));
-        } else {
-            int cell = wells_.wellCell(well, 0);
-            state_.well_bhp_pressure_.push_back(state_.cell_pressure_[cell][Fluid::Liquid]);
+    src_.resize(model_->grid.numCells(), 0.0);
+
+    if (restart_file.empty()) {
+        // Set initial well perforation pressures equal to cell pressures,
+        // and perforation fluxes equal to zero.
+        // Set initial well bhp values to the target if bhp well, or to
+        // first perforation pressure if not.
+        state_.well_perf_pressure_.clear();
+        for (int well = 0; well < wells_.numWells(); ++well) {
+            int num_perf = wells_.numPerforations(well);
+            for (int perf = 0; perf < num_perf; ++perf) {
+                int cell = wells_.wellCell(well, perf);
+                state_.well_perf_pressure_.push_back(state_.cell_pressure_[cell][Fluid::Liquid]);
+            }
+            if (wells_.control(well) == Wells::Pressure) {
+                state_.well_bhp_pressure_.push_back(wells_.target(well));
+            } else {
+                int cell = wells_.wellCell(well, 0);
+                state_.well_bhp_pressure_.push_back(state_.cell_pressure_[cell][Fluid::Liquid]);
+            }
         }
+        state_.well_perf_flux_.clear();
+        state_.well_perf_flux_.resize(state_.well_perf_pressure_.size(), 0.0);
     }
-    state_.well_perf_flux_.clear();
-    state_.well_perf_flux_.resize(state_.well_perf_pressure_.size(), 0.0);
-    wells_.update(grid_.numCells(), state_.well_perf_pressure_, state_.well_perf_flux_);
+    wells_.update(model_->grid.numCells(), state_.well_perf_pressure_, state_.well_perf_flux_);
 
     // Check for unused parameters (potential typos).
     if (param.anyUnused()) {
@@ -328,14 +621,28 @@ BlackoilSimulator<Grid, Rock, Fluid, Wells, FlowSolver, TransportSolver>::
 simulate()
 {
     double voldisclimit = flow_solver_.volumeDiscrepancyLimit();
-    double stepsize = initial_stepsize_;
-    double current_time = 0.0;
-    int step = 0;
+    double stepsize = start_.stepsize;
+    double current_time = start_.current_time;
+    int step = start_.step;
     std::vector<double> face_flux;
-    State start_state;
+    State& next = next_state_;
     std::string output_name = output_dir_ + "/" + "blackoil-output";
+    typedef TimeStepControlInterface StepControl;
+    std::vector<PhaseVec> prev_sat = start_.prev_sat;
+    int num_accepted = start_.num_accepted;
+    int num_rejected = start_.num_rejected;
+    int num_pressure_iterations = 0;
+    const double cpu_start = teamCpuSeconds();
+    const double thread_cpu_start = threadCpuSeconds();
+    ScopedMetricsRegistry current_metrics(metrics_);
+    MetricsRegistry::Timer& flow_timer = metrics_.timer("flow.solve");
+    MetricsRegistry::Timer& transport_timer = metrics_.timer("transport.solve");
+    MetricsRegistry::Histogram& iterations = metrics_.histogram("flow.nonlinear_iterations");
+    MetricsRegistry::Counter& accepted_counter = metrics_.counter("steps.accepted");
+    MetricsRegistry::Counter& rejected_counter = metrics_.counter("steps.rejected");
+    const std::chrono::steady_clock::time_point wall_start = std::chrono::steady_clock::now();
     while (current_time < total_time_) {
-        start_state = state_;
+        StepControl::StepInfo info;
 
         // Do not run past total_time_.
         if (current_time + stepsize > total_time_) {
@@ -349,38 +656,55 @@ simulate()
                   << "\n" << std::endl;
 
         // Solve flow system.
-        enum FlowSolver::ReturnCode result
-            = flow_solver_.solve(state_.cell_pressure_, state_.face_pressure_, state_.cell_z_, face_flux,
-                                 state_.well_bhp_pressure_,
-                                 state_.well_perf_pressure_, state_.well_perf_flux_, src_, stepsize);
+        enum FlowSolver::ReturnCode result;
+        {
+            ScopedTimer flow_scope(flow_timer);
+            result = flow_solver_.solve(state_.cell_pressure_, state_.face_pressure_, state_.cell_z_,
+                                        state_.well_bhp_pressure_, state_.well_perf_pressure_, state_.well_perf_flux_,
+                                        next.cell_pressure_, next.face_pressure_, face_flux,
+                                        next.well_bhp_pressure_, next.well_perf_pressure_, next.well_perf_flux_,
+                                        src_, stepsize);
+        }
+        info.nonlinear_iterations = flow_solver_.numNonlinearIterations();
+        num_pressure_iterations += info.nonlinear_iterations;
+        iterations.add(info.nonlinear_iterations);
 
         // Check if the flow solver succeeded.
         if (result == FlowSolver::VolumeDiscrepancyTooLarge) {
             OPM_THROW(std::runtime_error, "Flow solver refused to run due to too large volume discrepancy.");
         } else if (result == FlowSolver::FailedToConverge) {
             std::cout << "********* Nonlinear convergence failure: Shortening (pressure) stepsize, redoing step number " << step <<" **********" << std::endl;
-            stepsize *= 0.5;
-            state_ = start_state;
-            wells_.update(grid_.numCells(), start_state.well_perf_pressure_, start_state.well_perf_flux_);
+            stepsize = step_control_->rejected(stepsize, StepControl::NonlinearFailure, info);
+            ++num_rejected;
+            rejected_counter.add();
+            // Nothing to roll back, state_ and the wells are untouched.
             continue;
         }
         assert(result == FlowSolver::SolveOk);
 
         // Update wells with new perforation pressures and fluxes.
-        wells_.update(grid_.numCells(), state_.well_perf_pressure_, state_.well_perf_flux_);
+        wells_.update(model_->grid.numCells(), next.well_perf_pressure_, next.well_perf_flux_);
+
+        // The transport solvers update z in place.
+        next.cell_z_ = state_.cell_z_;
 
         // Transport and check volume discrepancy.
         bool voldisc_ok = true;
         if (!do_impes_) {
-            double actual_computed_time
-                = transport_solver_.transport(bdy_pressure_, bdy_z_,
-                                             face_flux, state_.cell_pressure_, state_.face_pressure_,
-                                             stepsize, voldisclimit, state_.cell_z_);
+            double actual_computed_time;
+            {
+                ScopedTimer transport_scope(transport_timer);
+                actual_computed_time
+                    = transport_solver_.transport(bdy_pressure_, bdy_z_,
+                                                  face_flux, next.cell_pressure_, next.face_pressure_,
+                                                  stepsize, voldisclimit, next.cell_z_);
+            }
             voldisc_ok = (actual_computed_time == stepsize);
             if (voldisc_ok) {
-                // Just for output.
-                flow_solver_.volumeDiscrepancyAcceptable(state_.cell_pressure_, state_.face_pressure_,
-                                                         state_.well_perf_pressure_, state_.cell_z_, stepsize);
+                // Just for output (and step control).
+                flow_solver_.volumeDiscrepancyAcceptable(next.cell_pressure_, next.face_pressure_,
+                                                         next.well_perf_pressure_, next.cell_z_, stepsize);
+                info.rel_voldiscr = flow_solver_.relativeVolumeDiscrepancy();
             }
         } else {
             // First check IMPES stepsize.
@@ -391,15 +715,19 @@ simulate()
                 std::cout << "Timestep was " << stepsize << " and max stepsize was " << max_dt << std::endl;
             }
             if (stepsize < max_dt || stepsize <= minimum_stepsize_) {
-                flow_solver_.doStepIMPES(state_.cell_z_, stepsize);
-                voldisc_ok = flow_solver_.volumeDiscrepancyAcceptable(state_.cell_pressure_, state_.face_pressure_,
-                                                                      state_.well_perf_pressure_, state_.cell_z_, stepsize);
+                ScopedTimer transport_scope(transport_timer);
+                flow_solver_.doStepIMPES(next.cell_z_, stepsize);
+                voldisc_ok = flow_solver_.volumeDiscrepancyAcceptable(next.cell_pressure_, next.face_pressure_,
+                                                                      next.well_perf_pressure_, next.cell_z_, stepsize);
+                info.rel_voldiscr = flow_solver_.relativeVolumeDiscrepancy();
             } else {
                 // Restarting step.
-                stepsize = max_dt/1.5;
+                info.stable_stepsize = max_dt;
+                stepsize = step_control_->rejected(stepsize, StepControl::StabilityLimit, info);
+                ++num_rejected;
+                rejected_counter.add();
                 std::cout << "Restarting pressure step with new timestep " << stepsize << std::endl;
-                state_ = start_state;
-                wells_.update(grid_.numCells(), start_state.well_perf_pressure_, start_state.well_perf_flux_);
+                wells_.update(model_->grid.numCells(), state_.well_perf_pressure_, state_.well_perf_flux_);
                 continue;
             }
         }
@@ -407,42 +735,111 @@ simulate()
         // If discrepancy too large, redo entire pressure step.
         if (!voldisc_ok) {
             std::cout << "********* Too large volume discrepancy:  Shortening (pressure) stepsize, redoing step number " << step <<" **********" << std::endl;
-            stepsize *= 0.5;
-            state_ = start_state;
-            wells_.update(grid_.numCells(), start_state.well_perf_pressure_, start_state.well_perf_flux_);
+            stepsize = step_control_->rejected(stepsize, StepControl::VolumeDiscrepancy, info);
+            ++num_rejected;
+            rejected_counter.add();
+            wells_.update(model_->grid.numCells(), state_.well_perf_pressure_, state_.well_perf_flux_);
             continue;
         }
 
-        // Adjust time.
-        current_time += stepsize;
-        if (voldisc_ok && increase_stepsize_ && stepsize < maximum_stepsize_) {
-            stepsize *= stepsize_increase_factor_;
-            stepsize = std::min(maximum_stepsize_, stepsize);
+        // Saturation change over the step, for step control.
+        const auto& sat = flow_solver_.cellSaturations();
+        if (prev_sat.size() == sat.size()) {
+            double max_ds = 0.0;
+            for (int cell = 0; cell < int(sat.size()); ++cell) {
+                for (int phase = 0; phase < Fluid::numPhases; ++phase) {
+                    max_ds = std::max(max_ds, std::fabs(sat[cell][phase] - prev_sat[cell][phase]));
+                }
+            }
+            info.max_sat_change = max_ds;
         }
+        prev_sat.assign(sat.begin(), sat.end());
+
+        // Accept the step.
+        state_.swap(next);
+        current_time += stepsize;
+        ++num_accepted;
+        accepted_counter.add();
+        const double proposed_stepsize = step_control_->accepted(stepsize, info);
+        stepsize = proposed_stepsize;
+        const int accepted_step = step;
         // If using given timesteps, set stepsize to match.
         if (!report_times_.empty()) {
             if (current_time >= report_times_[step]) {
                 bool output_now = ((step + 1) % output_interval_ == 0);
                 if (output_now) {
-                    output(grid_, fluid_, state_, face_flux, step, output_name);
+                    output(face_flux, step, output_name);
                 }
                 ++step;
                 if (step == int(report_times_.size())) {
                     break;
                 }
             }
-            stepsize = report_times_[step] - current_time;
+            const double to_report = report_times_[step] - current_time;
+            stepsize = adapt_report_steps_ ? std::min(to_report, proposed_stepsize) : to_report;
         } else {
             bool output_now = ((step + 1) % output_interval_ == 0);
             if (output_now) {
-                output(grid_, fluid_, state_, face_flux, step, output_name);
+                output(face_flux, step, output_name);
             }
             ++step;
         }
+
+        // Checkpoint at every checkpoint_interval_'th report step.
+        if (checkpoint_interval_ > 0 && step != accepted_step && step % checkpoint_interval_ == 0) {
+            RunPosition pos;
+            pos.current_time = current_time;
+            pos.step = step;
+            pos.stepsize = stepsize;
+            pos.num_accepted = num_accepted;
+            pos.num_rejected = num_rejected;
+            pos.prev_sat = prev_sat;
+            writeCheckpoint(pos);
+        }
     }
-    if (step % output_interval_ != 0) {
+    if (step % output_interval_ != 0 && !face_flux.empty()) {
         // Output was not written at last step, write final output.
-        output(grid_, fluid_, state_, face_flux, step - 1, output_name);
+        output(face_flux, step - 1, output_name);
+    }
+    {
+        ScopedTimer output_timer(metrics_.timer("output.finish"));
+        writer_->finish();
+    }
+    metrics_.timer("simulate.total").add(std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count());
+
+    // Step control statistics.
+    const double cpu_seconds = teamCpuSeconds() - cpu_start;
+    const double thread_cpu_seconds = threadCpuSeconds() - thread_cpu_start;
+    const double days = Opm::unit::convert::to(current_time, Opm::unit::day);
+    const int num_attempts = num_accepted + num_rejected;
+    // Pressure iterations are counted from the start of this run,
+    // also when restarted from a checkpoint.
+    const int run_attempts = num_attempts - start_.num_accepted - start_.num_rejected;
+    std::cout << "\n\n================    Time step statistics    ==============="
+              << "\n      Accepted steps          " << num_accepted
+              << "\n      Rejected steps          " << num_rejected
+              << "\n      Rejection rate          " << (num_attempts > 0 ? double(num_rejected)/num_attempts : 0.0)
+              << "\n      Pressure iterations     " << num_pressure_iterations
+              << "\n      Per attempted step      " << (run_attempts > 0 ? double(num_pressure_iterations)/run_attempts : 0.0)
+              << "\n      Simulated days          " << days
+              << "\n      CPU time (s)            " << cpu_seconds
+              << "\n      Main thread CPU (s)     " << thread_cpu_seconds
+              << "\n      Days per CPU hour       " << (cpu_seconds > 0.0 ? days/(cpu_seconds/3600.0) : 0.0)
+              << "\n      (CPU time is that of the OpenMP team, including spin waiting.)"
+              << "\n" << std::endl;
+
+    if (!metrics_file_.empty()) {
+        std::map<std::string, std::string> report;
+        report["output_dir"] = output_dir_;
+        report["simulated_days"] = boost::lexical_cast<std::string>(days);
+        report["cpu_seconds"] = boost::lexical_cast<std::string>(cpu_seconds);
+        report["cpu_seconds_clock"] = "thread CPU time summed over the OpenMP team, including spin waiting";
+        report["main_thread_cpu_seconds"] = boost::lexical_cast<std::string>(thread_cpu_seconds);
+        std::ofstream os(metrics_file_.c_str());
+        if (!os) {
+            OPM_THROW(std::runtime_error, "Could not open metrics file " << metrics_file_);
+        }
+        metrics_.writeJson(os, report);
     }
 }
 
@@ -454,115 +851,178 @@ simulate()
 template<class Grid, class Rock, class Fluid, class Wells, class FlowSolver, class TransportSolver>
 void
 BlackoilSimulator<Grid, Rock, Fluid, Wells, FlowSolver, TransportSolver>::
-output(const Grid& grid,
-       const Fluid& fluid,
-       const State& simstate,
-       const std::vector<double>& face_flux,
+output(const std::vector<double>& face_flux,
        const int step,
        const std::string& filebase)
 {
-    // Compute saturations, total fluid volume density and mass fractions.
-    int num_cells = grid.numCells();
-    std::vector<typename Fluid::PhaseVec> sat(num_cells);
-    std::vector<typename Fluid::PhaseVec> mass_frac(num_cells);
-    std::vector<double> totflvol_dens(num_cells);
-    for (int cell = 0; cell < num_cells; ++cell) {
-        typename Fluid::FluidState fstate = fluid.computeState(simstate.cell_pressure_[cell], simstate.cell_z_[cell]);
-        sat[cell] = fstate.saturation_;
-        totflvol_dens[cell] = fstate.total_phase_volume_density_;
-        double totMass_dens = simstate.cell_z_[cell]*fluid.surfaceDensities();
-        mass_frac[cell][Fluid::Water] = simstate.cell_z_[cell][Fluid::Water]*fluid.surfaceDensities()[Fluid::Water]/totMass_dens;
-        mass_frac[cell][Fluid::Oil] = simstate.cell_z_[cell][Fluid::Oil]*fluid.surfaceDensities()[Fluid::Oil]/totMass_dens;
-        mass_frac[cell][Fluid::Gas] = simstate.cell_z_[cell][Fluid::Gas]*fluid.surfaceDensities()[Fluid::Gas]/totMass_dens;
-    }
-
     // Ensure directory exists.
     boost::filesystem::path fpath(filebase);
     if (fpath.has_branch_path()) {
         create_directories(fpath.branch_path());
     }
 
-    // Output to VTK.
+    // Everything touching the fluid or the simulator state is done
+    // here, the writer only formats and writes the snapshot.
+    std::shared_ptr<OutputSnapshot> snap(new OutputSnapshot);
+    snap->step = step;
+    snap->filebase = filebase;
+    {
+        ScopedTimer snapshot_timer(metrics_.timer("output.snapshot"));
+        takeSnapshot(model_->grid, model_->fluid, wells_, state_, face_flux, *snap);
+    }
+
+    const Grid& grid = model_->grid;
+    const bool vtk = output_vtk_;
+    const Dune::VTK::OutputType vtk_type = vtk_output_type_;
+    const DumpFormat dump = dump_format_;
+    // The writer may run on its own thread, so it is given the timer
+    // rather than looking it up in MetricsRegistry::current().
+    MetricsRegistry::Timer* write_timer = &metrics_.timer("output.write");
+    writer_->submit([&grid, snap, vtk, vtk_type, dump, write_timer]() {
+            ScopedTimer timer(*write_timer);
+            if (vtk) {
+                writeVtk(grid, *snap, vtk_type);
+            }
+            if (dump == TextDump) {
+                writeTextDump(*snap);
+            } else if (dump == BinaryDump) {
+                writeBinaryDump(*snap);
+            }
+        });
+}
+
+
+
+
+template<class Grid, class Rock, class Fluid, class Wells, class FlowSolver, class TransportSolver>
+void
+BlackoilSimulator<Grid, Rock, Fluid, Wells, FlowSolver, TransportSolver>::
+takeSnapshot(const Grid& grid,
+             const Fluid& fluid,
+             const Wells& wells,
+             const State& simstate,
+             const std::vector<double>& face_flux,
+             OutputSnapshot& snap)
+{
+    // Compute saturations, total fluid volume density and mass fractions.
+    const int num_cells = grid.numCells();
+    const int np = Fluid::numPhases;
+    const int nc = Fluid::numComponents;
+    snap.cell_pressure.resize(num_cells*np);
+    snap.z.resize(num_cells*nc);
+    snap.sat.resize(num_cells*np);
+    snap.mass_frac.resize(num_cells*nc);
+    snap.totflvol_dens.resize(num_cells);
+    const CompVec surf_dens = fluid.surfaceDensities();
+    for (int cell = 0; cell < num_cells; ++cell) {
+        const CompVec& z = simstate.cell_z_[cell];
+        typename Fluid::FluidState fstate = fluid.computeState(simstate.cell_pressure_[cell], z);
+        snap.totflvol_dens[cell] = fstate.total_phase_volume_density_;
+        const double totMass_dens = z*surf_dens;
+        for (int phase = 0; phase < np; ++phase) {
+            snap.cell_pressure[cell*np + phase] = simstate.cell_pressure_[cell][phase];
+            snap.sat[cell*np + phase] = fstate.saturation_[phase];
+        }
+        for (int comp = 0; comp < nc; ++comp) {
+            snap.z[cell*nc + comp] = z[comp];
+            snap.mass_frac[cell*nc + comp] = z[comp]*surf_dens[comp]/totMass_dens;
+        }
+    }
+
     std::vector<typename Grid::Vector> cell_velocity;
     Opm::estimateCellVelocitySimpleInterface(cell_velocity, grid, face_flux);
-    // Dune's vtk writer wants multi-component data to be flattened.
-    std::vector<double> cell_pressure_flat(&*simstate.cell_pressure_.front().begin(),
-                                           &*simstate.cell_pressure_.back().end());
-    std::vector<double> cell_velocity_flat(&*cell_velocity.front().begin(),
-                                           &*cell_velocity.back().end());
-    std::vector<double> z_flat(&*simstate.cell_z_.front().begin(),
-                               &*simstate.cell_z_.back().end());
-    std::vector<double> sat_flat(&*sat.front().begin(),
-                                 &*sat.back().end());
-    std::vector<double> mass_frac_flat(&*mass_frac.front().begin(),
-                                       &*mass_frac.back().end());
+    snap.cell_velocity.assign(&*cell_velocity.front().begin(),
+                              &*cell_velocity.back().end());
+
+    // Well report.
+    const typename Wells::WellReport& report = wells.wellReport();
+    const double seconds_pr_day = 3600.*24.;
+    const int num_perf = report.perfPressure.size();
+    snap.perf_cell = report.cellId;
+    snap.perf_pressure = report.perfPressure;
+    snap.perf_cell_pressure = report.cellPressure;
+    snap.perf_mass_rate.resize(num_perf*nc);
+    for (int perf = 0; perf < num_perf; ++perf) {
+        for (int comp = 0; comp < nc; ++comp) {
+            snap.perf_mass_rate[perf*nc + comp] = seconds_pr_day*report.massRate[perf][comp];
+        }
+    }
+}
+
+
+
+
+template<class Grid, class Rock, class Fluid, class Wells, class FlowSolver, class TransportSolver>
+void
+BlackoilSimulator<Grid, Rock, Fluid, Wells, FlowSolver, TransportSolver>::
+writeVtk(const Grid& grid,
+         const OutputSnapshot& snap,
+         const Dune::VTK::OutputType type)
+{
 #if DUNE_VERSION_NEWER(DUNE_GRID, 2, 3)
     Dune::VTKWriter<typename Grid::LeafGridView> vtkwriter(grid.leafGridView());
 #else
     Dune::VTKWriter<typename Grid::LeafGridView> vtkwriter(grid.leafView());
 #endif
-    vtkwriter.addCellData(cell_pressure_flat, "pressure", Fluid::numPhases);
-    vtkwriter.addCellData(cell_velocity_flat, "velocity", Grid::dimension);
-    vtkwriter.addCellData(z_flat, "z", Fluid::numComponents);
-    vtkwriter.addCellData(sat_flat, "sat", Fluid::numPhases);
-    vtkwriter.addCellData(mass_frac_flat, "massFrac", Fluid::numComponents);
-    vtkwriter.addCellData(totflvol_dens, "total fl. vol.");
-    vtkwriter.write(filebase + '-' + boost::lexical_cast<std::string>(step),
-                    Dune::VTK::ascii);
-
-    // Dump data for Matlab.
-    std::vector<double> zv[Fluid::numComponents];
-    for (int comp = 0; comp < Fluid::numComponents; ++comp) {
-        zv[comp].resize(grid.numCells());
-        for (int cell = 0; cell < grid.numCells(); ++cell) {
-            zv[comp][cell] = simstate.cell_z_[cell][comp];
-        }
-    }
-    std::vector<double> sv[Fluid::numPhases];
-    for (int phase = 0; phase < Fluid::numPhases; ++phase) {
-        sv[phase].resize(grid.numCells());
-        for (int cell = 0; cell < grid.numCells(); ++cell) {
-            sv[phase][cell] = sat[cell][phase];
-        }
-    }
-    std::string matlabdumpname(filebase + "-");
-    matlabdumpname += boost::lexical_cast<std::string>(step);
+    vtkwriter.addCellData(snap.cell_pressure, "pressure", Fluid::numPhases);
+    vtkwriter.addCellData(snap.cell_velocity, "velocity", Grid::dimension);
+    vtkwriter.addCellData(snap.z, "z", Fluid::numComponents);
+    vtkwriter.addCellData(snap.sat, "sat", Fluid::numPhases);
+    vtkwriter.addCellData(snap.mass_frac, "massFrac", Fluid::numComponents);
+    vtkwriter.addCellData(snap.totflvol_dens, "total fl. vol.");
+    vtkwriter.write(snap.filebase + '-' + boost::lexical_cast<std::string>(snap.step), type);
+}
+
+
+
+
+// Text dump for Matlab, one row per field (liquid pressure, z, s and
+// total fluid volume), followed by the well report.
+template<class Grid, class Rock, class Fluid, class Wells, class FlowSolver, class TransportSolver>
+void
+BlackoilSimulator<Grid, Rock, Fluid, Wells, FlowSolver, TransportSolver>::
+writeTextDump(const OutputSnapshot& snap)
+{
+    const int num_cells = snap.totflvol_dens.size();
+    const int np = Fluid::numPhases;
+    const int nc = Fluid::numComponents;
+    std::string matlabdumpname(snap.filebase + "-");
+    matlabdumpname += boost::lexical_cast<std::string>(snap.step);
     matlabdumpname += ".dat";
     std::ofstream dump(matlabdumpname.c_str());
     dump.precision(15);
-    std::vector<double> liq_press(num_cells);
+    // Liquid phase pressure.
     for (int cell = 0; cell < num_cells; ++cell) {
-        liq_press[cell] = simstate.cell_pressure_[cell][Fluid::Liquid];
+        dump << snap.cell_pressure[cell*np + Fluid::Liquid] << ' ';
     }
-    // Liquid phase pressure.
-    std::copy(liq_press.begin(), liq_press.end(),
-              std::ostream_iterator<double>(dump, " "));
     dump << '\n';
     // z (3 components)
-    for (int comp = 0; comp < Fluid::numComponents; ++comp) {
-        std::copy(zv[comp].begin(), zv[comp].end(),
-                  std::ostream_iterator<double>(dump, " "));
+    for (int comp = 0; comp < nc; ++comp) {
+        for (int cell = 0; cell < num_cells; ++cell) {
+            dump << snap.z[cell*nc + comp] << ' ';
+        }
         dump << '\n';
     }
     // s (3 components)
-    for (int phase = 0; phase < Fluid::numPhases; ++phase) {
-        std::copy(sv[phase].begin(), sv[phase].end(),
-                  std::ostream_iterator<double>(dump, " "));
+    for (int phase = 0; phase < np; ++phase) {
+        for (int cell = 0; cell < num_cells; ++cell) {
+            dump << snap.sat[cell*np + phase] << ' ';
+        }
         dump << '\n';
     }
     // Total fluid volume
-    std::copy(totflvol_dens.begin(), totflvol_dens.end(),
-              std::ostream_iterator<double>(dump, " "));
-    dump << '\n'; 
+    for (int cell = 0; cell < num_cells; ++cell) {
+        dump << snap.totflvol_dens[cell] << ' ';
+    }
+    dump << '\n';
     // Well report ...
-    const double seconds_pr_day = 3600.*24.;
-    for (unsigned int perf=0; perf<Wells::WellReport::report()->perfPressure.size(); ++perf) {
-      dump << std::setw(8) << Wells::WellReport::report()->cellId[perf] << " "
-           << std::setw(22) << Wells::WellReport::report()->perfPressure[perf] << " "
-           << std::setw(22) << Wells::WellReport::report()->cellPressure[perf] << " "
-           << std::setw(22) << seconds_pr_day*Wells::WellReport::report()->massRate[perf][Fluid::Water] << " "
-           << std::setw(22) << seconds_pr_day*Wells::WellReport::report()->massRate[perf][Fluid::Oil] << " "
-           << std::setw(22) << seconds_pr_day*Wells::WellReport::report()->massRate[perf][Fluid::Gas] << '\n';
+    for (int perf = 0; perf < int(snap.perf_pressure.size()); ++perf) {
+      dump << std::setw(8) << snap.perf_cell[perf] << " "
+           << std::setw(22) << snap.perf_pressure[perf] << " "
+           << std::setw(22) << snap.perf_cell_pressure[perf] << " "
+           << std::setw(22) << snap.perf_mass_rate[perf*nc + Fluid::Water] << " "
+           << std::setw(22) << snap.perf_mass_rate[perf*nc + Fluid::Oil] << " "
+           << std::setw(22) << snap.perf_mass_rate[perf*nc + Fluid::Gas] << '\n';
     }
     dump << '\n';
 }
@@ -570,6 +1030,266 @@ output(const Grid& grid,
 
 
 
+// Binary columnar dump, replacing the text dump. Layout, in native byte
+// order:
+//     char[8] "OPMCOL1" (nul-terminated)
+//     int32   number of tables
+//     per table:
+//         int32 name length, name
+//         int32 number of rows, int32 number of columns
+//         per column: int32 name length, name, rows x float64
+// Table "cells" holds pressure (liquid), z_w, z_o, z_g, s_w, s_o, s_g and
+// totflvol, table "perforations" the well report (rates per day).
+template<class Grid, class Rock, class Fluid, class Wells, class FlowSolver, class TransportSolver>
+void
+BlackoilSimulator<Grid, Rock, Fluid, Wells, FlowSolver, TransportSolver>::
+writeBinaryDump(const OutputSnapshot& snap)
+{
+    const int num_cells = snap.totflvol_dens.size();
+    const int num_perf = snap.perf_pressure.size();
+    const int np = Fluid::numPhases;
+    const int nc = Fluid::numComponents;
+    std::string dumpname(snap.filebase + "-");
+    dumpname += boost::lexical_cast<std::string>(snap.step);
+    dumpname += ".bin";
+    std::ofstream dump(dumpname.c_str(), std::ios::binary);
+    if (!dump) {
+        OPM_THROW(std::runtime_error, "Could not open " << dumpname << " for writing.");
+    }
+
+    struct Put
+    {
+        std::ofstream& os;
+        void integer(const int i) { const std::int32_t v = i; os.write(reinterpret_cast<const char*>(&v), sizeof v); }
+        void name(const std::string& n) { integer(n.size()); os.write(n.data(), n.size()); }
+        // Column from a strided array.
+        void column(const std::string& n, const double* data, const int rows, const int stride)
+        {
+            name(n);
+            std::vector<double> col(rows);
+            for (int i = 0; i < rows; ++i) {
+                col[i] = data[i*stride];
+            }
+            os.write(reinterpret_cast<const char*>(col.data()), rows*sizeof(double));
+        }
+    } put = { dump };
+
+    const char magic[8] = "OPMCOL1";
+    dump.write(magic, sizeof magic);
+    put.integer(2);
+
+    put.name("cells");
+    put.integer(num_cells);
+    put.integer(1 + nc + np + 1);
+    put.column("pressure", snap.cell_pressure.data() + Fluid::Liquid, num_cells, np);
+    const char* comp_names[] = { "z_w", "z_o", "z_g" };
+    for (int comp = 0; comp < nc; ++comp) {
+        put.column(comp_names[comp], snap.z.data() + comp, num_cells, nc);
+    }
+    const char* phase_names[] = { "s_w", "s_o", "s_g" };
+    for (int phase = 0; phase < np; ++phase) {
+        put.column(phase_names[phase], snap.sat.data() + phase, num_cells, np);
+    }
+    put.column("totflvol", snap.totflvol_dens.data(), num_cells, 1);
+
+    std::vector<double> perf_cell(snap.perf_cell.begin(), snap.perf_cell.end());
+    put.name("perforations");
+    put.integer(num_perf);
+    put.integer(3 + nc);
+    put.column("cell", perf_cell.data(), num_perf, 1);
+    put.column("perf_pressure", snap.perf_pressure.data(), num_perf, 1);
+    put.column("cell_pressure", snap.perf_cell_pressure.data(), num_perf, 1);
+    const char* rate_names[] = { "rate_w", "rate_o", "rate_g" };
+    for (int comp = 0; comp < nc; ++comp) {
+        put.column(rate_names[comp], snap.perf_mass_rate.data() + comp, num_perf, nc);
+    }
+    if (!dump) {
+        OPM_THROW(std::runtime_error, "Error writing " << dumpname);
+    }
+}
+
+
+
+
+// Checkpoint file layout (version 1), in native byte order:
+//     char[8] "OPMCKPT" (nul-terminated)
+//     int32   version
+//     int32   cells, faces, wells, perforations, phases, components
+//     float64 current time, next stepsize
+//     int32   report step, accepted steps, rejected steps
+//     arrays, each as int64 length followed by the float64 values:
+//         cell pressure, face pressure, initial face pressure, cell z,
+//         well bhp, perforation pressure, perforation flux,
+//         saturations at the last accepted step, step control state.
+// The file is written under a temporary name and then renamed, so that
+// a crash while writing leaves the previous checkpoint intact.
+template<class Grid, class Rock, class Fluid, class Wells, class FlowSolver, class TransportSolver>
+void
+BlackoilSimulator<Grid, Rock, Fluid, Wells, FlowSolver, TransportSolver>::
+writeCheckpoint(const RunPosition& pos) const
+{
+    // Do not let pending output overtake the checkpoint.
+    writer_->wait();
+    boost::filesystem::path dir(output_dir_);
+    create_directories(dir);
+    const std::string filename = output_dir_ + "/blackoil-checkpoint-"
+        + boost::lexical_cast<std::string>(pos.step) + ".ckp";
+    const std::string tmpname = filename + ".tmp";
+    std::ofstream os(tmpname.c_str(), std::ios::binary);
+    if (!os) {
+        OPM_THROW(std::runtime_error, "Could not open " << tmpname << " for writing.");
+    }
+
+    struct Put
+    {
+        std::ofstream& os;
+        void integer(const int i) { const std::int32_t v = i; os.write(reinterpret_cast<const char*>(&v), sizeof v); }
+        void real(const double d) { os.write(reinterpret_cast<const char*>(&d), sizeof d); }
+        void array(const double* data, const std::size_t n)
+        {
+            const std::int64_t len = n;
+            os.write(reinterpret_cast<const char*>(&len), sizeof len);
+            os.write(reinterpret_cast<const char*>(data), n*sizeof(double));
+        }
+        void array(const std::vector<double>& v) { array(v.data(), v.size()); }
+    } put = { os };
+
+    const char magic[8] = "OPMCKPT";
+    os.write(magic, sizeof magic);
+    put.integer(1);
+    put.integer(model_->grid.numCells());
+    put.integer(model_->grid.numFaces());
+    put.integer(state_.well_bhp_pressure_.size());
+    put.integer(state_.well_perf_pressure_.size());
+    put.integer(Fluid::numPhases);
+    put.integer(Fluid::numComponents);
+    put.real(pos.current_time);
+    put.real(pos.stepsize);
+    put.integer(pos.step);
+    put.integer(pos.num_accepted);
+    put.integer(pos.num_rejected);
+    put.array(flatten(state_.cell_pressure_));
+    put.array(flatten(state_.face_pressure_));
+    put.array(flatten(initial_face_pressure_));
+    put.array(flatten(state_.cell_z_));
+    put.array(state_.well_bhp_pressure_);
+    put.array(state_.well_perf_pressure_);
+    put.array(state_.well_perf_flux_);
+    put.array(flatten(pos.prev_sat));
+    put.array(step_control_->state());
+    os.close();
+    if (!os) {
+        OPM_THROW(std::runtime_error, "Error writing " << tmpname);
+    }
+    if (std::rename(tmpname.c_str(), filename.c_str()) != 0) {
+        OPM_THROW(std::runtime_error, "Could not rename " << tmpname << " to " << filename);
+    }
+    std::cout << "Wrote checkpoint " << filename << std::endl;
+}
+
+
+
+
+template<class Grid, class Rock, class Fluid, class Wells, class FlowSolver, class TransportSolver>
+void
+BlackoilSimulator<Grid, Rock, Fluid, Wells, FlowSolver, TransportSolver>::
+readCheckpoint(const std::string& filename)
+{
+    std::ifstream is(filename.c_str(), std::ios::binary);
+    if (!is) {
+        OPM_THROW(std::runtime_error, "Could not open checkpoint " << filename);
+    }
+
+    struct Get
+    {
+        std::ifstream& is;
+        const std::string& filename;
+        void check()
+        {
+            if (!is) {
+                OPM_THROW(std::runtime_error, "Checkpoint " << filename << " is truncated.");
+            }
+        }
+        int integer() { std::int32_t v = 0; is.read(reinterpret_cast<char*>(&v), sizeof v); check(); return v; }
+        double real() { double d = 0.0; is.read(reinterpret_cast<char*>(&d), sizeof d); check(); return d; }
+        void array(std::vector<double>& v)
+        {
+            std::int64_t len = 0;
+            is.read(reinterpret_cast<char*>(&len), sizeof len);
+            check();
+            if (len < 0 || len > (std::int64_t(1) << 40)) {
+                OPM_THROW(std::runtime_error, "Checkpoint " << filename << " is corrupt.");
+            }
+            v.resize(len);
+            is.read(reinterpret_cast<char*>(v.data()), len*sizeof(double));
+            check();
+        }
+    } get = { is, filename };
+
+    char magic[8];
+    is.read(magic, sizeof magic);
+    get.check();
+    if (std::string(magic, 7) != "OPMCKPT") {
+        OPM_THROW(std::runtime_error, filename << " is not a checkpoint file.");
+    }
+    const int version = get.integer();
+    if (version != 1) {
+        OPM_THROW(std::runtime_error, "Unsupported checkpoint version " << version << " in " << filename);
+    }
+    int num_perf = 0;
+    for (int well = 0; well < wells_.numWells(); ++well) {
+        num_perf += wells_.numPerforations(well);
+    }
+    const int num_cells = model_->grid.numCells();
+    const int num_faces = model_->grid.numFaces();
+    const int sizes[6] = { num_cells, num_faces, wells_.numWells(), num_perf,
+                           Fluid::numPhases, Fluid::numComponents };
+    for (int i = 0; i < 6; ++i) {
+        if (get.integer() != sizes[i]) {
+            OPM_THROW(std::runtime_error, "Checkpoint " << filename << " was written for a different case.");
+        }
+    }
+    start_.current_time = get.real();
+    start_.stepsize = get.real();
+    start_.step = get.integer();
+    start_.num_accepted = get.integer();
+    start_.num_rejected = get.integer();
+    if (!report_times_.empty() && start_.step >= int(report_times_.size())) {
+        OPM_THROW(std::runtime_error, "Checkpoint " << filename << " is past the last report time.");
+    }
+    std::vector<double> flat[4];
+    for (int i = 0; i < 4; ++i) {
+        get.array(flat[i]);
+    }
+    if (!unflatten(flat[0], state_.cell_pressure_) || int(state_.cell_pressure_.size()) != num_cells
+        || !unflatten(flat[1], state_.face_pressure_) || int(state_.face_pressure_.size()) != num_faces
+        || !unflatten(flat[2], initial_face_pressure_) || int(initial_face_pressure_.size()) != num_faces
+        || !unflatten(flat[3], state_.cell_z_) || int(state_.cell_z_.size()) != num_cells) {
+        OPM_THROW(std::runtime_error, "Checkpoint " << filename << " does not match the grid.");
+    }
+    get.array(state_.well_bhp_pressure_);
+    get.array(state_.well_perf_pressure_);
+    get.array(state_.well_perf_flux_);
+    if (int(state_.well_bhp_pressure_.size()) != wells_.numWells()
+        || int(state_.well_perf_pressure_.size()) != num_perf
+        || int(state_.well_perf_flux_.size()) != num_perf) {
+        OPM_THROW(std::runtime_error, "Checkpoint " << filename << " does not match the wells.");
+    }
+    std::vector<double> prev_sat;
+    get.array(prev_sat);
+    if (!unflatten(prev_sat, start_.prev_sat)) {
+        OPM_THROW(std::runtime_error, "Checkpoint " << filename << " is corrupt.");
+    }
+    std::vector<double> step_control_state;
+    get.array(step_control_state);
+    step_control_->setState(step_control_state);
+    std::cout << "Restarting from " << filename << " at step " << start_.step << ", time (days) "
+              << Opm::unit::convert::to(start_.current_time, Opm::unit::day) << std::endl;
+}
+
+
+
+
 
 } // namespace Opm
 
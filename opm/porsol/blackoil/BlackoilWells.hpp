@@ -27,6 +27,8 @@
 #include <opm/porsol/common/Rock.hpp>
 #include <opm/parser/eclipse/Deck/Deck.hpp>
 #include <dune/common/fvector.hh>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <iostream>
 
@@ -63,17 +65,24 @@ namespace Opm
         double perforationPressure(int cell) const;
         double wellToReservoirFlux(int cell) const;
         CompVec injectionMixture(int cell) const;
+
+        // Perforation-centric interface, for iterating over the
+        // perforations without scanning all cells. Rebuilt by update().
+        struct Perforation
+        {
+            int cell;
+            double flux;         // Well to reservoir flux.
+            double pressure;     // Perforation pressure.
+            CompVec injection_mixture;
+        };
+        const std::vector<Perforation>& perforations() const;
    
-        // Simple well report ...
+        // Simple well report, filled in by the transport solver.
+        // There is one per BlackoilWells object (rather than one per
+        // process), so that several simulators may run concurrently.
         class WellReport
         {
         public:
-            static WellReport* report()
-            {
-                if (well_report_ == 0x0)
-                  well_report_ = new WellReport;
-                return well_report_;
-            }
             void clearAll()
             {
                 perfPressure.clear();
@@ -85,16 +94,20 @@ namespace Opm
             std::vector<double> cellPressure;
             std::vector<BlackoilDefs::CompVec>  massRate; // (surface volumes)
             std::vector<int> cellId;
-        protected:
-            WellReport() {}
-        private:
-            static WellReport* well_report_;
         };
+        WellReport& wellReport() const;
 
     private:
-	// Use the Peaceman well model to compute well indices
+	// Indices of the wells matching a well name from the deck, where
+	// a trailing '*' matches any suffix.
+	void matchingWells(const std::string& name, std::vector<int>& wells) const;
+
+	// Use the Peaceman well model to compute well indices. The
+	// equivalent radius r0 is returned for checking against radius,
+	// the caller reports if the well radius is too big.
 	double computeWellIndex(double radius, const Dune::FieldVector<double, 3>& cubical,
-				const Opm::Rock<3>::PermTensor& permeability, double skin_factor) const;
+				const Opm::Rock<3>::PermTensor& permeability, double skin_factor,
+				double& r0) const;
 
 	struct WellData { WellType type; WellControl control; double target; double reference_bhp_depth; };
         std::vector<WellData> well_data_;
@@ -102,12 +115,15 @@ namespace Opm
         Opm::SparseTable<PerfData> perf_data_;
         std::vector<double> well_cell_flux_;
         std::vector<double> well_cell_pressure_;
+        std::vector<Perforation> perforations_;
         Dune::FieldVector<double, 3> injection_mixture_;
 	std::vector<std::string> well_names_;
+        // Well indices by name (names need not be unique).
+        std::unordered_map<std::string, std::vector<int> > well_lookup_;
+        // Not part of the well state, written through const objects.
+        mutable WellReport well_report_;
     };
 
-    BlackoilWells::WellReport* BlackoilWells::WellReport::well_report_ = 0x0;
-
     // ------------ Method implementations --------------
 
 
@@ -152,66 +168,93 @@ namespace Opm
     }
 
 	// Get COMPDAT data   
+    well_lookup_.clear();
+    for (int wix = 0; wix < num_welspecs; ++wix) {
+        well_lookup_[well_names_[wix]].push_back(wix);
+    }
+    // global_cell is a map from compressed cells to Cartesian grid cells,
+    // invert it once (-1 for inactive cells).
+    const std::vector<int>& global_cell = grid.globalCell();
+    const std::array<int, 3>& cpgdim = grid.logicalCartesianSize();
+    std::vector<int> cartesian_to_compressed(cpgdim[0]*cpgdim[1]*cpgdim[2], -1);
+    for (int i = 0; i < int(global_cell.size()); ++i) {
+        cartesian_to_compressed[global_cell[i]] = i;
+    }
+    // Gather all perforations first, and then compute the well indices
+    // that were not given in parallel.
+    struct PerfInput { int well; double radius; double skin; };
+    std::vector<PerfData> perfs;
+    std::vector<PerfInput> perf_inputs;
     const auto& compdatKeyword = deck->getKeyword("COMPDAT");
 	const int num_compdats  = compdatKeyword.size();
-    std::vector<std::vector<PerfData> > wellperf_data(num_welspecs);
+    std::vector<int> matches;
 	for (int kw=0; kw<num_compdats; ++kw) {
         const auto& compdatRecord = compdatKeyword.getRecord(kw);
-	    std::string name = compdatRecord.getItem("WELL").get< std::string >(0);
-	    std::string::size_type len = name.find('*');
-	    if (len != std::string::npos) {
-		name = name.substr(0, len);
-	    }
-
-	    // global_cell is a map from compressed cells to Cartesian grid cells 
-	    const std::vector<int>& global_cell = grid.globalCell();
-	    const std::array<int, 3>& cpgdim = grid.logicalCartesianSize();
-	    std::map<int,int> cartesian_to_compressed;
-	    for (int i=0; i<int(global_cell.size()); ++i) {
-		cartesian_to_compressed.insert(std::make_pair(global_cell[i], i));
+	    matchingWells(compdatRecord.getItem("WELL").get< std::string >(0), matches);
+	    if (matches.empty()) {
+            OPM_THROW(std::runtime_error, "Undefined well name: " << compdatRecord.getItem("WELL").get< std::string >(0)
+                      << " in COMPDAT");
 	    }
-	    bool found = false;
-	    for (int wix=0; wix<num_welspecs; ++wix) {
-		if (well_names_[wix].compare(0,len, name) == 0) { //equal
-		    int ix = compdatRecord.getItem("I").get< int >(0) - 1;
-		    int jy = compdatRecord.getItem("J").get< int >(0) - 1;
-		    int kz1 = compdatRecord.getItem("K1").get< int >(0) - 1;
-		    int kz2 = compdatRecord.getItem("K2").get< int >(0) - 1;
-            for (int kz = kz1; kz <= kz2; ++kz) {
-                int cart_grid_indx = ix + cpgdim[0]*(jy + cpgdim[1]*kz);
-                std::map<int, int>::const_iterator cgit = 
-                    cartesian_to_compressed.find(cart_grid_indx);
-                if (cgit == cartesian_to_compressed.end()) {
-                    OPM_THROW(std::runtime_error, "Cell with i,j,k indices " << ix << ' ' << jy << ' '
-                              << kz << " not found!");
-                }
-                int cell = cgit->second;
-                PerfData pd;
-                pd.cell = cell;
-                if (compdatRecord.getItem("CF").getSIDouble(0) > 0.0) {
-                    pd.well_index = compdatRecord.getItem("CF").getSIDouble(0);
-                } else {
-                    double radius = 0.5*compdatRecord.getItem("DIAMETER").getSIDouble(0);
-                    if (radius <= 0.0) {
-                        radius = 0.5*unit::feet;
-                        OPM_MESSAGE("Warning: Well bore internal radius set to " << radius);
-                    }
-                    Dune::FieldVector<double, 3> cubical = getCubeDim(grid, cell);
-                    const Rock<3>::PermTensor permeability = rock.permeability(cell);  
-                    pd.well_index = computeWellIndex(radius, cubical, permeability,
-                                                     compdatRecord.getItem("SKIN").getSIDouble(0));
-                }
-                wellperf_data[wix].push_back(pd);
+        // With wildcards, the perforations go to the first matching well.
+        PerfInput input;
+        input.well = matches[0];
+        input.radius = -1.0;
+        input.skin = 0.0;
+        const double cf = compdatRecord.getItem("CF").getSIDouble(0);
+        if (!(cf > 0.0)) {
+            input.radius = 0.5*compdatRecord.getItem("DIAMETER").getSIDouble(0);
+            if (input.radius <= 0.0) {
+                input.radius = 0.5*unit::feet;
+                OPM_MESSAGE("Warning: Well bore internal radius set to " << input.radius);
             }
-            found = true;
-            break;
+            input.skin = compdatRecord.getItem("SKIN").getSIDouble(0);
         }
+        int ix = compdatRecord.getItem("I").get< int >(0) - 1;
+        int jy = compdatRecord.getItem("J").get< int >(0) - 1;
+        int kz1 = compdatRecord.getItem("K1").get< int >(0) - 1;
+        int kz2 = compdatRecord.getItem("K2").get< int >(0) - 1;
+        for (int kz = kz1; kz <= kz2; ++kz) {
+            int cell = -1;
+            if (ix >= 0 && ix < cpgdim[0] && jy >= 0 && jy < cpgdim[1] && kz >= 0 && kz < cpgdim[2]) {
+                cell = cartesian_to_compressed[ix + cpgdim[0]*(jy + cpgdim[1]*kz)];
+            }
+            if (cell < 0) {
+                OPM_THROW(std::runtime_error, "Cell with i,j,k indices " << ix << ' ' << jy << ' '
+                          << kz << " not found!");
+            }
+            PerfData pd;
+            pd.cell = cell;
+            pd.well_index = cf;
+            perfs.push_back(pd);
+            perf_inputs.push_back(input);
         }
-	    if (!found) {
-            OPM_THROW(std::runtime_error, "Undefined well name: " << compdatRecord.getItem("WELL").get< std::string >(0)
-                      << " in COMPDAT");
-	    }
 	}
+    const int num_perfs = perfs.size();
+    // Equivalent radius of each perforation, for the check below.
+    std::vector<double> perf_r0(num_perfs, 0.0);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int perf = 0; perf < num_perfs; ++perf) {
+        const PerfInput& input = perf_inputs[perf];
+        if (input.radius > 0.0) {
+            const int cell = perfs[perf].cell;
+            Dune::FieldVector<double, 3> cubical = getCubeDim(grid, cell);
+            const Rock<3>::PermTensor permeability = rock.permeability(cell);
+            perfs[perf].well_index = computeWellIndex(input.radius, cubical, permeability, input.skin,
+                                                      perf_r0[perf]);
+        }
+    }
+    for (int perf = 0; perf < num_perfs; ++perf) {
+        const double radius = perf_inputs[perf].radius;
+        if (radius > 0.0 && perf_r0[perf] < radius) {
+            std::cout << "ERROR: Too big well radius detected in cell " << perfs[perf].cell << ". "
+                      << "Specified well radius is " << radius
+                      << " while r0 is " << perf_r0[perf] << ".\n";
+        }
+    }
+    std::vector<std::vector<PerfData> > wellperf_data(num_welspecs);
+    for (int perf = 0; perf < num_perfs; ++perf) {
+        wellperf_data[perf_inputs[perf].well].push_back(perfs[perf]);
+    }
         for (int w = 0; w < num_welspecs; ++w) {
             perf_data_.appendRow(wellperf_data[w].begin(), wellperf_data[w].end());
             if (well_data_[w].reference_bhp_depth == -1e100) {
@@ -234,59 +277,52 @@ namespace Opm
             int injector_component = -1;
             for (int kw=0; kw<num_wconinjes; ++kw) {
                 const auto& wconinjeRecord = wconinjeKeyword.getRecord(kw);
-                std::string name = wconinjeRecord.getItem("WELL").get< std::string >(0);
-                std::string::size_type len = name.find('*');
-                if (len != std::string::npos) {
-                    name = name.substr(0, len);
-                }
-
-                bool well_found = false;
-                for (int wix=0; wix<num_welspecs; ++wix) {
-                    if (well_names_[wix].compare(0,len, name) == 0) { //equal
-                        well_found = true;
-                        well_data_[wix].type = Injector;
-                        int m = inje_control_mode(wconinjeRecord.getItem("CMODE").get< std::string >(0));
-                        switch(m) {
-                        case 0:  // RATE
-                            well_data_[wix].control = Rate;
-                            // TODO: convert rate to SI!
-                            well_data_[wix].target = wconinjeRecord.getItem("RATE").get< double >(0);
-                            break;
-                        case 1:  // RESV
-                            well_data_[wix].control = Rate;
-                            // TODO: convert rate to SI!
-                            well_data_[wix].target = wconinjeRecord.getItem("RESV").get< double >(0);
-                            break;
-                        case 2:  // BHP
-                            well_data_[wix].control = Pressure;
-                            well_data_[wix].target = wconinjeRecord.getItem("BHP").getSIDouble(0);
-                            break;
-                        case 3:  // THP
-                            well_data_[wix].control = Pressure;
-                            well_data_[wix].target = wconinjeRecord.getItem("THP").getSIDouble(0);
-                            break;
-                        default:
-                            OPM_THROW(std::runtime_error, "Unknown well control mode; WCONIJE  = "
-                                  << wconinjeRecord.getItem("CMODE").get< std::string >(0)
-                                  << " in input file");
-                        }
-                        int itp = -1;
-                        if (wconinjeRecord.getItem("TYPE").get< std::string >(0) == "WATER") {
-                            itp = Water;
-                        } else if (wconinjeRecord.getItem("TYPE").get< std::string >(0) == "OIL") {
-                            itp = Oil;
-                        } else if (wconinjeRecord.getItem("TYPE").get< std::string >(0) == "GAS") {
-                            itp = Gas;
-                        }
-                        if (itp == -1 || (injector_component != -1 && itp != injector_component)) {
-                            if (itp == -1) {
-                                OPM_THROW(std::runtime_error, "Error in injector specification, found no known fluid type.");
-                            } else {
-                                OPM_THROW(std::runtime_error, "Error in injector specification, we can only handle a single injection fluid.");
-                            }
+                matchingWells(wconinjeRecord.getItem("WELL").get< std::string >(0), matches);
+                const bool well_found = !matches.empty();
+                for (int k = 0; k < int(matches.size()); ++k) {
+                    const int wix = matches[k];
+                    well_data_[wix].type = Injector;
+                    int m = inje_control_mode(wconinjeRecord.getItem("CMODE").get< std::string >(0));
+                    switch(m) {
+                    case 0:  // RATE
+                        well_data_[wix].control = Rate;
+                        // TODO: convert rate to SI!
+                        well_data_[wix].target = wconinjeRecord.getItem("RATE").get< double >(0);
+                        break;
+                    case 1:  // RESV
+                        well_data_[wix].control = Rate;
+                        // TODO: convert rate to SI!
+                        well_data_[wix].target = wconinjeRecord.getItem("RESV").get< double >(0);
+                        break;
+                    case 2:  // BHP
+                        well_data_[wix].control = Pressure;
+                        well_data_[wix].target = wconinjeRecord.getItem("BHP").getSIDouble(0);
+                        break;
+                    case 3:  // THP
+                        well_data_[wix].control = Pressure;
+                        well_data_[wix].target = wconinjeRecord.getItem("THP").getSIDouble(0);
+                        break;
+                    default:
+                        OPM_THROW(std::runtime_error, "Unknown well control mode; WCONIJE  = "
+                              << wconinjeRecord.getItem("CMODE").get< std::string >(0)
+                              << " in input file");
+                    }
+                    int itp = -1;
+                    if (wconinjeRecord.getItem("TYPE").get< std::string >(0) == "WATER") {
+                        itp = Water;
+                    } else if (wconinjeRecord.getItem("TYPE").get< std::string >(0) == "OIL") {
+                        itp = Oil;
+                    } else if (wconinjeRecord.getItem("TYPE").get< std::string >(0) == "GAS") {
+                        itp = Gas;
+                    }
+                    if (itp == -1 || (injector_component != -1 && itp != injector_component)) {
+                        if (itp == -1) {
+                            OPM_THROW(std::runtime_error, "Error in injector specification, found no known fluid type.");
                         } else {
-                            injector_component = itp;
+                            OPM_THROW(std::runtime_error, "Error in injector specification, we can only handle a single injection fluid.");
                         }
+                    } else {
+                        injector_component = itp;
                     }
                 }
                 if (!well_found) {
@@ -313,52 +349,45 @@ namespace Opm
             const int num_wconprods = wconprodKeyword.size();
             for (int kw=0; kw<num_wconprods; ++kw) {
                 const auto& wconprodRecord = wconprodKeyword.getRecord(kw);
-                std::string name = wconprodRecord.getItem("WELL").get< std::string >(0);
-                std::string::size_type len = name.find('*');
-                if (len != std::string::npos) {
-                    name = name.substr(0, len);
-                }
-
-                bool well_found = false;
-                for (int wix=0; wix<num_welspecs; ++wix) {
-                    if (well_names_[wix].compare(0,len, name) == 0) { //equal
-                        well_found = true;
-                        well_data_[wix].type = Producer;
-                        int m = prod_control_mode(wconprodRecord.getItem("CMODE").get< std::string >(0));
-                        switch(m) {
-                        case 0:  // ORAT
-                            well_data_[wix].control = Rate;
-                            well_data_[wix].target = wconprodRecord.getItem("ORAT").getSIDouble(0);
-                            break;
-                        case 1:  // WRAT
-                            well_data_[wix].control = Rate;
-                            well_data_[wix].target = wconprodRecord.getItem("WRAT").getSIDouble(0);
-                            break;
-                        case 2:  // GRAT
-                            well_data_[wix].control = Rate;
-                            well_data_[wix].target = wconprodRecord.getItem("GRAT").getSIDouble(0);
-                            break;
-                        case 3:  // LRAT
-                            well_data_[wix].control = Rate;
-                            well_data_[wix].target = wconprodRecord.getItem("LRAT").getSIDouble(0);
-                            break;
-                        case 4:  // RESV 
-                            well_data_[wix].control = Rate;
-                            well_data_[wix].target = wconprodRecord.getItem("RESV").getSIDouble(0);
-                            break;
-                        case 5:  // BHP
-                            well_data_[wix].control = Pressure; 
-                            well_data_[wix].target = wconprodRecord.getItem("BHP").getSIDouble(0);
-                            break;
-                        case 6:  // THP 
-                            well_data_[wix].control = Pressure;
-                            well_data_[wix].target = wconprodRecord.getItem("THP").getSIDouble(0);
-                            break;
-                        default:
-                            OPM_THROW(std::runtime_error, "Unknown well control mode; WCONPROD  = "
-                                      << wconprodRecord.getItem("CMODE").get< std::string >(0)
-                                      << " in input file");
-                        }
+                matchingWells(wconprodRecord.getItem("WELL").get< std::string >(0), matches);
+                const bool well_found = !matches.empty();
+                for (int k = 0; k < int(matches.size()); ++k) {
+                    const int wix = matches[k];
+                    well_data_[wix].type = Producer;
+                    int m = prod_control_mode(wconprodRecord.getItem("CMODE").get< std::string >(0));
+                    switch(m) {
+                    case 0:  // ORAT
+                        well_data_[wix].control = Rate;
+                        well_data_[wix].target = wconprodRecord.getItem("ORAT").getSIDouble(0);
+                        break;
+                    case 1:  // WRAT
+                        well_data_[wix].control = Rate;
+                        well_data_[wix].target = wconprodRecord.getItem("WRAT").getSIDouble(0);
+                        break;
+                    case 2:  // GRAT
+                        well_data_[wix].control = Rate;
+                        well_data_[wix].target = wconprodRecord.getItem("GRAT").getSIDouble(0);
+                        break;
+                    case 3:  // LRAT
+                        well_data_[wix].control = Rate;
+                        well_data_[wix].target = wconprodRecord.getItem("LRAT").getSIDouble(0);
+                        break;
+                    case 4:  // RESV 
+                        well_data_[wix].control = Rate;
+                        well_data_[wix].target = wconprodRecord.getItem("RESV").getSIDouble(0);
+                        break;
+                    case 5:  // BHP
+                        well_data_[wix].control = Pressure; 
+                        well_data_[wix].target = wconprodRecord.getItem("BHP").getSIDouble(0);
+                        break;
+                    case 6:  // THP 
+                        well_data_[wix].control = Pressure;
+                        well_data_[wix].target = wconprodRecord.getItem("THP").getSIDouble(0);
+                        break;
+                    default:
+                        OPM_THROW(std::runtime_error, "Unknown well control mode; WCONPROD  = "
+                                  << wconprodRecord.getItem("CMODE").get< std::string >(0)
+                                  << " in input file");
                     }
                 }
                 if (!well_found) {
@@ -374,19 +403,11 @@ namespace Opm
             const int num_weltargs  = weltargKeyword.size();
             for (int kw=0; kw<num_weltargs; ++kw) {
                 const auto& weltargRecord = weltargKeyword.getRecord(kw);
-                std::string name = weltargRecord.getItem("WELL").get< std::string >(0);
-                std::string::size_type len = name.find('*');
-                if (len != std::string::npos) {
-                    name = name.substr(0, len);
-                }
-                bool well_found = false;
-                for (int wix=0; wix<num_welspecs; ++wix) {
-                    if (well_names_[wix].compare(0,len, name) == 0) { //equal
-                        well_found = true;
-                        // TODO: convert to SI!
-                        well_data_[wix].target = weltargRecord.getItem("NEW_VALUE").get< double >(0);
-                        break;
-                    }
+                matchingWells(weltargRecord.getItem("WELL").get< std::string >(0), matches);
+                const bool well_found = !matches.empty();
+                if (well_found) {
+                    // TODO: convert to SI!
+                    well_data_[matches[0]].target = weltargRecord.getItem("NEW_VALUE").get< double >(0);
                 }
                 if (!well_found) {
                     OPM_THROW(std::runtime_error, "Undefined well name: " << weltargRecord.getItem("WELL").get< std::string >(0)
@@ -414,6 +435,26 @@ namespace Opm
         // Ensuring that they have the right size.
         well_cell_pressure_.resize(grid.numCells(), -1e100);
         well_cell_flux_.resize(grid.numCells(), 0.0);
+        perforations_.reserve(perf_data_.dataSize());
+    }
+
+    inline void BlackoilWells::matchingWells(const std::string& name, std::vector<int>& wells) const
+    {
+        wells.clear();
+        const std::string::size_type len = name.find('*');
+        if (len == std::string::npos) {
+            std::unordered_map<std::string, std::vector<int> >::const_iterator it = well_lookup_.find(name);
+            if (it != well_lookup_.end()) {
+                wells = it->second;
+            }
+        } else {
+            const std::string prefix = name.substr(0, len);
+            for (int wix = 0; wix < int(well_names_.size()); ++wix) {
+                if (well_names_[wix].compare(0, len, prefix) == 0) {
+                    wells.push_back(wix);
+                }
+            }
+        }
     }
 
     inline int BlackoilWells::numWells() const
@@ -464,18 +505,34 @@ namespace Opm
         assert(perf_data_.dataSize() == int(well_perf_pressures.size()));
         well_cell_pressure_.resize(num_cells, -1e100);
         well_cell_flux_.resize(num_cells, 0.0);
+        perforations_.resize(perf_data_.dataSize());
         int pcount = 0;
         for (int w = 0; w < numWells(); ++w) {
             for (int perf = 0; perf < numPerforations(w); ++perf) {
                 int cell = wellCell(w, perf);
                 well_cell_pressure_[cell] = well_perf_pressures[pcount];
                 well_cell_flux_[cell] = well_perf_fluxes[pcount];
+                Perforation& p = perforations_[pcount];
+                p.cell = cell;
+                p.flux = well_perf_fluxes[pcount];
+                p.pressure = well_perf_pressures[pcount];
+                p.injection_mixture = injection_mixture_;
                 ++pcount;
             }
         }
         assert(pcount == perf_data_.dataSize());
     }
 
+    inline const std::vector<BlackoilWells::Perforation>& BlackoilWells::perforations() const
+    {
+        return perforations_;
+    }
+
+    inline BlackoilWells::WellReport& BlackoilWells::wellReport() const
+    {
+        return well_report_;
+    }
+
     inline double BlackoilWells::wellToReservoirFlux(int cell) const
     {
         return well_cell_flux_[cell];
@@ -494,7 +551,8 @@ namespace Opm
     inline double BlackoilWells::computeWellIndex(double radius,
 						  const Dune::FieldVector<double, 3>& cubical,
 						  const Opm::Rock<3>::PermTensor& permeability,
-						  double skin_factor) const
+						  double skin_factor,
+						  double& r0) const
     {
 	// Use the Peaceman well model to compute well indices.
 	// radius is the radius of the well.
@@ -518,14 +576,9 @@ namespace Opm
 	double r0_numerator = sqrt((sqrt(kyox)*cubical[0]*cubical[0]) +
 				   (sqrt(kxoy)*cubical[1]*cubical[1]));
 	assert(r0_denominator > 0.0);
-	double r0 = 0.28 * r0_numerator / r0_denominator;
+	r0 = 0.28 * r0_numerator / r0_denominator;
 	assert(radius > 0.0);
 	assert(r0 > 0.0);
-	if (r0 < radius) {
-	    std::cout << "ERROR: Too big well radius detected.";
-	    std::cout << "Specified well radius is " << radius
-		      << " while r0 is " << r0 << ".\n";
-	}
 
         const double two_pi = 6.2831853071795864769252867665590057683943387987502116419498;
 
@@ -22,9 +22,14 @@
 
 #include <opm/porsol/blackoil/fluid/BlackoilDefs.hpp>
 #include <opm/porsol/blackoil/BlackoilFluid.hpp>
+#include <opm/porsol/common/Metrics.hpp>
 #include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <opm/common/ErrorMacros.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <iomanip>
 #include <vector>
 #include <iostream>
 
@@ -49,7 +54,13 @@ public:
         : pgrid_(0), prock_(0), pfluid_(0), pwells_(0), ptrans_(0),
           min_surfvol_threshold_(0.0),
           single_step_only_(false),
-          min_vtime_(0.0)
+          min_vtime_(0.0),
+          incremental_refresh_(false),
+          incremental_z_tolerance_(1e-6),
+          full_refresh_interval_(10),
+          substeps_since_full_refresh_(0),
+          refreshed_fraction_(1.0),
+          multirate_levels_(1)
     {
     }
 
@@ -58,6 +69,13 @@ public:
         min_surfvol_threshold_ = param.getDefault("min_surfvol_threshold", min_surfvol_threshold_);
         single_step_only_ = param.getDefault("single_step_only", single_step_only_);
         min_vtime_ = param.getDefault("min_vtime",  min_vtime_);
+        incremental_refresh_ = param.getDefault("incremental_refresh", incremental_refresh_);
+        incremental_z_tolerance_ = param.getDefault("incremental_z_tolerance", incremental_z_tolerance_);
+        full_refresh_interval_ = param.getDefault("full_refresh_interval", full_refresh_interval_);
+        multirate_levels_ = param.getDefault("multirate_levels", multirate_levels_);
+        if (multirate_levels_ < 1 || multirate_levels_ > 20) {
+            OPM_THROW(std::runtime_error, "multirate_levels must be in [1, 20], got " << multirate_levels_);
+        }
     }
 
     void setup(const Grid& grid,
@@ -87,6 +105,11 @@ public:
                      const double voldisclimit,
                      std::vector<CompVec>& cell_z)
     {
+        if (multirate_levels_ > 1) {
+            return transportMultirate(external_pressure, external_composition,
+                                      face_flux, cell_pressure, face_pressure,
+                                      dt, voldisclimit, cell_z);
+        }
         int num_cells = pgrid_->numCells();
         std::vector<CompVec> comp_change;
         std::vector<double> cell_outflux;
@@ -103,28 +126,14 @@ public:
         std::cout << "Transport solver target time: " << dt << std::endl;
         std::cout << "   Step               Stepsize           Remaining time\n";
         int count = 0;
+        MetricsRegistry::Counter& substeps = MetricsRegistry::current().counter("transport.substeps");
         while (cur_time < dt) {
+            substeps.add();
             cell_z_start = cell_z;
             computeChange(face_flux, comp_change, cell_outflux, cell_max_ff_deriv);
             double min_time = 1e100;
             for (int cell = 0; cell < num_cells; ++cell) {
-                double pvol = prock_->porosity(cell)*pgrid_->cellVolume(cell);
-                double vtime = pvol/(cell_outflux[cell]*cell_max_ff_deriv[cell]);
-                double gtime = 1e100; // No working CFL for gravity yet.
-                double max_nonzero_time = 1e100;
-                for (int comp = 0; comp < numComponents; ++comp) {
-                    if (comp_change[cell][comp] < 0.0) {
-                        if (cell_z[cell][comp] > min_surfvol_threshold_) {
-                            max_nonzero_time = std::min(max_nonzero_time,
-                                                        -cell_z[cell][comp]*pvol/comp_change[cell][comp]);
-                        } else {
-                            comp_change[cell][comp] = 0.0;
-                            cell_z[cell][comp] = 0.0;
-                        }
-                    }
-                }
-                vtime = std::max(vtime,min_vtime_);
-                double time = std::min(std::min(vtime, gtime), max_nonzero_time);
+                double time = stableTime(cell, comp_change, cell_outflux, cell_max_ff_deriv, cell_z);
                 min_time = std::min(time, min_time);
             }
             min_time *= 0.49; // Semi-random CFL factor... \TODO rigorize
@@ -152,7 +161,184 @@ public:
             }
             // After changing z, we recompute fluid properties.
             updateFluidProperties(cell_pressure, face_pressure, cell_z,
-                                  external_pressure, external_composition);
+                                  external_pressure, external_composition,
+                                  incremental_refresh_);
+            pwells_->wellReport().massRate = perf_rate_;
+            if (incremental_refresh_) {
+                std::cout << "    Fraction of cells refreshed: " << refreshedFraction() << std::endl;
+            }
+            bool ok = volumeDiscrepancyAcceptable(voldisclimit);
+            if (!ok) {
+                // Roll back to last ok step.
+                cell_z = cell_z_start;
+                cur_time -= step_time;
+                return cur_time;
+            }
+            if (single_step_only_) {
+                return cur_time;
+            }
+        }
+        return dt;
+    }
+
+
+    /// Multirate variant of transport(), used if multirate_levels > 1.
+    /// Each macro step is split into up to 2^(multirate_levels - 1)
+    /// substeps. Every cell is assigned the coarsest level l (step
+    /// size macro step/2^l) that is stable for it, every face the finer
+    /// level of its two cells. Face fluxes are applied to both cells at
+    /// the rate of the face, so mass is conserved exactly, and fluid
+    /// properties are only refreshed for the cells that were changed.
+    double transportMultirate(const PhaseVec& external_pressure,
+                              const CompVec& external_composition,
+                              const std::vector<double>& face_flux,
+                              const std::vector<PhaseVec>& cell_pressure,
+                              const std::vector<PhaseVec>& face_pressure,
+                              const double dt,
+                              const double voldisclimit,
+                              std::vector<CompVec>& cell_z)
+    {
+        const int num_cells = pgrid_->numCells();
+        const int num_faces = pgrid_->numFaces();
+        const int max_level = multirate_levels_ - 1;
+        const CompVec surf_dens = pfluid_->surfaceDensities();
+        std::vector<CompVec> comp_change;
+        std::vector<double> cell_outflux;
+        std::vector<double> cell_max_ff_deriv;
+        std::vector<double> pore_volume(num_cells);
+        for (int cell = 0; cell < num_cells; ++cell) {
+            pore_volume[cell] = prock_->porosity(cell)*pgrid_->cellVolume(cell);
+        }
+        std::vector<int> cell_level(num_cells);
+        std::vector<int> face_level(num_faces);
+        std::vector<int> active_faces;
+        std::vector<CompVec> active_face_change;
+        std::vector<char> changed(num_cells, 0);
+        std::vector<int> changed_cells;
+        std::vector<CompVec> perf_rate_sum;
+        double cur_time = 0.0;
+        updateFluidProperties(cell_pressure, face_pressure, cell_z,
+                              external_pressure, external_composition);
+        std::vector<CompVec> cell_z_start;
+        std::cout << "Transport solver target time: " << dt << std::endl;
+        std::cout << "   Step               Stepsize           Remaining time\n";
+        int count = 0;
+        long total_cell_updates = 0;
+        long total_global_updates = 0;
+        MetricsRegistry::Counter& substeps = MetricsRegistry::current().counter("transport.substeps");
+        while (cur_time < dt) {
+            substeps.add();
+            cell_z_start = cell_z;
+
+            // Stable step for every cell, as in transport().
+            computeChange(face_flux, comp_change, cell_outflux, cell_max_ff_deriv);
+            std::vector<double> cell_time(num_cells);
+            double min_time = 1e100;
+            for (int cell = 0; cell < num_cells; ++cell) {
+                cell_time[cell] = 0.49*stableTime(cell, comp_change, cell_outflux, cell_max_ff_deriv, cell_z);
+                min_time = std::min(cell_time[cell], min_time);
+            }
+            const double step_time = std::min(dt - cur_time, min_time*double(1 << max_level));
+            if ((dt - cur_time - step_time)/step_time > 10000) {
+                std::cout << "Collapsing transport stepsize detected." << std::endl;
+                return cur_time;
+            }
+
+            // Group cells and faces by stable step size.
+            int top_level = 0;
+            for (int cell = 0; cell < num_cells; ++cell) {
+                int level = 0;
+                while (level < max_level && step_time > cell_time[cell]*double(1 << level)) {
+                    ++level;
+                }
+                cell_level[cell] = level;
+                top_level = std::max(top_level, level);
+            }
+            for (int face = 0; face < num_faces; ++face) {
+                const int c0 = pgrid_->faceCell(face, 0);
+                const int c1 = pgrid_->faceCell(face, 1);
+                face_level[face] = std::max(c0 >= 0 ? cell_level[c0] : 0,
+                                            c1 >= 0 ? cell_level[c1] : 0);
+            }
+
+            // Advance all groups to the end of the macro step.
+            const int num_substeps = 1 << top_level;
+            const double substep_time = step_time/double(num_substeps);
+            long cell_updates = 0;
+            const int num_perf = perf_cells_.size();
+            perf_rate_sum.assign(num_perf, CompVec(0.0));
+            for (int substep = 0; substep < num_substeps; ++substep) {
+                active_faces.clear();
+                for (int face = 0; face < num_faces; ++face) {
+                    if (substep % (1 << (top_level - face_level[face])) == 0) {
+                        active_faces.push_back(face);
+                    }
+                }
+                const int num_active = active_faces.size();
+                active_face_change.resize(num_active);
+                double dummy_ff_deriv;
+#pragma omp parallel for private(dummy_ff_deriv)
+                for (int i = 0; i < num_active; ++i) {
+                    computeFaceChange(active_faces[i], face_flux, surf_dens,
+                                      active_face_change[i], dummy_ff_deriv);
+                }
+                changed_cells.clear();
+                for (int i = 0; i < num_active; ++i) {
+                    const int face = active_faces[i];
+                    CompVec change = active_face_change[i];
+                    change *= substep_time*double(1 << (top_level - face_level[face]));
+                    for (int ix = 0; ix < 2; ++ix) {
+                        const int cell = pgrid_->faceCell(face, ix);
+                        if (cell >= 0) {
+                            CompVec dz = change;
+                            dz *= (ix == 0 ? -1.0 : 1.0)/pore_volume[cell];
+                            cell_z[cell] += dz;
+                            if (!changed[cell]) {
+                                changed[cell] = 1;
+                                changed_cells.push_back(cell);
+                            }
+                        }
+                    }
+                }
+                for (int perf = 0; perf < num_perf; ++perf) {
+                    const int cell = perf_cells_[perf];
+                    const int cell_substeps = 1 << (top_level - cell_level[cell]);
+                    if (substep % cell_substeps == 0) {
+                        CompVec dz = perforationChange(perf);
+                        dz *= substep_time*double(cell_substeps);
+                        perf_rate_sum[perf] += dz;
+                        dz *= 1.0/pore_volume[cell];
+                        cell_z[cell] += dz;
+                        if (!changed[cell]) {
+                            changed[cell] = 1;
+                            changed_cells.push_back(cell);
+                        }
+                    }
+                }
+                cell_updates += changed_cells.size();
+                refreshCells(changed_cells, changed, cell_pressure, face_pressure, cell_z, external_composition);
+                for (int i = 0; i < int(changed_cells.size()); ++i) {
+                    changed[changed_cells[i]] = 0;
+                }
+            }
+            // Report the perforation rates averaged over the macro step.
+            for (int perf = 0; perf < num_perf; ++perf) {
+                perf_rate_sum[perf] *= 1.0/step_time;
+            }
+            pwells_->wellReport().massRate = perf_rate_sum;
+            cur_time += step_time;
+            total_cell_updates += cell_updates;
+            total_global_updates += long(num_cells)*long(num_substeps);
+
+            std::cout.precision(10);
+            std::cout << std::setw(6) << count++
+                      << std::setw(24) << step_time
+                      << std::setw(24) << dt - cur_time << std::endl;
+            std::cout << "    Multirate levels: " << top_level + 1
+                      << "    Cell updates: " << cell_updates
+                      << " (global stepping: " << long(num_cells)*long(num_substeps) << ")" << std::endl;
+            std::cout.precision(16);
+
             bool ok = volumeDiscrepancyAcceptable(voldisclimit);
             if (!ok) {
                 // Roll back to last ok step.
@@ -164,6 +350,8 @@ public:
                 return cur_time;
             }
         }
+        std::cout << "Multirate transport, cell updates: " << total_cell_updates
+                  << " (global stepping: " << total_global_updates << ")" << std::endl;
         return dt;
     }
 
@@ -208,6 +396,36 @@ private: // Data
                 fractional_flow[i] *= (1.0/total_mobility[i]);
             }
         }
+
+        /// Incremental counterpart of computeNew(), see
+        /// AllFluidData::computeIncremental().
+        template <class G, class R>
+        void computeIncremental(const G& grid,
+                                const R& rock,
+                                const BlackoilFluid& fluid,
+                                const typename Grid::Vector gravity,
+                                const std::vector<PhaseVec>& cell_pressure,
+                                const std::vector<PhaseVec>& face_pressure,
+                                const std::vector<CompVec>& cell_z,
+                                const CompVec& bdy_z,
+                                const double dt,
+                                const std::vector<int>& cells)
+        {
+            Opm::AllFluidData::computeIncremental(grid, rock, fluid, gravity,
+                                                  cell_pressure, face_pressure,
+                                                  cell_z, bdy_z, dt, cells);
+            const int num = cells.size();
+#pragma omp parallel for
+            for (int j = 0; j < num; ++j) {
+                const int i = cells[j];
+                total_mobility[i] = 0.0;
+                for (int phase = 0; phase < numPhases; ++phase) {
+                    total_mobility[i] += cell_data.mobility[i][phase];
+                }
+                fractional_flow[i] = cell_data.mobility[i];
+                fractional_flow[i] *= (1.0/total_mobility[i]);
+            }
+        }
     };
     AllTransportFluidData fluid_data_;
     struct TransportFluidData
@@ -219,13 +437,63 @@ private: // Data
         PhaseVec relperm;
         PhaseVec viscosity;
     };
+    // Per-side properties used by computeFaceChange(), referring to
+    // the cell data or to a TransportFluidData instead of copying.
+    class TransportFluidView
+    {
+    public:
+        TransportFluidView()
+        {
+        }
+        explicit TransportFluidView(const TransportFluidData& d)
+            : saturation_(&d.saturation), mobility_(&d.mobility),
+              fractional_flow_(&d.fractional_flow), phase_to_comp_(&d.phase_to_comp),
+              relperm_(&d.relperm), viscosity_(&d.viscosity)
+        {
+        }
+        TransportFluidView(const AllTransportFluidData& fd, const int cell)
+            : saturation_(&fd.cell_data.saturation[cell]), mobility_(&fd.cell_data.mobility[cell]),
+              fractional_flow_(&fd.fractional_flow[cell]), phase_to_comp_(&fd.cell_data.state_matrix[cell]),
+              relperm_(&fd.cell_data.relperm[cell]), viscosity_(&fd.cell_data.viscosity[cell])
+        {
+        }
+        const PhaseVec& saturation() const { return *saturation_; }
+        const PhaseVec& mobility() const { return *mobility_; }
+        const PhaseVec& fractionalFlow() const { return *fractional_flow_; }
+        const PhaseToCompMatrix& phaseToComp() const { return *phase_to_comp_; }
+        const PhaseVec& relperm() const { return *relperm_; }
+        const PhaseVec& viscosity() const { return *viscosity_; }
+    private:
+        const PhaseVec* saturation_;
+        const PhaseVec* mobility_;
+        const PhaseVec* fractional_flow_;
+        const PhaseToCompMatrix* phase_to_comp_;
+        const PhaseVec* relperm_;
+        const PhaseVec* viscosity_;
+    };
     TransportFluidData bdy_;
     std::vector<int> perf_cells_;
     std::vector<double> perf_flow_;
     std::vector<TransportFluidData> perf_props_;
+    // Perforation rates of the last computeChange().
+    std::vector<CompVec> perf_rate_;
     double min_surfvol_threshold_;
     bool single_step_only_;
     double min_vtime_;
+    // Incremental refresh of fluid properties between substeps:
+    // only cells whose composition changed by more than
+    // incremental_z_tolerance_ (relative to the total surface volume
+    // of the cell) since they were last computed are recomputed,
+    // and a full refresh is done every full_refresh_interval_ substeps.
+    bool incremental_refresh_;
+    double incremental_z_tolerance_;
+    int full_refresh_interval_;
+    int substeps_since_full_refresh_;
+    double refreshed_fraction_;
+    std::vector<CompVec> refresh_z_;
+    std::vector<int> refresh_cells_;
+    // Number of multirate levels, 1 means global time stepping.
+    int multirate_levels_;
 
 private: // Methods
 
@@ -248,16 +516,50 @@ private: // Methods
         return data;
     }
 
+    /// Fraction of the cells whose properties were recomputed by the
+    /// last call to updateFluidProperties().
+    double refreshedFraction() const
+    {
+        return refreshed_fraction_;
+    }
+
     void updateFluidProperties(const std::vector<PhaseVec>& cell_pressure,
                                const std::vector<PhaseVec>& face_pressure,
                                const std::vector<CompVec>& cell_z,
                                const PhaseVec& external_pressure,
-                               const CompVec& external_composition)
+                               const CompVec& external_composition,
+                               const bool incremental = false)
     {
+        ScopedTimer timer("fluid.properties.transport");
         // Properties in reservoir.
         const double dummy_dt = 1.0;
-        fluid_data_.computeNew(*pgrid_, *prock_, *pfluid_, gravity_,
-                               cell_pressure, face_pressure, cell_z, external_composition, dummy_dt);
+        const int num_cells = pgrid_->numCells();
+        if (incremental && int(refresh_z_.size()) == num_cells
+            && ++substeps_since_full_refresh_ < full_refresh_interval_) {
+            refresh_cells_.clear();
+            for (int cell = 0; cell < num_cells; ++cell) {
+                double total = 0.0;
+                double change = 0.0;
+                for (int comp = 0; comp < numComponents; ++comp) {
+                    total += std::fabs(refresh_z_[cell][comp]);
+                    change = std::max(change, std::fabs(cell_z[cell][comp] - refresh_z_[cell][comp]));
+                }
+                if (change > incremental_z_tolerance_*total) {
+                    refresh_cells_.push_back(cell);
+                    refresh_z_[cell] = cell_z[cell];
+                }
+            }
+            fluid_data_.computeIncremental(*pgrid_, *prock_, *pfluid_, gravity_,
+                                           cell_pressure, face_pressure, cell_z, external_composition,
+                                           dummy_dt, refresh_cells_);
+            refreshed_fraction_ = num_cells > 0 ? double(refresh_cells_.size())/double(num_cells) : 0.0;
+        } else {
+            fluid_data_.computeNew(*pgrid_, *prock_, *pfluid_, gravity_,
+                                   cell_pressure, face_pressure, cell_z, external_composition, dummy_dt);
+            refresh_z_ = cell_z;
+            substeps_since_full_refresh_ = 0;
+            refreshed_fraction_ = 1.0;
+        }
 
         // Properties on boundary. \TODO no need to ever recompute this.
         bdy_ = computeProps(external_pressure, external_composition);
@@ -266,38 +568,98 @@ private: // Methods
         // \TODO only need to recompute this once per pressure update.
         // No, that is false, at production perforations the cell z is
         // used, which may change every step.
+        // The perforation list is only rebuilt by the wells' update(),
+        // and the vectors below keep their capacity between substeps.
+        const std::vector<typename Wells::Perforation>& perfs = pwells_->perforations();
+        const int num_perfs = perfs.size();
         perf_cells_.clear();
         perf_flow_.clear();
         perf_props_.clear();
-        Wells::WellReport::report()->clearAll();
-        int num_cells = pgrid_->numCells();
-        for (int cell = 0; cell < num_cells; ++cell) {
-            double flow = pwells_->wellToReservoirFlux(cell);
+        pwells_->wellReport().clearAll();
+        for (int perf = 0; perf < num_perfs; ++perf) {
+            const typename Wells::Perforation& wp = perfs[perf];
+            const int cell = wp.cell;
+            const double flow = wp.flux;
             if (flow != 0.0) {
                 perf_cells_.push_back(cell);
                 perf_flow_.push_back(flow);
                 // \TODO handle capillary in perforation pressure below?
-                PhaseVec well_pressure = flow > 0.0 ? PhaseVec(pwells_->perforationPressure(cell)) : cell_pressure[cell];
-                CompVec well_mixture = flow > 0.0 ? pwells_->injectionMixture(cell) : cell_z[cell];
+                PhaseVec well_pressure = flow > 0.0 ? PhaseVec(wp.pressure) : cell_pressure[cell];
+                CompVec well_mixture = flow > 0.0 ? wp.injection_mixture : cell_z[cell];
                 perf_props_.push_back(computeProps(well_pressure, well_mixture));
-                Wells::WellReport::report()->perfPressure.push_back(pwells_->perforationPressure(cell));
-                Wells::WellReport::report()->cellPressure.push_back(cell_pressure[cell][0]);
-                Wells::WellReport::report()->cellId.push_back(cell);
+                pwells_->wellReport().perfPressure.push_back(wp.pressure);
+                pwells_->wellReport().cellPressure.push_back(cell_pressure[cell][0]);
+                pwells_->wellReport().cellId.push_back(cell);
+                // Set by the step that uses these properties.
+                pwells_->wellReport().massRate.push_back(CompVec(0.0));
+            }
+        }
+    }
+
+
+
+
+    /// Refresh the fluid properties of the given cells (and their
+    /// faces and production perforations) after their z has changed.
+    /// The cells must also be marked in cell_mask.
+    void refreshCells(const std::vector<int>& cells,
+                      const std::vector<char>& cell_mask,
+                      const std::vector<PhaseVec>& cell_pressure,
+                      const std::vector<PhaseVec>& face_pressure,
+                      const std::vector<CompVec>& cell_z,
+                      const CompVec& external_composition)
+    {
+        const double dummy_dt = 1.0;
+        fluid_data_.computeIncremental(*pgrid_, *prock_, *pfluid_, gravity_,
+                                       cell_pressure, face_pressure, cell_z, external_composition,
+                                       dummy_dt, cells);
+        if (refresh_z_.size() == cell_z.size()) {
+            for (int i = 0; i < int(cells.size()); ++i) {
+                refresh_z_[cells[i]] = cell_z[cells[i]];
+            }
+        }
+        const int num_perf = perf_cells_.size();
+        for (int perf = 0; perf < num_perf; ++perf) {
+            const int cell = perf_cells_[perf];
+            if (perf_flow_[perf] < 0.0 && cell_mask[cell]) {
+                perf_props_[perf] = computeProps(cell_pressure[cell], cell_z[cell]);
             }
         }
     }
 
 
+    /// Largest stable step for a cell, given the output of
+    /// computeChange(). Components below min_surfvol_threshold_ that
+    /// would become negative are removed from the cell.
+    double stableTime(const int cell,
+                      std::vector<CompVec>& comp_change,
+                      const std::vector<double>& cell_outflux,
+                      const std::vector<double>& cell_max_ff_deriv,
+                      std::vector<CompVec>& cell_z) const
+    {
+        double pvol = prock_->porosity(cell)*pgrid_->cellVolume(cell);
+        double vtime = pvol/(cell_outflux[cell]*cell_max_ff_deriv[cell]);
+        double gtime = 1e100; // No working CFL for gravity yet.
+        double max_nonzero_time = 1e100;
+        for (int comp = 0; comp < numComponents; ++comp) {
+            if (comp_change[cell][comp] < 0.0) {
+                if (cell_z[cell][comp] > min_surfvol_threshold_) {
+                    max_nonzero_time = std::min(max_nonzero_time,
+                                                -cell_z[cell][comp]*pvol/comp_change[cell][comp]);
+                } else {
+                    comp_change[cell][comp] = 0.0;
+                    cell_z[cell][comp] = 0.0;
+                }
+            }
+        }
+        vtime = std::max(vtime,min_vtime_);
+        return std::min(std::min(vtime, gtime), max_nonzero_time);
+    }
 
 
-    void cellData(int cell, TransportFluidData& tfd) const
+    TransportFluidView cellData(int cell) const
     {
-        tfd.saturation = fluid_data_.cell_data.saturation[cell];
-        tfd.mobility = fluid_data_.cell_data.mobility[cell];
-        tfd.fractional_flow = fluid_data_.fractional_flow[cell];
-        tfd.phase_to_comp = fluid_data_.cell_data.state_matrix[cell];
-        tfd.relperm = fluid_data_.cell_data.relperm[cell];
-        tfd.viscosity = fluid_data_.cell_data.viscosity[cell];
+        return TransportFluidView(fluid_data_, cell);
     }
 
 
@@ -335,106 +697,7 @@ private: // Methods
 	std::vector<double> faces_max_ff_deriv(num_faces);
 #pragma omp parallel for
         for (int face = 0; face < num_faces; ++face) {
-            // Compute phase densities on face.
-            PhaseVec phase_dens(0.0);
-            for (int phase = 0; phase < numPhases; ++phase) {
-                const double* At = &fluid_data_.face_data.state_matrix[face][0][0]; // Already transposed since in Fortran order...
-                for (int comp = 0; comp < numPhases; ++comp) {
-                    phase_dens[phase] += At[numPhases*phase + comp]*surf_dens[comp];
-                }
-            }
-            // Collect data from adjacent cells (or boundary).
-            int c[2];
-            TransportFluidData d[2];
-            for (int ix = 0; ix < 2; ++ix) {
-                c[ix] = pgrid_->faceCell(face, ix);
-                if (c[ix] >= 0) {
-                    cellData(c[ix], d[ix]);
-                } else {
-                    d[ix] = bdy_;
-                }
-            }
-            // Compute upwind directions.
-            int upwind_dir[numPhases] = { 0, 0, 0 };
-            PhaseVec vstar(face_flux[face]);
-            // double gravity_flux = gravity_*pgrid_->faceNormal(face)*pgrid_->faceArea(face);
-
-            typename Grid::Vector centroid_diff = c[0] >= 0 ? pgrid_->cellCentroid(c[0]) : pgrid_->faceCentroid(face);
-            centroid_diff -= c[1] >= 0 ? pgrid_->cellCentroid(c[1]) : pgrid_->faceCentroid(face);
-            double gravity_flux = gravity_*centroid_diff*ptrans_->operator[](face);
-            PhaseVec rho_star(phase_dens);
-            process_face(&(d[0].mobility[0]), &(d[1].mobility[0]),
-                         &vstar[0], gravity_flux, numPhases, &rho_star[0], upwind_dir);
-
-            // Compute phase fluxes.
-            PhaseVec phase_mob;
-            double tot_mob = 0.0;
-            for (int phase = 0; phase < numPhases; ++phase) {
-                phase_mob[phase] = d[upwind_dir[phase] - 1].mobility[phase];
-                tot_mob += phase_mob[phase];
-            }
-            PhaseVec ff = phase_mob;
-            ff /= tot_mob;
-            PhaseVec phase_flux = ff;
-            phase_flux *= face_flux[face];
-            // Until we have proper bcs for transport, assume no gravity flow across bdys.
-            if (gravity_flux != 0.0 && c[0] >= 0 && c[1] >= 0) {
-                // Gravity contribution.
-                double omega = ff*phase_dens;
-                for (int phase = 0; phase < numPhases; ++phase) {
-                    double gf = (phase_dens[phase] - omega)*gravity_flux;
-                    phase_flux[phase] -= phase_mob[phase]*gf;
-                }
-            }
-
-            // Estimate max derivative of ff.
-            double face_max_ff_deriv = 0.0;
-            // Only using total flux upwinding for this purpose.
-            // Aim is to reproduce old results first. \TODO fix, include gravity.
-            int downwind_cell = c[upwind_dir[0]%2]; // Keep in mind that upwind_dir[] \in {1, 2}
-            if (downwind_cell >= 0) { // Only contribution on inflow and internal faces.
-                // Evaluating all functions at upwind viscosity.
-                // Added for this version.
-                PhaseVec upwind_viscosity = d[upwind_dir[0] - 1].viscosity;
-                PhaseVec upwind_sat = d[upwind_dir[0] - 1].saturation;
-                PhaseVec upwind_relperm = d[upwind_dir[0] - 1].relperm;
-                PhaseVec downwind_mob(0.0);
-                PhaseVec upwind_mob(0.0);
-                double downwind_totmob = 0.0;
-                double upwind_totmob = 0.0;
-                for (int phase = 0; phase < numPhases; ++phase) {
-                    downwind_mob[phase] = fluid_data_.cell_data.relperm[downwind_cell][phase]/upwind_viscosity[phase];
-                    downwind_totmob += downwind_mob[phase];
-                    upwind_mob[phase] = upwind_relperm[phase]/upwind_viscosity[phase];
-                    upwind_totmob += upwind_mob[phase];
-                }
-                PhaseVec downwind_ff = downwind_mob;
-                downwind_ff /= downwind_totmob;
-                PhaseVec upwind_ff = upwind_mob;
-                upwind_ff /= upwind_totmob;
-                PhaseVec ff_diff = upwind_ff;
-                ff_diff -= downwind_ff;
-                for (int phase = 0; phase < numPhases; ++phase) {
-                    if (std::fabs(ff_diff[phase]) > 1e-10) {
-                        if (face_flux[face] != 0.0) {
-                            double ff_deriv = ff_diff[phase]/(upwind_sat[phase] - fluid_data_.cell_data.saturation[downwind_cell][phase]);
-                            // assert(ff_deriv >= 0.0);
-                            face_max_ff_deriv = std::max(face_max_ff_deriv, std::fabs(ff_deriv));
-                        }
-                    }
-                }
-            }
-	    faces_max_ff_deriv[face] = face_max_ff_deriv;
-
-            // Compute z change.
-            CompVec change(0.0);
-            for (int phase = 0; phase < numPhases; ++phase) {
-                int upwind_ix = upwind_dir[phase] - 1; // Since process_face returns 1 or 2.
-                CompVec z_in_phase = d[upwind_ix].phase_to_comp[phase];
-                z_in_phase *= phase_flux[phase];
-                change += z_in_phase;
-            }
-	    face_change[face] = change;
+            computeFaceChange(face, face_flux, surf_dens, face_change[face], faces_max_ff_deriv[face]);
 	}
 
 	// Update output variables
@@ -461,31 +724,153 @@ private: // Methods
 
         // Done with all faces, now deal with well perforations.
         int num_perf = perf_cells_.size();
+        perf_rate_.resize(num_perf);
         for (int perf = 0; perf < num_perf; ++perf) {
-            int cell = perf_cells_[perf];
-            double flow = perf_flow_[perf];
-            assert(flow != 0.0);
-            const TransportFluidData& fl = perf_props_[perf];
-            // For injection, phase volumes depend on fractional
-            // flow of injection perforation, for production we
-            // use the fractional flow of the producing cell.
-            PhaseVec phase_flux = flow > 0.0 ? fl.fractional_flow : fluid_data_.fractional_flow[cell];
-            phase_flux *= flow;
-            // Conversion to mass flux is given at perforation state
-            // if injector, cell state if producer (this is ensured by
-            // updateFluidProperties()).
-            CompVec change(0.0);
+            CompVec change = perforationChange(perf);
+            comp_change[perf_cells_[perf]] += change;
+            perf_rate_[perf] = change;
+        }
+    }
+
+
+    /// Component flux across a face (from faceCell(face, 0) to
+    /// faceCell(face, 1)) with the current fluid properties, and an
+    /// estimate of the maximum fractional flow derivative at the face.
+    void computeFaceChange(const int face,
+                           const std::vector<double>& face_flux,
+                           const CompVec& surf_dens,
+                           CompVec& change,
+                           double& max_ff_deriv) const
+    {
+        // Compute phase densities on face.
+        PhaseVec phase_dens(0.0);
+        for (int phase = 0; phase < numPhases; ++phase) {
+            const double* At = &fluid_data_.face_data.state_matrix[face][0][0]; // Already transposed since in Fortran order...
+            for (int comp = 0; comp < numPhases; ++comp) {
+                phase_dens[phase] += At[numPhases*phase + comp]*surf_dens[comp];
+            }
+        }
+        // Collect data from adjacent cells (or boundary).
+        int c[2];
+        TransportFluidView d[2];
+        for (int ix = 0; ix < 2; ++ix) {
+            c[ix] = pgrid_->faceCell(face, ix);
+            if (c[ix] >= 0) {
+                d[ix] = cellData(c[ix]);
+            } else {
+                d[ix] = TransportFluidView(bdy_);
+            }
+        }
+        // Compute upwind directions.
+        int upwind_dir[numPhases] = { 0, 0, 0 };
+        PhaseVec vstar(face_flux[face]);
+        // double gravity_flux = gravity_*pgrid_->faceNormal(face)*pgrid_->faceArea(face);
+
+        typename Grid::Vector centroid_diff = c[0] >= 0 ? pgrid_->cellCentroid(c[0]) : pgrid_->faceCentroid(face);
+        centroid_diff -= c[1] >= 0 ? pgrid_->cellCentroid(c[1]) : pgrid_->faceCentroid(face);
+        double gravity_flux = gravity_*centroid_diff*ptrans_->operator[](face);
+        PhaseVec rho_star(phase_dens);
+        process_face(&d[0].mobility()[0], &d[1].mobility()[0],
+                     &vstar[0], gravity_flux, numPhases, &rho_star[0], upwind_dir);
+
+        // Compute phase fluxes.
+        PhaseVec phase_mob;
+        double tot_mob = 0.0;
+        for (int phase = 0; phase < numPhases; ++phase) {
+            phase_mob[phase] = d[upwind_dir[phase] - 1].mobility()[phase];
+            tot_mob += phase_mob[phase];
+        }
+        PhaseVec ff = phase_mob;
+        ff /= tot_mob;
+        PhaseVec phase_flux = ff;
+        phase_flux *= face_flux[face];
+        // Until we have proper bcs for transport, assume no gravity flow across bdys.
+        if (gravity_flux != 0.0 && c[0] >= 0 && c[1] >= 0) {
+            // Gravity contribution.
+            double omega = ff*phase_dens;
             for (int phase = 0; phase < numPhases; ++phase) {
-                CompVec z_in_phase = fl.phase_to_comp[phase];
-                z_in_phase *= phase_flux[phase];
-                change += z_in_phase;
+                double gf = (phase_dens[phase] - omega)*gravity_flux;
+                phase_flux[phase] -= phase_mob[phase]*gf;
+            }
+        }
+
+        // Estimate max derivative of ff.
+        double face_max_ff_deriv = 0.0;
+        // Only using total flux upwinding for this purpose.
+        // Aim is to reproduce old results first. \TODO fix, include gravity.
+        int downwind_cell = c[upwind_dir[0]%2]; // Keep in mind that upwind_dir[] \in {1, 2}
+        if (downwind_cell >= 0) { // Only contribution on inflow and internal faces.
+            // Evaluating all functions at upwind viscosity.
+            // Added for this version.
+            const PhaseVec& upwind_viscosity = d[upwind_dir[0] - 1].viscosity();
+            const PhaseVec& upwind_sat = d[upwind_dir[0] - 1].saturation();
+            const PhaseVec& upwind_relperm = d[upwind_dir[0] - 1].relperm();
+            PhaseVec downwind_mob(0.0);
+            PhaseVec upwind_mob(0.0);
+            double downwind_totmob = 0.0;
+            double upwind_totmob = 0.0;
+            for (int phase = 0; phase < numPhases; ++phase) {
+                downwind_mob[phase] = fluid_data_.cell_data.relperm[downwind_cell][phase]/upwind_viscosity[phase];
+                downwind_totmob += downwind_mob[phase];
+                upwind_mob[phase] = upwind_relperm[phase]/upwind_viscosity[phase];
+                upwind_totmob += upwind_mob[phase];
+            }
+            PhaseVec downwind_ff = downwind_mob;
+            downwind_ff /= downwind_totmob;
+            PhaseVec upwind_ff = upwind_mob;
+            upwind_ff /= upwind_totmob;
+            PhaseVec ff_diff = upwind_ff;
+            ff_diff -= downwind_ff;
+            for (int phase = 0; phase < numPhases; ++phase) {
+                if (std::fabs(ff_diff[phase]) > 1e-10) {
+                    if (face_flux[face] != 0.0) {
+                        double ff_deriv = ff_diff[phase]/(upwind_sat[phase] - fluid_data_.cell_data.saturation[downwind_cell][phase]);
+                        // assert(ff_deriv >= 0.0);
+                        face_max_ff_deriv = std::max(face_max_ff_deriv, std::fabs(ff_deriv));
+                    }
+                }
             }
-            comp_change[cell] += change;
-            Wells::WellReport::report()->massRate.push_back(change);
         }
+        max_ff_deriv = face_max_ff_deriv;
+
+        // Compute z change.
+        change = 0.0;
+        for (int phase = 0; phase < numPhases; ++phase) {
+            int upwind_ix = upwind_dir[phase] - 1; // Since process_face returns 1 or 2.
+            CompVec z_in_phase = d[upwind_ix].phaseToComp()[phase];
+            z_in_phase *= phase_flux[phase];
+            change += z_in_phase;
+        }
+    }
+
+
+    /// Component flux from well to reservoir at a perforation.
+    CompVec perforationChange(const int perf) const
+    {
+        int cell = perf_cells_[perf];
+        double flow = perf_flow_[perf];
+        assert(flow != 0.0);
+        const TransportFluidData& fl = perf_props_[perf];
+        // For injection, phase volumes depend on fractional
+        // flow of injection perforation, for production we
+        // use the fractional flow of the producing cell.
+        PhaseVec phase_flux = flow > 0.0 ? fl.fractional_flow : fluid_data_.fractional_flow[cell];
+        phase_flux *= flow;
+        // Conversion to mass flux is given at perforation state
+        // if injector, cell state if producer (this is ensured by
+        // updateFluidProperties()).
+        CompVec change(0.0);
+        for (int phase = 0; phase < numPhases; ++phase) {
+            CompVec z_in_phase = fl.phase_to_comp[phase];
+            z_in_phase *= phase_flux[phase];
+            change += z_in_phase;
+        }
+        return change;
     }
 
 
+public: // Upwinding helpers, also used by ImplicitCompositionalTransport.
+
     // Arguments are:
     //  [in] cmob1, cmob2: cell mobilities for adjacent cells
     //  [in, destroyed] vstar: total velocity (equal for all phases) on input, modified on output
@@ -494,7 +879,7 @@ private: // Methods
     //  [in, destroyed] rho: density on face
     //  [out] ix: upwind cells for each phase (1 or 2)
     static void 
-    process_face(double *cmob1, double *cmob2, double *vstar, double gf, 
+    process_face(const double *cmob1, const double *cmob2, double *vstar, double gf, 
                  int np, double *rho, int *ix)
     {
         int i,j,k,a,b,c;
@@ -0,0 +1,613 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_IMPLICITCOMPOSITIONALTRANSPORT_HEADER_INCLUDED
+#define OPM_IMPLICITCOMPOSITIONALTRANSPORT_HEADER_INCLUDED
+
+#include <opm/porsol/blackoil/fluid/BlackoilDefs.hpp>
+#include <opm/porsol/blackoil/BlackoilFluid.hpp>
+#include <opm/porsol/blackoil/ComponentTransport.hpp>
+#include <opm/porsol/common/Metrics.hpp>
+#include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <opm/common/ErrorMacros.hpp>
+
+#include <dune/common/fvector.hh>
+#include <dune/common/fmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace Opm
+{
+
+
+/// Sequential implicit component transport, an alternative to
+/// ExplicitCompositionalTransport with the same interface, for use as
+/// the TransportSolver of BlackoilSimulator.
+///
+/// Pressures and total face fluxes are held fixed, and the surface
+/// volumes z are found by backward Euler with upstream weighted
+/// component fluxes, using a Newton loop. The Jacobian is assembled
+/// from the mobility derivatives of AllFluidData and the derivative of
+/// the saturations with respect to z for fixed state matrices, and each
+/// linear system is solved with BiCGSTAB and ILU(0). Since pressure is
+/// fixed during transport, pressure derivatives do not enter. Upwind
+/// directions and face densities are lagged within an iteration.
+///
+/// If Newton does not converge, the step is split in halves, at most
+/// max_step_cuts times, before giving up.
+template <class Grid, class Rock, class Fluid, class Wells>
+class ImplicitCompositionalTransport : public BlackoilDefs
+{
+public:
+    /// @brief
+    ///    Default constructor. Does nothing.
+    ImplicitCompositionalTransport()
+        : pgrid_(0), prock_(0), pfluid_(0), pwells_(0), ptrans_(0),
+          newton_tolerance_(1e-6),
+          max_newton_iterations_(12),
+          max_step_cuts_(6),
+          linear_tolerance_(1e-8),
+          linear_verbosity_(0)
+    {
+    }
+
+    void init(const Opm::parameter::ParameterGroup& param)
+    {
+        newton_tolerance_ = param.getDefault("transport_newton_tolerance", newton_tolerance_);
+        max_newton_iterations_ = param.getDefault("transport_max_newton_iterations", max_newton_iterations_);
+        max_step_cuts_ = param.getDefault("transport_max_step_cuts", max_step_cuts_);
+        linear_tolerance_ = param.getDefault("transport_linear_tolerance", linear_tolerance_);
+        linear_verbosity_ = param.getDefault("transport_linear_verbosity", linear_verbosity_);
+    }
+
+    void setup(const Grid& grid,
+               const Rock& rock,
+               const Fluid& fluid,
+               const Wells& wells,
+               const std::vector<double>& face_trans,
+               const typename Grid::Vector& gravity)
+    {
+        pgrid_ = &grid;
+        prock_ = &rock;
+        pfluid_ = &fluid;
+        pwells_ = &wells;
+        ptrans_ = &face_trans;
+        gravity_ = gravity;
+
+        const int num_cells = grid.numCells();
+        const int num_faces = grid.numFaces();
+        pore_volume_.resize(num_cells);
+        for (int cell = 0; cell < num_cells; ++cell) {
+            pore_volume_[cell] = rock.porosity(cell)*grid.cellVolume(cell);
+        }
+        face_gravity_flux_.resize(num_faces);
+        for (int face = 0; face < num_faces; ++face) {
+            const int c0 = grid.faceCell(face, 0);
+            const int c1 = grid.faceCell(face, 1);
+            typename Grid::Vector centroid_diff = c0 >= 0 ? grid.cellCentroid(c0) : grid.faceCentroid(face);
+            centroid_diff -= c1 >= 0 ? grid.cellCentroid(c1) : grid.faceCentroid(face);
+            face_gravity_flux_[face] = gravity*centroid_diff*face_trans[face];
+        }
+        allocateJacobian();
+    }
+
+
+    /// Return value is the time actually used, it may be smaller than dt if
+    /// we stop due to unacceptable volume discrepancy or Newton failure.
+    double transport(const PhaseVec& external_pressure,
+                     const CompVec& external_composition,
+                     const std::vector<double>& face_flux,
+                     const std::vector<PhaseVec>& cell_pressure,
+                     const std::vector<PhaseVec>& face_pressure,
+                     const double dt,
+                     const double voldisclimit,
+                     std::vector<CompVec>& cell_z)
+    {
+        bdy_ = computeProps(external_pressure, external_composition);
+        computeInjectionProps();
+        pwells_->wellReport().clearAll();
+        std::cout << "Implicit transport solver target time: " << dt << std::endl;
+        double cur_time = 0.0;
+        double step_time = dt;
+        int cuts = 0;
+        std::vector<CompVec> cell_z_start;
+        while (cur_time < dt) {
+            step_time = std::min(step_time, dt - cur_time);
+            cell_z_start = cell_z;
+            const bool converged = solveStep(face_flux, cell_pressure, face_pressure,
+                                             external_composition, step_time,
+                                             cell_z_start, cell_z);
+            if (!converged) {
+                cell_z = cell_z_start;
+                MetricsRegistry::current().counter("transport.step_cuts").add();
+                if (++cuts > max_step_cuts_) {
+                    std::cout << "    Implicit transport failed to converge." << std::endl;
+                    return cur_time;
+                }
+                step_time *= 0.5;
+                std::cout << "    Cutting transport step to " << step_time << std::endl;
+                continue;
+            }
+            double rel_voldiscr = *std::max_element(fluid_data_.relvoldiscr.begin(),
+                                                    fluid_data_.relvoldiscr.end());
+            if (rel_voldiscr > voldisclimit) {
+                std::cout << "    Relative volume discrepancy too large: " << rel_voldiscr << std::endl;
+                cell_z = cell_z_start;
+                return cur_time;
+            }
+            cur_time += step_time;
+            updateWellReport(cell_pressure);
+        }
+        return dt;
+    }
+
+
+private: // Types
+    typedef Dune::FieldVector<double, numComponents> VectorBlock;
+    typedef Dune::FieldMatrix<double, numComponents, numComponents> MatrixBlock;
+    typedef Dune::BlockVector<VectorBlock> Vector;
+    typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+
+    struct TransportFluidData
+    {
+        PhaseVec mobility;
+        PhaseVec fractional_flow;
+        PhaseToCompMatrix phase_to_comp;
+    };
+
+private: // Data
+    const Grid* pgrid_;
+    const Rock* prock_;
+    const Fluid* pfluid_;
+    const Wells* pwells_;
+    const std::vector<double>* ptrans_;
+    typename Grid::Vector gravity_;
+
+    double newton_tolerance_;
+    int max_newton_iterations_;
+    int max_step_cuts_;
+    double linear_tolerance_;
+    int linear_verbosity_;
+
+    std::vector<double> pore_volume_;
+    std::vector<double> face_gravity_flux_;
+    Opm::AllFluidData fluid_data_;
+    std::vector<MatrixBlock> ds_dz_;
+    TransportFluidData bdy_;
+    std::vector<TransportFluidData> injection_props_;
+    Matrix jacobian_;
+    Vector residual_;
+    Vector increment_;
+
+private: // Methods
+
+    // Fill the well report with the perforation terms of the last
+    // converged step, as ComponentTransport does.
+    void updateWellReport(const std::vector<PhaseVec>& cell_pressure) const
+    {
+        const AllFluidStates& cd = fluid_data_.cell_data;
+        const std::vector<typename Wells::Perforation>& perfs = pwells_->perforations();
+        const int num_perfs = perfs.size();
+        typename Wells::WellReport& report = pwells_->wellReport();
+        report.clearAll();
+        for (int perf = 0; perf < num_perfs; ++perf) {
+            const int cell = perfs[perf].cell;
+            const double flow = perfs[perf].flux;
+            if (flow == 0.0) {
+                continue;
+            }
+            const PhaseToCompMatrix& At = flow > 0.0 ? injection_props_[perf].phase_to_comp : cd.state_matrix[cell];
+            PhaseVec ff;
+            if (flow > 0.0) {
+                ff = injection_props_[perf].fractional_flow;
+            } else {
+                ff = cd.mobility[cell];
+                double tot_mob = 0.0;
+                for (int phase = 0; phase < numPhases; ++phase) {
+                    tot_mob += ff[phase];
+                }
+                ff /= tot_mob;
+            }
+            CompVec rate(0.0);
+            for (int phase = 0; phase < numPhases; ++phase) {
+                for (int comp = 0; comp < numComponents; ++comp) {
+                    rate[comp] += At[phase][comp]*ff[phase]*flow;
+                }
+            }
+            report.perfPressure.push_back(perfs[perf].pressure);
+            report.cellPressure.push_back(cell_pressure[cell][0]);
+            report.cellId.push_back(cell);
+            report.massRate.push_back(rate);
+        }
+    }
+
+    TransportFluidData computeProps(const PhaseVec& pressure,
+                                    const CompVec& composition) const
+    {
+        typename Fluid::FluidState state = pfluid_->computeState(pressure, composition);
+        TransportFluidData data;
+        data.mobility = state.mobility_;
+        double total_mobility = 0.0;
+        for (int phase = 0; phase < numPhases; ++phase) {
+            total_mobility += state.mobility_[phase];
+        }
+        data.fractional_flow = state.mobility_;
+        data.fractional_flow /= total_mobility;
+        data.phase_to_comp = state.phase_to_comp_;
+        return data;
+    }
+
+    // Injecting perforations see the injection mixture at perforation
+    // pressure, which does not change during transport.
+    void computeInjectionProps()
+    {
+        const std::vector<typename Wells::Perforation>& perfs = pwells_->perforations();
+        const int num_perfs = perfs.size();
+        injection_props_.resize(num_perfs);
+        for (int perf = 0; perf < num_perfs; ++perf) {
+            if (perfs[perf].flux > 0.0) {
+                injection_props_[perf] = computeProps(PhaseVec(perfs[perf].pressure),
+                                                      perfs[perf].injection_mixture);
+            }
+        }
+    }
+
+    // One cell row per cell, coupled to the cells sharing a face.
+    void allocateJacobian()
+    {
+        const int num_cells = pgrid_->numCells();
+        const int num_faces = pgrid_->numFaces();
+        std::vector<int> row_size(num_cells, 1);
+        for (int face = 0; face < num_faces; ++face) {
+            const int c0 = pgrid_->faceCell(face, 0);
+            const int c1 = pgrid_->faceCell(face, 1);
+            if (c0 >= 0 && c1 >= 0) {
+                ++row_size[c0];
+                ++row_size[c1];
+            }
+        }
+        jacobian_.setSize(num_cells, num_cells);
+        jacobian_.setBuildMode(Matrix::random);
+        for (int cell = 0; cell < num_cells; ++cell) {
+            jacobian_.setrowsize(cell, row_size[cell]);
+        }
+        jacobian_.endrowsizes();
+        for (int cell = 0; cell < num_cells; ++cell) {
+            jacobian_.addindex(cell, cell);
+        }
+        for (int face = 0; face < num_faces; ++face) {
+            const int c0 = pgrid_->faceCell(face, 0);
+            const int c1 = pgrid_->faceCell(face, 1);
+            if (c0 >= 0 && c1 >= 0) {
+                jacobian_.addindex(c0, c1);
+                jacobian_.addindex(c1, c0);
+            }
+        }
+        jacobian_.endindices();
+        residual_.resize(num_cells);
+        increment_.resize(num_cells);
+    }
+
+    bool solveStep(const std::vector<double>& face_flux,
+                   const std::vector<PhaseVec>& cell_pressure,
+                   const std::vector<PhaseVec>& face_pressure,
+                   const CompVec& bdy_z,
+                   const double dt,
+                   const std::vector<CompVec>& cell_z_old,
+                   std::vector<CompVec>& cell_z)
+    {
+        const int num_cells = cell_z.size();
+        MetricsRegistry& metrics = MetricsRegistry::current();
+        MetricsRegistry::Timer& fluid_timer = metrics.timer("fluid.properties.transport");
+        std::cout << "   Newton it.          Residual    Linear its." << std::endl;
+        for (int iter = 0; iter <= max_newton_iterations_; ++iter) {
+            {
+                ScopedTimer timer(fluid_timer);
+                fluid_data_.computeNew(*pgrid_, *prock_, *pfluid_, gravity_,
+                                       cell_pressure, face_pressure, cell_z, bdy_z, dt);
+            }
+            assemble(face_flux, dt, cell_z_old, cell_z);
+
+            // Residual measured as change in z relative to total z.
+            double res_norm = 0.0;
+            for (int cell = 0; cell < num_cells; ++cell) {
+                double total_z = 0.0;
+                for (int comp = 0; comp < numComponents; ++comp) {
+                    total_z += std::fabs(cell_z[cell][comp]);
+                }
+                const double scale = dt/(pore_volume_[cell]*std::max(total_z, 1e-10));
+                for (int comp = 0; comp < numComponents; ++comp) {
+                    res_norm = std::max(res_norm, std::fabs(residual_[cell][comp])*scale);
+                }
+            }
+            if (res_norm < newton_tolerance_) {
+                std::cout << std::setw(13) << iter << std::setw(18) << res_norm << std::endl;
+                metrics.histogram("transport.newton_iterations").add(iter);
+                return true;
+            }
+            if (iter == max_newton_iterations_ || !std::isfinite(res_norm)) {
+                break;
+            }
+
+            int linear_iterations = 0;
+            if (!solveLinearSystem(linear_iterations)) {
+                return false;
+            }
+            std::cout << std::setw(13) << iter << std::setw(18) << res_norm
+                      << std::setw(15) << linear_iterations << std::endl;
+            for (int cell = 0; cell < num_cells; ++cell) {
+                for (int comp = 0; comp < numComponents; ++comp) {
+                    cell_z[cell][comp] = std::max(cell_z[cell][comp] - increment_[cell][comp], 0.0);
+                }
+            }
+        }
+        return false;
+    }
+
+    bool solveLinearSystem(int& iterations)
+    {
+        Dune::MatrixAdapter<Matrix, Vector, Vector> op(jacobian_);
+        Dune::SeqILU0<Matrix, Vector, Vector> precond(jacobian_, 1.0);
+        Dune::BiCGSTABSolver<Vector> linsolve(op, precond, linear_tolerance_,
+                                              10*int(jacobian_.N()), linear_verbosity_);
+        Dune::InverseOperatorResult result;
+        Vector rhs(residual_);
+        increment_ = 0.0;
+        linsolve.apply(increment_, rhs, result);
+        iterations = result.iterations;
+        MetricsRegistry::current().histogram("transport.linear_iterations").add(iterations);
+        if (!result.converged) {
+            std::cout << "    Linear solver failed to converge in " << result.iterations
+                      << " iterations, residual reduction " << result.reduction << std::endl;
+        }
+        return result.converged;
+    }
+
+    // Derivatives of the saturations with respect to z, for fixed
+    // state matrix A: s = u/sum(u) with u = A^{-1} z.
+    void computeSaturationDerivatives()
+    {
+        const AllFluidStates& cd = fluid_data_.cell_data;
+        const int num_cells = cd.saturation.size();
+        ds_dz_.resize(num_cells);
+#pragma omp parallel for
+        for (int cell = 0; cell < num_cells; ++cell) {
+            const PhaseToCompMatrix& At = cd.state_matrix[cell];
+            MatrixBlock A;
+            for (int comp = 0; comp < numComponents; ++comp) {
+                for (int phase = 0; phase < numPhases; ++phase) {
+                    A[comp][phase] = At[phase][comp];
+                }
+            }
+            MatrixBlock Ai;
+            Dune::FMatrixHelp::invertMatrix(A, Ai);
+            const PhaseVec& s = cd.saturation[cell];
+            const double tot = cd.total_phase_volume_density[cell];
+            for (int k = 0; k < numComponents; ++k) {
+                double col_sum = 0.0;
+                for (int phase = 0; phase < numPhases; ++phase) {
+                    col_sum += Ai[phase][k];
+                }
+                for (int phase = 0; phase < numPhases; ++phase) {
+                    ds_dz_[cell][phase][k] = (Ai[phase][k] - s[phase]*col_sum)/tot;
+                }
+            }
+        }
+    }
+
+    // Derivatives of the mobilities of a cell with respect to its z.
+    MatrixBlock mobilityDerivatives(const int cell) const
+    {
+        const PhaseJacobian& dmob = fluid_data_.cell_data.mobility_deriv[cell];
+        MatrixBlock dm_dz(0.0);
+        for (int phase = 0; phase < numPhases; ++phase) {
+            for (int k = 0; k < numComponents; ++k) {
+                for (int r = 0; r < numPhases; ++r) {
+                    dm_dz[phase][k] += dmob[phase][r]*ds_dz_[cell][r][k];
+                }
+            }
+        }
+        return dm_dz;
+    }
+
+    // Residual
+    //   pv/dt (z - z_old) + sum_faces (component flux out) - well source
+    // and its Jacobian with respect to z.
+    void assemble(const std::vector<double>& face_flux,
+                  const double dt,
+                  const std::vector<CompVec>& cell_z_old,
+                  const std::vector<CompVec>& cell_z)
+    {
+        const int num_cells = pgrid_->numCells();
+        const int num_faces = pgrid_->numFaces();
+        const AllFluidStates& cd = fluid_data_.cell_data;
+        computeSaturationDerivatives();
+
+        jacobian_ = 0.0;
+        for (int cell = 0; cell < num_cells; ++cell) {
+            const double acc = pore_volume_[cell]/dt;
+            for (int comp = 0; comp < numComponents; ++comp) {
+                residual_[cell][comp] = acc*(cell_z[cell][comp] - cell_z_old[cell][comp]);
+                jacobian_[cell][cell][comp][comp] = acc;
+            }
+        }
+
+        for (int face = 0; face < num_faces; ++face) {
+            int c[2] = { pgrid_->faceCell(face, 0), pgrid_->faceCell(face, 1) };
+            const bool internal = c[0] >= 0 && c[1] >= 0;
+
+            // Phase densities on face.
+            PhaseVec phase_dens = pfluid_->phaseDensities(&fluid_data_.face_data.state_matrix[face][0][0]);
+
+            // Upwind directions, as in the explicit solver.
+            PhaseVec mob[2];
+            for (int ix = 0; ix < 2; ++ix) {
+                mob[ix] = c[ix] >= 0 ? cd.mobility[c[ix]] : bdy_.mobility;
+            }
+            int upwind_dir[numPhases] = { 0, 0, 0 };
+            PhaseVec vstar(face_flux[face]);
+            PhaseVec rho_star(phase_dens);
+            ExplicitCompositionalTransport<Grid, Rock, Fluid, Wells>
+                ::process_face(&mob[0][0], &mob[1][0], &vstar[0], face_gravity_flux_[face],
+                               numPhases, &rho_star[0], upwind_dir);
+            // No gravity flow across boundaries, as in the explicit solver.
+            const double gflux = internal ? face_gravity_flux_[face] : 0.0;
+
+            // Upwind mobilities, phase fluxes and their derivatives
+            // with respect to the upwind mobilities.
+            int up_cell[numPhases];
+            PhaseVec m;
+            double tot_mob = 0.0;
+            for (int phase = 0; phase < numPhases; ++phase) {
+                const int ix = upwind_dir[phase] - 1;
+                up_cell[phase] = c[ix];
+                m[phase] = mob[ix][phase];
+                tot_mob += m[phase];
+            }
+            if (tot_mob <= 0.0) {
+                continue;
+            }
+            const double v = face_flux[face];
+            double omega = 0.0;
+            for (int phase = 0; phase < numPhases; ++phase) {
+                omega += m[phase]*phase_dens[phase]/tot_mob;
+            }
+            PhaseVec f;
+            MatrixBlock df_dm;
+            for (int p = 0; p < numPhases; ++p) {
+                f[p] = m[p]/tot_mob*v - m[p]*(phase_dens[p] - omega)*gflux;
+                for (int q = 0; q < numPhases; ++q) {
+                    df_dm[p][q] = -m[p]*v/(tot_mob*tot_mob)
+                        + m[p]*gflux*(phase_dens[q] - omega)/tot_mob;
+                }
+                df_dm[p][p] += v/tot_mob - (phase_dens[p] - omega)*gflux;
+            }
+
+            // Component flux from c[0] to c[1].
+            CompVec flux(0.0);
+            MatrixBlock dflux_dm(0.0);
+            for (int p = 0; p < numPhases; ++p) {
+                const PhaseToCompMatrix& At = up_cell[p] >= 0 ? cd.state_matrix[up_cell[p]] : bdy_.phase_to_comp;
+                for (int comp = 0; comp < numComponents; ++comp) {
+                    flux[comp] += At[p][comp]*f[p];
+                    for (int q = 0; q < numPhases; ++q) {
+                        dflux_dm[comp][q] += At[p][comp]*df_dm[p][q];
+                    }
+                }
+            }
+            for (int ix = 0; ix < 2; ++ix) {
+                if (c[ix] >= 0) {
+                    const double sign = ix == 0 ? 1.0 : -1.0;
+                    for (int comp = 0; comp < numComponents; ++comp) {
+                        residual_[c[ix]][comp] += sign*flux[comp];
+                    }
+                }
+            }
+
+            // Chain rule through the mobilities of the upwind cells.
+            for (int ix = 0; ix < 2; ++ix) {
+                const int cell = c[ix];
+                if (cell < 0) {
+                    continue;
+                }
+                bool upwind_somewhere = false;
+                for (int q = 0; q < numPhases; ++q) {
+                    upwind_somewhere = upwind_somewhere || up_cell[q] == cell;
+                }
+                if (!upwind_somewhere) {
+                    continue;
+                }
+                const MatrixBlock dm_dz = mobilityDerivatives(cell);
+                MatrixBlock dflux_dz(0.0);
+                for (int comp = 0; comp < numComponents; ++comp) {
+                    for (int q = 0; q < numPhases; ++q) {
+                        if (up_cell[q] != cell) {
+                            continue;
+                        }
+                        for (int k = 0; k < numComponents; ++k) {
+                            dflux_dz[comp][k] += dflux_dm[comp][q]*dm_dz[q][k];
+                        }
+                    }
+                }
+                for (int jx = 0; jx < 2; ++jx) {
+                    if (c[jx] >= 0) {
+                        MatrixBlock contrib = dflux_dz;
+                        contrib *= jx == 0 ? 1.0 : -1.0;
+                        jacobian_[c[jx]][cell] += contrib;
+                    }
+                }
+            }
+        }
+
+        // Well perforations. Injection is fixed, production uses the
+        // fractional flow and state matrix of the cell.
+        const std::vector<typename Wells::Perforation>& perfs = pwells_->perforations();
+        const int num_perfs = perfs.size();
+        for (int perf = 0; perf < num_perfs; ++perf) {
+            const int cell = perfs[perf].cell;
+            const double flow = perfs[perf].flux;
+            if (flow == 0.0) {
+                continue;
+            }
+            if (flow > 0.0) {
+                const TransportFluidData& fl = injection_props_[perf];
+                for (int phase = 0; phase < numPhases; ++phase) {
+                    for (int comp = 0; comp < numComponents; ++comp) {
+                        residual_[cell][comp] -= fl.phase_to_comp[phase][comp]*fl.fractional_flow[phase]*flow;
+                    }
+                }
+            } else {
+                const PhaseVec& mob = cd.mobility[cell];
+                const PhaseToCompMatrix& At = cd.state_matrix[cell];
+                double tot_mob = 0.0;
+                for (int phase = 0; phase < numPhases; ++phase) {
+                    tot_mob += mob[phase];
+                }
+                const MatrixBlock dm_dz = mobilityDerivatives(cell);
+                for (int phase = 0; phase < numPhases; ++phase) {
+                    const double ff = mob[phase]/tot_mob;
+                    for (int comp = 0; comp < numComponents; ++comp) {
+                        residual_[cell][comp] -= At[phase][comp]*ff*flow;
+                        for (int q = 0; q < numPhases; ++q) {
+                            const double dff_dm = ((phase == q ? 1.0 : 0.0) - ff)/tot_mob;
+                            for (int k = 0; k < numComponents; ++k) {
+                                jacobian_[cell][cell][comp][k] -= At[phase][comp]*dff_dm*dm_dz[q][k]*flow;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+
+} // namespace Opm
+
+
+#endif // OPM_IMPLICITCOMPOSITIONALTRANSPORT_HEADER_INCLUDED
@@ -0,0 +1,233 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_TIMESTEPCONTROL_HEADER_INCLUDED
+#define OPM_TIMESTEPCONTROL_HEADER_INCLUDED
+
+#include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <opm/common/ErrorMacros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace Opm
+{
+
+    /// Interface for step size controllers of BlackoilSimulator.
+    class TimeStepControlInterface
+    {
+    public:
+        /// Measurements from a (possibly rejected) step. Quantities
+        /// that are not available are negative.
+        struct StepInfo
+        {
+            StepInfo()
+                : nonlinear_iterations(-1), rel_voldiscr(-1.0),
+                  max_sat_change(-1.0), stable_stepsize(-1.0)
+            {
+            }
+            int nonlinear_iterations;  // Pressure solver iterations.
+            double rel_voldiscr;       // Max relative volume discrepancy.
+            double max_sat_change;     // Max saturation change over the step.
+            double stable_stepsize;    // IMPES stability limit.
+        };
+
+        enum Rejection { NonlinearFailure, VolumeDiscrepancy, StabilityLimit };
+
+        virtual ~TimeStepControlInterface() {}
+
+        /// Step size for the step following an accepted step of size dt.
+        virtual double accepted(const double dt, const StepInfo& info) = 0;
+
+        /// Step size to retry with after a step of size dt was rejected.
+        virtual double rejected(const double dt, const Rejection reason, const StepInfo& info) = 0;
+
+        /// Internal state carried between steps, for checkpointing.
+        virtual std::vector<double> state() const
+        {
+            return std::vector<double>();
+        }
+
+        /// Restore a state obtained from state().
+        virtual void setState(const std::vector<double>& s)
+        {
+            if (!s.empty()) {
+                OPM_THROW(std::runtime_error, "Step control has no state to restore.");
+            }
+        }
+    };
+
+
+
+    /// The classic policy: grow by a fixed factor up to a maximum,
+    /// halve on failure, and use 2/3 of the IMPES limit.
+    class SimpleTimeStepControl : public TimeStepControlInterface
+    {
+    public:
+        SimpleTimeStepControl(const double increase_factor, const double maximum_stepsize)
+            : increase_factor_(increase_factor), maximum_stepsize_(maximum_stepsize)
+        {
+        }
+
+        virtual double accepted(const double dt, const StepInfo&)
+        {
+            if (dt < maximum_stepsize_) {
+                return std::min(maximum_stepsize_, dt*increase_factor_);
+            }
+            return dt;
+        }
+
+        virtual double rejected(const double dt, const Rejection reason, const StepInfo& info)
+        {
+            if (reason == StabilityLimit) {
+                return info.stable_stepsize/1.5;
+            }
+            return 0.5*dt;
+        }
+
+    private:
+        double increase_factor_;
+        double maximum_stepsize_;
+    };
+
+
+
+    /// PID step size control on a normalized error
+    ///    e = max(iterations/target_iterations,
+    ///            rel_voldiscr/target_voldiscr,
+    ///            sat_change/target_sat_change),
+    /// so that e = 1 is the step we aim for. After an accepted step,
+    ///    dt <- dt * (e_{n-1}/e_n)^kP * (1/e_n)^kI * (e_{n-1}^2/(e_n e_{n-2}))^kD,
+    /// with the change limited to [pid_min_factor, pid_max_growth].
+    /// After a rejection the step is cut in proportion to e when known,
+    /// rejecting a step of the minimum size throws.
+    ///
+    /// Parameters (with defaults):
+    ///   pid_target_iterations  (5)
+    ///   pid_target_voldiscr    (0.05)
+    ///   pid_target_sat_change  (0.2)
+    ///   pid_kp, pid_ki, pid_kd (0.075, 0.175, 0.01)
+    ///   pid_min_factor         (0.5)
+    ///   pid_max_growth         (2.0)
+    class PIDTimeStepControl : public TimeStepControlInterface
+    {
+    public:
+        PIDTimeStepControl(const Opm::parameter::ParameterGroup& param,
+                           const double minimum_stepsize,
+                           const double maximum_stepsize)
+            : minimum_stepsize_(minimum_stepsize), maximum_stepsize_(maximum_stepsize)
+        {
+            target_iterations_ = param.getDefault("pid_target_iterations", 5.0);
+            target_voldiscr_ = param.getDefault("pid_target_voldiscr", 0.05);
+            target_sat_change_ = param.getDefault("pid_target_sat_change", 0.2);
+            kp_ = param.getDefault("pid_kp", 0.075);
+            ki_ = param.getDefault("pid_ki", 0.175);
+            kd_ = param.getDefault("pid_kd", 0.01);
+            min_factor_ = param.getDefault("pid_min_factor", 0.5);
+            max_growth_ = param.getDefault("pid_max_growth", 2.0);
+            if (target_iterations_ <= 0.0 || target_voldiscr_ <= 0.0 || target_sat_change_ <= 0.0) {
+                OPM_THROW(std::runtime_error, "PID step control targets must be positive.");
+            }
+            if (min_factor_ <= 0.0 || min_factor_ > 1.0 || max_growth_ < 1.0) {
+                OPM_THROW(std::runtime_error, "Need 0 < pid_min_factor <= 1 <= pid_max_growth.");
+            }
+            errors_[0] = errors_[1] = 1.0;
+        }
+
+        virtual double accepted(const double dt, const StepInfo& info)
+        {
+            const double e = error(info);
+            const double factor = std::pow(errors_[1]/e, kp_)
+                * std::pow(1.0/e, ki_)
+                * std::pow(errors_[1]*errors_[1]/(e*errors_[0]), kd_);
+            errors_[0] = errors_[1];
+            errors_[1] = e;
+            return limit(dt*std::max(min_factor_, std::min(max_growth_, factor)));
+        }
+
+        virtual double rejected(const double dt, const Rejection reason, const StepInfo& info)
+        {
+            // limit() would return the same step again, and the
+            // simulator would retry it forever.
+            if (dt <= minimum_stepsize_) {
+                OPM_THROW(std::runtime_error, "Time step below minimum: step of " << dt
+                          << " rejected, minimum_stepsize is " << minimum_stepsize_);
+            }
+            if (reason == StabilityLimit) {
+                return limit(info.stable_stepsize/1.5);
+            }
+            const double e = error(info);
+            // Aim a bit below the target to avoid repeated rejections.
+            const double factor = e > 1.0 ? std::max(0.1, 0.8/e) : 0.5;
+            return limit(dt*std::min(0.5, factor));
+        }
+
+        virtual std::vector<double> state() const
+        {
+            return std::vector<double>(errors_, errors_ + 2);
+        }
+
+        virtual void setState(const std::vector<double>& s)
+        {
+            if (s.size() != 2) {
+                OPM_THROW(std::runtime_error, "PID step control expected 2 state values, got " << s.size());
+            }
+            errors_[0] = s[0];
+            errors_[1] = s[1];
+        }
+
+    private:
+        double target_iterations_;
+        double target_voldiscr_;
+        double target_sat_change_;
+        double kp_;
+        double ki_;
+        double kd_;
+        double min_factor_;
+        double max_growth_;
+        double minimum_stepsize_;
+        double maximum_stepsize_;
+        double errors_[2];   // e_{n-2}, e_{n-1}
+
+        double error(const StepInfo& info) const
+        {
+            double e = 0.0;
+            if (info.nonlinear_iterations >= 0) {
+                e = std::max(e, info.nonlinear_iterations/target_iterations_);
+            }
+            if (info.rel_voldiscr >= 0.0) {
+                e = std::max(e, info.rel_voldiscr/target_voldiscr_);
+            }
+            if (info.max_sat_change >= 0.0) {
+                e = std::max(e, info.max_sat_change/target_sat_change_);
+            }
+            // Avoid division by zero (and huge growth) for trivial steps.
+            return std::max(e, 1e-3);
+        }
+
+        double limit(const double dt) const
+        {
+            return std::max(minimum_stepsize_, std::min(maximum_stepsize_, dt));
+        }
+    };
+
+} // namespace Opm
+
+#endif // OPM_TIMESTEPCONTROL_HEADER_INCLUDED
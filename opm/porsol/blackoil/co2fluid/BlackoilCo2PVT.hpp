@@ -34,9 +34,13 @@
 #include <opm/porsol/blackoil/co2fluid/benchmark3co2tables.hh>
 #include <opm/porsol/blackoil/fluid/MiscibilityProps.hpp>
 #include <opm/porsol/blackoil/fluid/BlackoilDefs.hpp>
+#include <opm/porsol/common/UniformTableBilinear.hpp>
+#include <opm/core/utility/UniformTableLinear.hpp>
 
 #include <opm/parser/eclipse/Deck/Deck.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <iostream>
 #include <fstream>
@@ -93,6 +97,38 @@ public:
               std::vector<PhaseVec>& output_R,
               std::vector<PhaseVec>& output_dRdp) const;
 
+    void evalAll(const std::vector<PhaseVec>& pressures,
+                 const std::vector<CompVec>& surfvol,
+                 std::vector<PhaseVec>& output_B,
+                 std::vector<PhaseVec>& output_dBdp,
+                 std::vector<PhaseVec>& output_R,
+                 std::vector<PhaseVec>& output_dRdp,
+                 std::vector<PhaseVec>& output_mu) const;
+    void evalAll(int num,
+                 const PhaseVec* pressures,
+                 const CompVec* surfvol,
+                 const PvtBatchOutput& output) const;
+    /// As above, at a single point. Takes one flash, or two if
+    /// the flash is not tabulated (for the difference quotients).
+    void evalAll(const PhaseVec& pressures,
+                 const CompVec& surfvol,
+                 PhaseVec& output_B,
+                 PhaseVec& output_dBdp,
+                 PhaseVec& output_R,
+                 PhaseVec& output_dRdp,
+                 PhaseVec& output_mu) const;
+
+    /// Switch to evaluation from the flash results tabulated on a
+    /// uniform grid of num_pressure_samples pressures (the range of
+    /// generateBlackOilTables()) and num_fraction_samples CO2 mass
+    /// fractions in [0, 1], with derivatives from the bilinear
+    /// interpolant instead of extra flashes. Outside the pressure
+    /// range the table is clamped. Returns the largest relative
+    /// deviation from the exact flash found at the midpoints of the
+    /// grid. Without this call every evaluation runs the exact flash,
+    /// which is the validation mode.
+    double tabulate(int num_pressure_samples, int num_fraction_samples);
+
 private:
 	CompVec surfaceDensities_;
 	FluidSystem brineCo2_;
@@ -106,6 +142,34 @@ private:
         double saturation;
     };
     void computeState(SubState& ss, double zBrine, double zCO2, double pressure) const;
+    // Black-oil quantities of all phases at one point.
+    struct PointValues
+    {
+        PhaseVec B, dBdp, R, dRdp, mu;
+        double saturation;
+    };
+    void blackoilValues(const SubState& ss, PhaseVec& B, PhaseVec& R, PhaseVec& mu) const;
+    void evalPoint(double press, const CompVec& surfvol, bool derivs, PointValues& v) const;
+    double co2MassFraction(double zBrine, double zCO2) const;
+
+    void evalTabulated(double press, double c, SubState& ss, SubState& dssdp) const;
+    // The tabulated quantities, as entries of a SubState.
+    static double& primitive(SubState& ss, int item);
+
+    // Tabulated flash results, used if tabulated_ is true. The phase
+    // densities, dissolved mass fractions and viscosities are stored
+    // for the two-phase region as functions of pressure only, and for
+    // each single-phase region on a (pressure, s) grid, where s is the
+    // CO2 mass fraction c scaled so that s = 1 on the phase boundary
+    // (s = c/X_w^CO2(p) for brine only, s = (1 - c)/X_n^brine(p) for
+    // CO2 only). The phase boundaries are then grid lines.
+    enum { RhoW, RhoN, XwN, XnW, MuW, MuN, NumItems };
+    bool tabulated_;
+    double table_pmin_;
+    double table_pmax_;
+    Opm::utils::UniformTableLinear<double> saturated_table_[NumItems];
+    Opm::utils::UniformTableBilinear<double> brine_only_table_[NumItems];
+    Opm::utils::UniformTableBilinear<double> co2_only_table_[NumItems];
     enum {
         wPhase = FluidSystem::liquidPhaseIdx,
         nPhase = FluidSystem::gasPhaseIdx,
@@ -127,6 +191,10 @@ void BlackoilCo2PVT::init(Opm::DeckConstPtr deck)
     temperature_ = 300.;
 
     brineCo2_.init();
+
+    tabulated_ = false;
+    table_pmin_ = 101330.0;
+    table_pmax_ = 400.e5;
 }
 
 void BlackoilCo2PVT::generateBlackOilTables(double temperature)
@@ -138,6 +206,8 @@ void BlackoilCo2PVT::generateBlackOilTables(double temperature)
     }
 
     temperature_ = temperature;
+    // Any tabulated flash results are for the old temperature.
+    tabulated_ = false;
 
     CompVec z;
     z[Water] = 0.0;
@@ -246,25 +316,20 @@ BlackoilCo2PVT::CompVec BlackoilCo2PVT::surfaceDensities() const
 
 double BlackoilCo2PVT::getViscosity(double press, const CompVec& surfvol, PhaseIndex phase) const
 {
-    SubState ss;
-    computeState(ss, surfvol[Oil], surfvol[Gas], press);
-    switch(phase) {
-    case Aqua: return 1.0e-10;
-    case Liquid: return ss.phaseViscosity[wPhase];
-    case Vapour: return ss.phaseViscosity[nPhase];
-    };
-    return 1.0e-10;
+    PointValues v;
+    evalPoint(press, surfvol, false, v);
+    return v.mu[phase];
 }
 
 
 double BlackoilCo2PVT::getSaturation(double press, const CompVec& surfvol, PhaseIndex phase) const
 {
-    SubState ss;
-    computeState(ss, surfvol[Oil], surfvol[Gas], press);
+    PointValues v;
+    evalPoint(press, surfvol, false, v);
     switch(phase) {
     case Aqua: return 0.0;
-    case Liquid: return ss.saturation;
-    case Vapour: return 1.0 - ss.saturation;
+    case Liquid: return v.saturation;
+    case Vapour: return 1.0 - v.saturation;
     };
     return 0.0;
 }
@@ -272,38 +337,30 @@ double BlackoilCo2PVT::getSaturation(double press, const CompVec& surfvol, Phase
     
 double BlackoilCo2PVT::B(double press, const CompVec& surfvol, PhaseIndex phase) const
 {
-    SubState ss;
-    computeState(ss, surfvol[Oil], surfvol[Gas], press);
-    switch(phase) {
-    case Aqua: return 1.0;
-    case Liquid: return surfaceDensities_[Oil]/(ss.massfrac[wPhase][wComp]*ss.density[wPhase]+1.0e-10);
-    case Vapour: return surfaceDensities_[Gas]/(ss.massfrac[nPhase][nComp]*ss.density[nPhase]+1.0e-10);
-    };
-    return 1.0;
+    PointValues v;
+    evalPoint(press, surfvol, false, v);
+    return v.B[phase];
 }
 
 double BlackoilCo2PVT::dBdp(double press, const CompVec& surfvol, PhaseIndex phase) const
 {
-    const double dp = 100.;
-    return (B(press+dp,surfvol,phase)-B(press,surfvol,phase))/dp;
+    PointValues v;
+    evalPoint(press, surfvol, true, v);
+    return v.dBdp[phase];
 }
 
 double BlackoilCo2PVT::R(double press, const CompVec& surfvol, PhaseIndex phase) const
 {
-    SubState ss;
-    computeState(ss, surfvol[Oil], surfvol[Gas], press);
-    switch(phase) {
-    case Aqua: return 0.0;
-    case Liquid: return (ss.massfrac[wPhase][nComp]*surfaceDensities_[Oil])/(ss.massfrac[wPhase][wComp]*surfaceDensities_[Gas]+1.0e-10);
-    case Vapour: return (ss.massfrac[nPhase][wComp]*surfaceDensities_[Gas])/(ss.massfrac[nPhase][nComp]*surfaceDensities_[Oil]+1.0e-10);
-    };
-    return 0.0;
+    PointValues v;
+    evalPoint(press, surfvol, false, v);
+    return v.R[phase];
 }
 
 double BlackoilCo2PVT::dRdp(double press, const CompVec& surfvol, PhaseIndex phase) const
 {
-    const double dp = 100.;
-    return (R(press+dp,surfvol,phase)-R(press,surfvol,phase))/dp;
+    PointValues v;
+    evalPoint(press, surfvol, true, v);
+    return v.dRdp[phase];
 }
 
 void BlackoilCo2PVT::getViscosity(const std::vector<PhaseVec>& pressures,
@@ -312,13 +369,9 @@ void BlackoilCo2PVT::getViscosity(const std::vector<PhaseVec>& pressures,
 {
     int num = pressures.size();
     output.resize(num);
-    SubState ss;
-    for (int i = 0; i < num; ++i) {
-        computeState(ss, surfvol[i][Oil], surfvol[i][Gas], pressures[i][Liquid]);
-        output[i][Aqua] = 1.0e-10;
-        output[i][Liquid] = ss.phaseViscosity[wPhase];
-        output[i][Vapour] = ss.phaseViscosity[nPhase];
-    }
+    PvtBatchOutput out;
+    out.viscosity = output.data();
+    evalAll(num, pressures.data(), surfvol.data(), out);
 }
 
 void BlackoilCo2PVT::B(const std::vector<PhaseVec>& pressures,
@@ -327,13 +380,9 @@ void BlackoilCo2PVT::B(const std::vector<PhaseVec>& pressures,
 {
     int num = pressures.size();
     output.resize(num);
-    SubState ss;
-    for (int i = 0; i < num; ++i) {
-        computeState(ss, surfvol[i][Oil], surfvol[i][Gas], pressures[i][Liquid]);
-        output[i][Aqua] = 1.0;
-        output[i][Liquid] = surfaceDensities_[Oil]/(ss.massfrac[wPhase][wComp]*ss.density[wPhase]+1.0e-10);
-        output[i][Vapour] = surfaceDensities_[Gas]/(ss.massfrac[nPhase][nComp]*ss.density[nPhase]+1.0e-10);
-    }
+    PvtBatchOutput out;
+    out.B = output.data();
+    evalAll(num, pressures.data(), surfvol.data(), out);
 }
 
 void BlackoilCo2PVT::dBdp(const std::vector<PhaseVec>& pressures,
@@ -344,18 +393,10 @@ void BlackoilCo2PVT::dBdp(const std::vector<PhaseVec>& pressures,
     int num = pressures.size();
     output_B.resize(num);
     output_dBdp.resize(num);
-    SubState ss;
-    const double dp = 100.;
-    for (int i = 0; i < num; ++i) {
-        computeState(ss, surfvol[i][Oil], surfvol[i][Gas], pressures[i][Liquid]);
-        output_B[i][Aqua] = 1.0;
-        output_B[i][Liquid] = surfaceDensities_[Oil]/(ss.massfrac[wPhase][wComp]*ss.density[wPhase]+1.0e-10);
-        output_B[i][Vapour] = surfaceDensities_[Gas]/(ss.massfrac[nPhase][nComp]*ss.density[nPhase]+1.0e-10);
-        computeState(ss, surfvol[i][Oil], surfvol[i][Gas], pressures[i][Liquid]+dp);
-        output_dBdp[i][Aqua] = 0.0;
-        output_dBdp[i][Liquid] = (surfaceDensities_[Oil]/(ss.massfrac[wPhase][wComp]*ss.density[wPhase]+1.0e-10) - output_B[i][Liquid])/dp;
-        output_dBdp[i][Vapour] = (surfaceDensities_[Gas]/(ss.massfrac[nPhase][nComp]*ss.density[nPhase]+1.0e-10) - output_B[i][Vapour])/dp;
-    }
+    PvtBatchOutput out;
+    out.B = output_B.data();
+    out.dBdp = output_dBdp.data();
+    evalAll(num, pressures.data(), surfvol.data(), out);
 }
 
 void BlackoilCo2PVT::R(const std::vector<PhaseVec>& pressures,
@@ -364,13 +405,9 @@ void BlackoilCo2PVT::R(const std::vector<PhaseVec>& pressures,
 {
     int num = pressures.size();
     output.resize(num);
-    SubState ss;
-    for (int i = 0; i < num; ++i) {
-        computeState(ss, surfvol[i][Oil], surfvol[i][Gas], pressures[i][Liquid]);
-        output[i][Aqua] = 0.0;
-        output[i][Liquid] = (ss.massfrac[wPhase][nComp]*surfaceDensities_[Oil])/(ss.massfrac[wPhase][wComp]*surfaceDensities_[Gas]+1.0e-10);
-        output[i][Vapour] = (ss.massfrac[nPhase][wComp]*surfaceDensities_[Gas])/(ss.massfrac[nPhase][nComp]*surfaceDensities_[Oil]+1.0e-10);
-    }
+    PvtBatchOutput out;
+    out.R = output.data();
+    evalAll(num, pressures.data(), surfvol.data(), out);
 }
 
 void BlackoilCo2PVT::dRdp(const std::vector<PhaseVec>& pressures,
@@ -381,20 +418,296 @@ void BlackoilCo2PVT::dRdp(const std::vector<PhaseVec>& pressures,
     int num = pressures.size();
     output_R.resize(num);
     output_dRdp.resize(num);
-    SubState ss;
-    const double dp = 100.;
+    PvtBatchOutput out;
+    out.R = output_R.data();
+    out.dRdp = output_dRdp.data();
+    evalAll(num, pressures.data(), surfvol.data(), out);
+}
+    
+void BlackoilCo2PVT::evalAll(const std::vector<PhaseVec>& pressures,
+                             const std::vector<CompVec>& surfvol,
+                             std::vector<PhaseVec>& output_B,
+                             std::vector<PhaseVec>& output_dBdp,
+                             std::vector<PhaseVec>& output_R,
+                             std::vector<PhaseVec>& output_dRdp,
+                             std::vector<PhaseVec>& output_mu) const
+{
+    int num = pressures.size();
+    output_B.resize(num);
+    output_dBdp.resize(num);
+    output_R.resize(num);
+    output_dRdp.resize(num);
+    output_mu.resize(num);
+    PvtBatchOutput output;
+    output.B = output_B.data();
+    output.dBdp = output_dBdp.data();
+    output.R = output_R.data();
+    output.dRdp = output_dRdp.data();
+    output.viscosity = output_mu.data();
+    evalAll(num, pressures.data(), surfvol.data(), output);
+}
+
+void BlackoilCo2PVT::evalAll(const int num,
+                             const PhaseVec* pressures,
+                             const CompVec* surfvol,
+                             const PvtBatchOutput& output) const
+{
+    const bool derivs = output.dBdp || output.dRdp;
+    // The flash calls into the opm-material fluid system, which is
+    // not known to be re-entrant, so only the table lookups (read
+    // only after tabulate()) are done in parallel.
+#pragma omp parallel for if (tabulated_)
     for (int i = 0; i < num; ++i) {
-        computeState(ss, surfvol[i][Oil], surfvol[i][Gas], pressures[i][Liquid]);
-        output_R[i][Aqua] = 0.0;
-        output_R[i][Liquid] = (ss.massfrac[wPhase][nComp]*surfaceDensities_[Oil])/(ss.massfrac[wPhase][wComp]*surfaceDensities_[Gas]+1.0e-10);
-        output_R[i][Vapour] = (ss.massfrac[nPhase][wComp]*surfaceDensities_[Gas])/(ss.massfrac[nPhase][nComp]*surfaceDensities_[Oil]+1.0e-10);
-        computeState(ss, surfvol[i][Oil], surfvol[i][Gas], pressures[i][Liquid]+dp);
-        output_dRdp[i][Aqua] = 0.0;
-        output_dRdp[i][Liquid] = ((ss.massfrac[wPhase][nComp]*surfaceDensities_[Oil])/(ss.massfrac[wPhase][wComp]*surfaceDensities_[Gas]+1.0e-10) - output_R[i][Liquid])/dp;
-        output_dRdp[i][Vapour] = ((ss.massfrac[nPhase][wComp]*surfaceDensities_[Gas])/(ss.massfrac[nPhase][nComp]*surfaceDensities_[Oil]+1.0e-10) - output_R[i][Vapour])/dp;
+        PointValues v;
+        evalPoint(pressures[i][Liquid], surfvol[i], derivs, v);
+        if (output.B) output.B[i] = v.B;
+        if (output.dBdp) output.dBdp[i] = v.dBdp;
+        if (output.R) output.R[i] = v.R;
+        if (output.dRdp) output.dRdp[i] = v.dRdp;
+        if (output.viscosity) output.viscosity[i] = v.mu;
     }
 }
-    
+
+void BlackoilCo2PVT::evalAll(const PhaseVec& pressures,
+                             const CompVec& surfvol,
+                             PhaseVec& output_B,
+                             PhaseVec& output_dBdp,
+                             PhaseVec& output_R,
+                             PhaseVec& output_dRdp,
+                             PhaseVec& output_mu) const
+{
+    PointValues v;
+    evalPoint(pressures[Liquid], surfvol, true, v);
+    output_B = v.B;
+    output_dBdp = v.dBdp;
+    output_R = v.R;
+    output_dRdp = v.dRdp;
+    output_mu = v.mu;
+}
+
+void BlackoilCo2PVT::blackoilValues(const SubState& ss, PhaseVec& B, PhaseVec& R, PhaseVec& mu) const
+{
+    B[Aqua] = 1.0;
+    B[Liquid] = surfaceDensities_[Oil]/(ss.massfrac[wPhase][wComp]*ss.density[wPhase]+1.0e-10);
+    B[Vapour] = surfaceDensities_[Gas]/(ss.massfrac[nPhase][nComp]*ss.density[nPhase]+1.0e-10);
+    R[Aqua] = 0.0;
+    R[Liquid] = (ss.massfrac[wPhase][nComp]*surfaceDensities_[Oil])/(ss.massfrac[wPhase][wComp]*surfaceDensities_[Gas]+1.0e-10);
+    R[Vapour] = (ss.massfrac[nPhase][wComp]*surfaceDensities_[Gas])/(ss.massfrac[nPhase][nComp]*surfaceDensities_[Oil]+1.0e-10);
+    mu[Aqua] = 1.0e-10;
+    mu[Liquid] = ss.phaseViscosity[wPhase];
+    mu[Vapour] = ss.phaseViscosity[nPhase];
+}
+
+double BlackoilCo2PVT::co2MassFraction(double zBrine, double zCO2) const
+{
+    const double massH20 = surfaceDensities_[Oil]*zBrine;
+    const double massCO2 = surfaceDensities_[Gas]*zCO2;
+    return massCO2/(massH20 + massCO2);
+}
+
+void BlackoilCo2PVT::evalPoint(double press, const CompVec& surfvol, bool derivs, PointValues& v) const
+{
+    SubState ss;
+    if (tabulated_) {
+        // Derivatives of the interpolants, by the chain rule.
+        SubState dss;
+        evalTabulated(press, co2MassFraction(surfvol[Oil], surfvol[Gas]), ss, dss);
+        blackoilValues(ss, v.B, v.R, v.mu);
+        v.saturation = ss.saturation;
+        const double rhoO = surfaceDensities_[Oil];
+        const double rhoG = surfaceDensities_[Gas];
+        const double denBL = ss.massfrac[wPhase][wComp]*ss.density[wPhase] + 1.0e-10;
+        const double denBV = ss.massfrac[nPhase][nComp]*ss.density[nPhase] + 1.0e-10;
+        const double denRL = ss.massfrac[wPhase][wComp]*rhoG + 1.0e-10;
+        const double denRV = ss.massfrac[nPhase][nComp]*rhoO + 1.0e-10;
+        v.dBdp[Aqua] = 0.0;
+        v.dBdp[Liquid] = -rhoO*(dss.massfrac[wPhase][wComp]*ss.density[wPhase]
+                                + ss.massfrac[wPhase][wComp]*dss.density[wPhase])/(denBL*denBL);
+        v.dBdp[Vapour] = -rhoG*(dss.massfrac[nPhase][nComp]*ss.density[nPhase]
+                                + ss.massfrac[nPhase][nComp]*dss.density[nPhase])/(denBV*denBV);
+        v.dRdp[Aqua] = 0.0;
+        v.dRdp[Liquid] = rhoO*(dss.massfrac[wPhase][nComp]*denRL
+                               - ss.massfrac[wPhase][nComp]*dss.massfrac[wPhase][wComp]*rhoG)/(denRL*denRL);
+        v.dRdp[Vapour] = rhoG*(dss.massfrac[nPhase][wComp]*denRV
+                               - ss.massfrac[nPhase][wComp]*dss.massfrac[nPhase][nComp]*rhoO)/(denRV*denRV);
+        return;
+    }
+    // One flash gives all values, and a second one (only if asked
+    // for) gives the difference quotients.
+    computeState(ss, surfvol[Oil], surfvol[Gas], press);
+    blackoilValues(ss, v.B, v.R, v.mu);
+    v.saturation = ss.saturation;
+    if (derivs) {
+        const double dp = 100.;
+        PhaseVec B2, R2, mu2;
+        computeState(ss, surfvol[Oil], surfvol[Gas], press+dp);
+        blackoilValues(ss, B2, R2, mu2);
+        for (int phase = 0; phase < numPhases; ++phase) {
+            v.dBdp[phase] = (B2[phase] - v.B[phase])/dp;
+            v.dRdp[phase] = (R2[phase] - v.R[phase])/dp;
+        }
+    } else {
+        v.dBdp = 0.0;
+        v.dRdp = 0.0;
+    }
+}
+
+double& BlackoilCo2PVT::primitive(SubState& ss, int item)
+{
+    switch (item) {
+    case RhoW: return ss.density[wPhase];
+    case RhoN: return ss.density[nPhase];
+    case XwN: return ss.massfrac[wPhase][nComp];
+    case XnW: return ss.massfrac[nPhase][wComp];
+    case MuW: return ss.phaseViscosity[wPhase];
+    default: return ss.phaseViscosity[nPhase];
+    }
+}
+
+void BlackoilCo2PVT::evalTabulated(double press, double c, SubState& ss, SubState& dssdp) const
+{
+    // Equilibrium mass fractions of CO2 in brine and brine in CO2.
+    const double xe = saturated_table_[XwN](press);
+    const double ye = saturated_table_[XnW](press);
+    if (c <= xe) {
+        // Brine only, with all CO2 dissolved.
+        const double s = c/xe;
+        const double dsdp = -s*saturated_table_[XwN].derivative(press)/xe;
+        for (int item = 0; item < NumItems; ++item) {
+            double dfdp, dfds;
+            brine_only_table_[item].evaluate(press, s, primitive(ss, item), dfdp, dfds);
+            primitive(dssdp, item) = dfdp + dfds*dsdp;
+        }
+        primitive(ss, XwN) = c;
+        primitive(dssdp, XwN) = 0.0;
+        ss.saturation = 1.0;
+    } else if (c >= 1.0 - ye) {
+        // CO2 only, with all brine vaporised.
+        const double s = (1.0 - c)/ye;
+        const double dsdp = -s*saturated_table_[XnW].derivative(press)/ye;
+        for (int item = 0; item < NumItems; ++item) {
+            double dfdp, dfds;
+            co2_only_table_[item].evaluate(press, s, primitive(ss, item), dfdp, dfds);
+            primitive(dssdp, item) = dfdp + dfds*dsdp;
+        }
+        primitive(ss, XnW) = 1.0 - c;
+        primitive(dssdp, XnW) = 0.0;
+        ss.saturation = 0.0;
+    } else {
+        // Both phases, at equilibrium.
+        for (int item = 0; item < NumItems; ++item) {
+            primitive(ss, item) = saturated_table_[item](press);
+            primitive(dssdp, item) = saturated_table_[item].derivative(press);
+        }
+    }
+    ss.massfrac[wPhase][wComp] = 1.0 - ss.massfrac[wPhase][nComp];
+    ss.massfrac[nPhase][nComp] = 1.0 - ss.massfrac[nPhase][wComp];
+    dssdp.massfrac[wPhase][wComp] = -dssdp.massfrac[wPhase][nComp];
+    dssdp.massfrac[nPhase][nComp] = -dssdp.massfrac[nPhase][wComp];
+    if (c > xe && c < 1.0 - ye) {
+        // Phase volumes per unit mass, as in computeState().
+        const double detX = ss.massfrac[wPhase][wComp]*ss.massfrac[nPhase][nComp]
+            - ss.massfrac[wPhase][nComp]*ss.massfrac[nPhase][wComp];
+        const double vw = ((1.0 - c)*ss.massfrac[nPhase][nComp] - c*ss.massfrac[nPhase][wComp])/(ss.density[wPhase]*detX);
+        const double vn = (c*ss.massfrac[wPhase][wComp] - (1.0 - c)*ss.massfrac[wPhase][nComp])/(ss.density[nPhase]*detX);
+        ss.saturation = vw/(vw + vn);
+    }
+}
+
+double BlackoilCo2PVT::tabulate(int num_pressure_samples, int num_fraction_samples)
+{
+    if (num_pressure_samples < 2 || num_fraction_samples < 2) {
+        OPM_THROW(std::runtime_error, "Need at least two samples in each direction to tabulate the CO2-brine flash, got "
+                  << num_pressure_samples << " and " << num_fraction_samples);
+    }
+    tabulated_ = false;
+    const int np = num_pressure_samples;
+    const int ns = num_fraction_samples;
+    const double dp = (table_pmax_ - table_pmin_)/(np - 1);
+    const double ds = 1.0/(ns - 1);
+    // Surface volumes of unit mass with CO2 mass fraction c are
+    // ((1 - c)/rhoO, c/rhoG).
+    const double rhoO = surfaceDensities_[Oil];
+    const double rhoG = surfaceDensities_[Gas];
+    // The flashes below are done serially, see evalAll().
+
+    // Two-phase region, sampled at equal masses of brine and CO2.
+    std::vector<std::vector<double> > sat_values(NumItems, std::vector<double>(np));
+    bool two_phase = true;
+    for (int i = 0; i < np; ++i) {
+        SubState ss;
+        computeState(ss, 0.5/rhoO, 0.5/rhoG, table_pmin_ + i*dp);
+        two_phase = two_phase && ss.saturation > 0.0 && ss.saturation < 1.0;
+        for (int item = 0; item < NumItems; ++item) {
+            sat_values[item][i] = primitive(ss, item);
+        }
+    }
+    if (!two_phase) {
+        OPM_THROW(std::runtime_error, "Equal masses of brine and CO2 do not form two phases at all pressures in ["
+                  << table_pmin_ << ", " << table_pmax_ << "], cannot tabulate the flash.");
+    }
+    for (int item = 0; item < NumItems; ++item) {
+        saturated_table_[item] = Opm::utils::UniformTableLinear<double>(table_pmin_, table_pmax_, sat_values[item]);
+    }
+
+    // Single-phase regions, up to the phase boundaries.
+    std::vector<std::vector<double> > brine_values(NumItems, std::vector<double>(np*ns));
+    std::vector<std::vector<double> > co2_values(NumItems, std::vector<double>(np*ns));
+    for (int i = 0; i < np; ++i) {
+        SubState ss;
+        const double p = table_pmin_ + i*dp;
+        for (int j = 0; j < ns; ++j) {
+            double c = j*ds*sat_values[XwN][i];
+            computeState(ss, (1.0 - c)/rhoO, c/rhoG, p);
+            for (int item = 0; item < NumItems; ++item) {
+                brine_values[item][i*ns + j] = primitive(ss, item);
+            }
+            c = 1.0 - j*ds*sat_values[XnW][i];
+            computeState(ss, (1.0 - c)/rhoO, c/rhoG, p);
+            for (int item = 0; item < NumItems; ++item) {
+                co2_values[item][i*ns + j] = primitive(ss, item);
+            }
+        }
+    }
+    for (int item = 0; item < NumItems; ++item) {
+        brine_only_table_[item] = Opm::utils::UniformTableBilinear<double>(table_pmin_, table_pmax_, np, 0.0, 1.0, ns, brine_values[item]);
+        co2_only_table_[item] = Opm::utils::UniformTableBilinear<double>(table_pmin_, table_pmax_, np, 0.0, 1.0, ns, co2_values[item]);
+    }
+    tabulated_ = true;
+
+    // Measure the deviation of B, R and viscosity from the flash at
+    // the midpoints of the grids (and in the two-phase region).
+    double max_err = 0.0;
+    for (int i = 0; i < np - 1; ++i) {
+        const double p = table_pmin_ + (i + 0.5)*dp;
+        const double xe = saturated_table_[XwN](p);
+        const double ye = saturated_table_[XnW](p);
+        for (int j = 0; j <= 2*(ns - 1); ++j) {
+            double c = 0.5;
+            if (j < ns - 1) {
+                c = (j + 0.5)*ds*xe;
+            } else if (j < 2*(ns - 1)) {
+                c = 1.0 - (j - ns + 1.5)*ds*ye;
+            }
+            CompVec z(0.0);
+            z[Oil] = (1.0 - c)/rhoO;
+            z[Gas] = c/rhoG;
+            SubState ss;
+            PhaseVec B, R, mu;
+            computeState(ss, z[Oil], z[Gas], p);
+            blackoilValues(ss, B, R, mu);
+            PointValues v;
+            evalPoint(p, z, false, v);
+            for (int phase = Liquid; phase <= Vapour; ++phase) {
+                max_err = std::max(max_err, std::fabs(v.B[phase] - B[phase])/std::max(std::fabs(B[phase]), 1e-20));
+                max_err = std::max(max_err, std::fabs(v.R[phase] - R[phase])/std::max(std::fabs(R[phase]), 1e-20));
+                max_err = std::max(max_err, std::fabs(v.mu[phase] - mu[phase])/std::max(std::fabs(mu[phase]), 1e-20));
+            }
+        }
+    }
+    return max_err;
+}
+
 void BlackoilCo2PVT::computeState(BlackoilCo2PVT::SubState& ss, double zBrine, double zCO2, double pressure) const
 {
                
@@ -34,6 +34,8 @@
 #include <opm/parser/eclipse/EclipseState/Tables/PvdgTable.hpp>
 #include <opm/parser/eclipse/EclipseState/Tables/TableManager.hpp>
 #include <opm/parser/eclipse/Parser/ParseContext.hpp>
+#include <algorithm>
+#include <cassert>
 
 using namespace Opm;
 
@@ -72,7 +74,7 @@ namespace Opm
         if (!pvdoTables.empty()) {
             const auto& pvdoTable = pvdoTables.getTable<PvdoTable>(0);
             oil_props_.reset(new MiscibilityDead(pvdoTable));
-        } else if (pvtoTables.empty()) {
+        } else if (!pvtoTables.empty()) {
             // PVTOTables is a std::vector<>
             const auto& pvtoTable = pvtoTables[0];
             oil_props_.reset(new MiscibilityLiveOil(pvtoTable));
@@ -90,7 +92,7 @@ namespace Opm
         if (!pvdgTables.empty()) {
             const auto& pvdgTable = pvdgTables.getTable<PvdgTable>(0);
             gas_props_.reset(new MiscibilityDead(pvdgTable));
-        } else if (pvtgTables.empty()) {
+        } else if (!pvtgTables.empty()) {
             gas_props_.reset(new MiscibilityLiveGas(pvtgTables[0]));
         } else {
 	    OPM_THROW(std::runtime_error, "Input is missing PVDG and PVTG\n");
@@ -146,11 +148,12 @@ namespace Opm
                                    std::vector<PhaseVec>& output) const
     {
         int num = pressures.size();
+        std::vector<double> data1;
         output.resize(num);
         for (int phase = 0; phase < numPhases; ++phase) {
-            propsForPhase(PhaseIndex(phase)).getViscosity(pressures, surfvol, phase, data1_);
+            propsForPhase(PhaseIndex(phase)).getViscosity(pressures, surfvol, phase, data1);
             for (int i = 0; i < num; ++i) {
-                output[i][phase] = data1_[i];
+                output[i][phase] = data1[i];
             }
         }
     }
@@ -160,11 +163,12 @@ namespace Opm
                         std::vector<PhaseVec>& output) const
     {
         int num = pressures.size();
+        std::vector<double> data1;
         output.resize(num);
         for (int phase = 0; phase < numPhases; ++phase) {
-            propsForPhase(PhaseIndex(phase)).B(pressures, surfvol, phase, data1_);
+            propsForPhase(PhaseIndex(phase)).B(pressures, surfvol, phase, data1);
             for (int i = 0; i < num; ++i) {
-                output[i][phase] = data1_[i];
+                output[i][phase] = data1[i];
             }
         }
     }
@@ -175,13 +179,15 @@ namespace Opm
                            std::vector<PhaseVec>& output_dBdp) const
     {
         int num = pressures.size();
+        std::vector<double> data1;
+        std::vector<double> data2;
         output_B.resize(num);
         output_dBdp.resize(num);
         for (int phase = 0; phase < numPhases; ++phase) {
-            propsForPhase(PhaseIndex(phase)).dBdp(pressures, surfvol, phase, data1_, data2_);
+            propsForPhase(PhaseIndex(phase)).dBdp(pressures, surfvol, phase, data1, data2);
             for (int i = 0; i < num; ++i) {
-                output_B[i][phase] = data1_[i];
-                output_dBdp[i][phase] = data2_[i];
+                output_B[i][phase] = data1[i];
+                output_dBdp[i][phase] = data2[i];
             }
         }
     }
@@ -191,11 +197,12 @@ namespace Opm
                         std::vector<PhaseVec>& output) const
     {
         int num = pressures.size();
+        std::vector<double> data1;
         output.resize(num);
         for (int phase = 0; phase < numPhases; ++phase) {
-            propsForPhase(PhaseIndex(phase)).R(pressures, surfvol, phase, data1_);
+            propsForPhase(PhaseIndex(phase)).R(pressures, surfvol, phase, data1);
             for (int i = 0; i < num; ++i) {
-                output[i][phase] = data1_[i];
+                output[i][phase] = data1[i];
             }
         }
     }
@@ -206,15 +213,77 @@ namespace Opm
                            std::vector<PhaseVec>& output_dRdp) const
     {
         int num = pressures.size();
+        std::vector<double> data1;
+        std::vector<double> data2;
         output_R.resize(num);
         output_dRdp.resize(num);
         for (int phase = 0; phase < numPhases; ++phase) {
-            propsForPhase(PhaseIndex(phase)).dRdp(pressures, surfvol, phase, data1_, data2_);
+            propsForPhase(PhaseIndex(phase)).dRdp(pressures, surfvol, phase, data1, data2);
             for (int i = 0; i < num; ++i) {
-                output_R[i][phase] = data1_[i];
-                output_dRdp[i][phase] = data2_[i];
+                output_R[i][phase] = data1[i];
+                output_dRdp[i][phase] = data2[i];
             }
         }
     }
 
+    void BlackoilPVT::evalAll(const std::vector<PhaseVec>& pressures,
+                              const std::vector<CompVec>& surfvol,
+                              std::vector<PhaseVec>& output_B,
+                              std::vector<PhaseVec>& output_dBdp,
+                              std::vector<PhaseVec>& output_R,
+                              std::vector<PhaseVec>& output_dRdp,
+                              std::vector<PhaseVec>& output_mu) const
+    {
+        assert(pressures.size() == surfvol.size());
+        int num = pressures.size();
+        output_B.resize(num);
+        output_dBdp.resize(num);
+        output_R.resize(num);
+        output_dRdp.resize(num);
+        output_mu.resize(num);
+        PvtBatchOutput output;
+        output.B = output_B.data();
+        output.dBdp = output_dBdp.data();
+        output.R = output_R.data();
+        output.dRdp = output_dRdp.data();
+        output.viscosity = output_mu.data();
+        evalAll(num, pressures.data(), surfvol.data(), output);
+    }
+
+    void BlackoilPVT::evalAll(const int num,
+                              const PhaseVec* pressures,
+                              const CompVec* surfvol,
+                              const PvtBatchOutput& output) const
+    {
+        // One virtual call per phase, the per-point work is done
+        // by the (parallel) loops of the table implementations.
+        for (int phase = 0; phase < numPhases; ++phase) {
+            propsForPhase(PhaseIndex(phase)).evalAll(num, pressures, surfvol, phase, output);
+        }
+    }
+
+    void BlackoilPVT::evalAll(const PhaseVec& pressures,
+                              const CompVec& surfvol,
+                              PhaseVec& output_B,
+                              PhaseVec& output_dBdp,
+                              PhaseVec& output_R,
+                              PhaseVec& output_dRdp,
+                              PhaseVec& output_mu) const
+    {
+        for (int phase = 0; phase < numPhases; ++phase) {
+            propsForPhase(PhaseIndex(phase)).evalAll(region_number_, pressures[phase], surfvol,
+                                                     output_B[phase], output_dBdp[phase],
+                                                     output_R[phase], output_dRdp[phase],
+                                                     output_mu[phase]);
+        }
+    }
+
+    double BlackoilPVT::tabulate(const int num_pressure_samples, const int num_ratio_samples)
+    {
+        double max_err = water_props_->tabulate(num_pressure_samples, num_ratio_samples);
+        max_err = std::max(max_err, oil_props_->tabulate(num_pressure_samples, num_ratio_samples));
+        max_err = std::max(max_err, gas_props_->tabulate(num_pressure_samples, num_ratio_samples));
+        return max_err;
+    }
+
 } // namespace Opm
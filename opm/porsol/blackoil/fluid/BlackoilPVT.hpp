@@ -70,6 +70,35 @@ namespace Opm
                   std::vector<PhaseVec>& output_R,
                   std::vector<PhaseVec>& output_dRdp) const;
 
+        /// Fused evaluation of B, dB/dp, R, dR/dp and viscosity for
+        /// all phases, in one batched pass per phase.
+        void evalAll(const std::vector<PhaseVec>& pressures,
+                     const std::vector<CompVec>& surfvol,
+                     std::vector<PhaseVec>& output_B,
+                     std::vector<PhaseVec>& output_dBdp,
+                     std::vector<PhaseVec>& output_R,
+                     std::vector<PhaseVec>& output_dRdp,
+                     std::vector<PhaseVec>& output_mu) const;
+        /// As above, for num points, computing only the quantities
+        /// that have non-null pointers in output.
+        void evalAll(int num,
+                     const PhaseVec* pressures,
+                     const CompVec* surfvol,
+                     const PvtBatchOutput& output) const;
+        /// As above, at a single point with the given phase pressures.
+        void evalAll(const PhaseVec& pressures,
+                     const CompVec& surfvol,
+                     PhaseVec& output_B,
+                     PhaseVec& output_dBdp,
+                     PhaseVec& output_R,
+                     PhaseVec& output_dRdp,
+                     PhaseVec& output_mu) const;
+
+        /// Switch the live oil and gas properties to evaluation from
+        /// uniformly resampled tables, see MiscibilityProps::tabulate().
+        /// Returns the largest relative deviation from the exact tables.
+        double tabulate(int num_pressure_samples, int num_ratio_samples);
+
     private:
 	int region_number_;
         const MiscibilityProps& propsForPhase(PhaseIndex phase) const;
@@ -78,8 +107,6 @@ namespace Opm
 	boost::scoped_ptr<MiscibilityProps> oil_props_;
 	boost::scoped_ptr<MiscibilityProps> gas_props_;
 	CompVec densities_;
-        mutable std::vector<double> data1_;
-        mutable std::vector<double> data2_;
     };
 
 }
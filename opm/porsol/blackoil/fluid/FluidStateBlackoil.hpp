@@ -22,6 +22,8 @@
 
 
 #include "BlackoilDefs.hpp"
+#include <opm/porsol/common/FieldArena.hpp>
+#include <vector>
 
 
 namespace Opm
@@ -53,36 +55,104 @@ namespace Opm
 
     /*!
      * \brief Multiple fluid states for a black oil model.
+     *
+     * The state variables p and z refer to the caller's arrays, set
+     * with setInput(), and are not copied. All other fields have the
+     * same size, set by resize(), and are stored as separate contiguous
+     * arrays in one allocation that is reused as long as the size does
+     * not grow.
      */
     struct AllFluidStates : public BlackoilDefs
     {
         // Canonical state variables.
-        std::vector<CompVec> surface_volume_density;         // z
-        std::vector<PhaseVec> phase_pressure;                // p
+        FieldArray<const CompVec> surface_volume_density;   // z
+        FieldArray<const PhaseVec> phase_pressure;          // p
 
         // Variables from PVT functions.
-        std::vector<PhaseVec> formation_volume_factor;       // B
-        std::vector<PhaseVec> formation_volume_factor_deriv; // dB/dp
-        std::vector<PhaseVec> solution_factor;               // R
-        std::vector<PhaseVec> solution_factor_deriv;         // dR/dp
-        std::vector<PhaseVec> viscosity;                     // mu
+        FieldArray<PhaseVec> formation_volume_factor;       // B
+        FieldArray<PhaseVec> formation_volume_factor_deriv; // dB/dp
+        FieldArray<PhaseVec> solution_factor;               // R
+        FieldArray<PhaseVec> solution_factor_deriv;         // dR/dp
+        FieldArray<PhaseVec> viscosity;                     // mu
 
         // Variables computed from PVT data.
         // The A matrices are all in Fortran order (or, equivalently,
         // we store the transposes).
-        std::vector<PhaseToCompMatrix> state_matrix;         // A' = (RB^{-1})'
-        std::vector<PhaseVec> phase_volume_density;          // u
-        std::vector<Scalar> total_phase_volume_density;      // sum(u)
-        std::vector<PhaseVec> saturation;                    // s = u/sum(u)
-        std::vector<PhaseVec> phase_compressibility;         // c
-        std::vector<Scalar> total_compressibility;           // cT
-        std::vector<Scalar> experimental_term;               // ex = sum(Ai*dA*Ai*z)
+        FieldArray<PhaseToCompMatrix> state_matrix;         // A' = (RB^{-1})'
+        FieldArray<PhaseVec> phase_volume_density;          // u
+        FieldArray<Scalar> total_phase_volume_density;      // sum(u)
+        FieldArray<PhaseVec> saturation;                    // s = u/sum(u)
+        FieldArray<PhaseVec> phase_compressibility;         // c
+        FieldArray<Scalar> total_compressibility;           // cT
+        FieldArray<Scalar> experimental_term;               // ex = sum(Ai*dA*Ai*z)
 
         // Variables computed from saturation.
-        std::vector<PhaseVec> relperm;                       // kr
-        std::vector<PhaseJacobian> relperm_deriv;            // dkr/ds
-        std::vector<PhaseVec> mobility;                      // lambda
-        std::vector<PhaseJacobian> mobility_deriv;           // dlambda/ds
+        FieldArray<PhaseVec> relperm;                       // kr
+        FieldArray<PhaseJacobian> relperm_deriv;            // dkr/ds
+        FieldArray<PhaseVec> mobility;                      // lambda
+        FieldArray<PhaseJacobian> mobility_deriv;           // dlambda/ds
+
+        AllFluidStates()
+        {
+        }
+
+        AllFluidStates(const AllFluidStates& other)
+            : surface_volume_density(other.surface_volume_density),
+              phase_pressure(other.phase_pressure)
+        {
+            arena_.assign(*this, other.arena_);
+        }
+
+        AllFluidStates& operator=(const AllFluidStates& other)
+        {
+            if (this != &other) {
+                surface_volume_density = other.surface_volume_density;
+                phase_pressure = other.phase_pressure;
+                arena_.assign(*this, other.arena_);
+            }
+            return *this;
+        }
+
+        /// Refer to the given pressures and surface volumes. They must
+        /// stay unchanged (and alive) while the states are computed.
+        void setInput(const std::vector<PhaseVec>& p, const std::vector<CompVec>& z)
+        {
+            assert(p.size() == z.size());
+            phase_pressure = FieldArray<const PhaseVec>(p.data(), p.size());
+            surface_volume_density = FieldArray<const CompVec>(z.data(), z.size());
+        }
+
+        /// Set the number of states of all computed fields.
+        void resize(const int num)
+        {
+            arena_.resize(*this, num);
+        }
+
+        /// Calls op(field) for every computed field.
+
+        template <class Op>
+        void forEachField(Op& op)
+        {
+            op(formation_volume_factor);
+            op(formation_volume_factor_deriv);
+            op(solution_factor);
+            op(solution_factor_deriv);
+            op(viscosity);
+            op(state_matrix);
+            op(phase_volume_density);
+            op(total_phase_volume_density);
+            op(saturation);
+            op(phase_compressibility);
+            op(total_compressibility);
+            op(experimental_term);
+            op(relperm);
+            op(relperm_deriv);
+            op(mobility);
+            op(mobility_deriv);
+        }
+
+    private:
+        FieldArena arena_;
     };
 
 } // end namespace Opm
@@ -163,6 +163,36 @@ namespace Opm
         }
     }
 
+    void MiscibilityDead::evalAll(const int num,
+                                  const PhaseVec* pressures,
+                                  const CompVec* surfvol,
+                                  const int phase,
+                                  const PvtBatchOutput& output) const
+    {
+#pragma omp parallel for
+        for (int i = 0; i < num; ++i) {
+            double B, dBdp, R, dRdp, mu;
+            MiscibilityDead::evalAll(0, pressures[i][phase], surfvol[i], B, dBdp, R, dRdp, mu);
+            if (output.B) output.B[i][phase] = B;
+            if (output.dBdp) output.dBdp[i][phase] = dBdp;
+            if (output.R) output.R[i][phase] = R;
+            if (output.dRdp) output.dRdp[i][phase] = dRdp;
+            if (output.viscosity) output.viscosity[i][phase] = mu;
+        }
+    }
+
+    void MiscibilityDead::evalAll(int /*region*/, double press, const surfvol_t& /*surfvol*/,
+                                  double& B, double& dBdp,
+                                  double& R, double& dRdp,
+                                  double& mu) const
+    {
+        B = 1.0/one_over_B_(press);
+        dBdp = -B*B*one_over_B_.derivative(press);
+        R = 0.0;
+        dRdp = 0.0;
+        mu = viscosity_(press);
+    }
+
     double MiscibilityDead::R(int /*region*/, double /*press*/, const surfvol_t& /*surfvol*/) const
     {
         return 0.0;
@@ -82,6 +82,16 @@ namespace Opm
                           std::vector<double>& output_R,
                           std::vector<double>& output_dRdp) const;
 
+        virtual void evalAll(int num,
+                             const PhaseVec* pressures,
+                             const CompVec* surfvol,
+                             int phase,
+                             const PvtBatchOutput& output) const;
+        virtual void evalAll(int region, double press, const surfvol_t& surfvol,
+                             double& B, double& dBdp,
+                             double& R, double& dRdp,
+                             double& mu) const;
+
     private:
 	// PVT properties of dry gas or dead oil
         Opm::utils::UniformTableLinear<double> one_over_B_;
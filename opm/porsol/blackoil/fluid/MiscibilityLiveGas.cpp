@@ -48,6 +48,7 @@ namespace Opm
 
     /// Constructor
     MiscibilityLiveGas::MiscibilityLiveGas(const Opm::PvtgTable& pvtgTable)
+        : tabulated_(false)
     {
         // GAS, PVTG
         const auto &saturatedPvtgTable = pvtgTable.getSaturatedTable();
@@ -59,7 +60,7 @@ namespace Opm
         saturated_gas_table_[3] = saturatedPvtgTable.getColumn("RV").vectorCopy();
 
         int sz = saturated_gas_table_[0].size();
-        undersat_gas_tables_.resize(sz);
+        undersat_gas_tables_.resize(sz, std::vector<std::vector<double> >(3));
         for (int i=0; i<sz; ++i) {
             const auto &undersaturatedPvtgTable = pvtgTable.getUnderSaturatedTable(i);
 
@@ -98,8 +99,7 @@ namespace Opm
         if (surfvol[Liquid] == 0.0) {
             return 0.0;
         }
-	double R = linearInterpolation(saturated_gas_table_[0],
-					     saturated_gas_table_[3], press);
+	double R = saturatedR(press);
 	double maxR = surfvol[Liquid]/surfvol[Vapour];
 	if (R < maxR ) {  // Saturated case
 	    return R;
@@ -124,13 +124,10 @@ namespace Opm
     // Vaporised oil-gas ratio derivative
     double MiscibilityLiveGas::dRdp(int /*region*/, double press, const surfvol_t& surfvol) const
     {
-	double R = linearInterpolation(saturated_gas_table_[0],
-					     saturated_gas_table_[3], press);
+	double R = saturatedR(press);
 	double maxR = surfvol[Liquid]/surfvol[Vapour];
 	if (R < maxR ) {  // Saturated case
-	    return linearInterpolationDerivative(saturated_gas_table_[0],
-					    saturated_gas_table_[3],
-					    press);
+	    return saturatedRDeriv(press);
 	} else {
 	    return 0.0;  // Undersaturated case
 	}	
@@ -191,9 +188,301 @@ namespace Opm
         }
     }
 
+    void MiscibilityLiveGas::evalAll(const int num,
+                                     const PhaseVec* pressures,
+                                     const CompVec* surfvol,
+                                     const int phase,
+                                     const PvtBatchOutput& output) const
+    {
+        if (tabulated_) {
+#pragma omp parallel for
+            for (int i = 0; i < num; ++i) {
+                double B, dBdp, R, dRdp, mu;
+                evalAllTabulated(pressures[i][phase], surfvol[i], B, dBdp, R, dRdp, mu);
+                if (output.B) output.B[i][phase] = B;
+                if (output.dBdp) output.dBdp[i][phase] = dBdp;
+                if (output.R) output.R[i][phase] = R;
+                if (output.dRdp) output.dRdp[i][phase] = dRdp;
+                if (output.viscosity) output.viscosity[i][phase] = mu;
+            }
+        } else {
+#pragma omp parallel for
+            for (int i = 0; i < num; ++i) {
+                double B, dBdp, R, dRdp, mu;
+                evalAllImpl(pressures[i][phase], surfvol[i], B, dBdp, R, dRdp, mu);
+                if (output.B) output.B[i][phase] = B;
+                if (output.dBdp) output.dBdp[i][phase] = dBdp;
+                if (output.R) output.R[i][phase] = R;
+                if (output.dRdp) output.dRdp[i][phase] = dRdp;
+                if (output.viscosity) output.viscosity[i][phase] = mu;
+            }
+        }
+    }
+
+    void MiscibilityLiveGas::evalAll(int /*region*/, const double press, const surfvol_t& surfvol,
+                                     double& B, double& dBdp,
+                                     double& R, double& dRdp,
+                                     double& mu) const
+    {
+        if (tabulated_) {
+            evalAllTabulated(press, surfvol, B, dBdp, R, dRdp, mu);
+        } else {
+            evalAllImpl(press, surfvol, B, dBdp, R, dRdp, mu);
+        }
+    }
+
+    void MiscibilityLiveGas::evalAllImpl(const double press, const surfvol_t& surfvol,
+                                         double& B, double& dBdp,
+                                         double& R, double& dRdp,
+                                         double& mu) const
+    {
+        // The saturated table interval is shared by all quantities.
+        const std::vector<double>& sat_press = saturated_gas_table_[0];
+        const int section = tableIndex(sat_press, press);
+        double dRsat;
+        const double Rsat = sectionInterpolation(sat_press, saturated_gas_table_[3],
+                                                 press, section, dRsat);
+        const double maxR = surfvol[Liquid]/surfvol[Vapour];
+        const bool saturated = Rsat < maxR;
+
+        // R and dR/dp, as in R() and dRdp().
+        if (surfvol[Liquid] == 0.0) {
+            R = 0.0;
+        } else {
+            R = saturated ? Rsat : maxR;
+        }
+        dRdp = saturated ? dRsat : 0.0;
+
+        // B and viscosity, as in miscible_gas().
+        double Bg, dBg;
+        if (saturated) {
+            double dmu;
+            Bg = sectionInterpolation(sat_press, saturated_gas_table_[1], press, section, dBg);
+            mu = sectionInterpolation(sat_press, saturated_gas_table_[2], press, section, dmu);
+        } else {
+            undersatGas(press, maxR, section, Bg, dBg, mu);
+        }
+        if (surfvol[Vapour] == 0.0) {
+            // To handle no-gas case.
+            B = 1.0;
+            dBdp = 0.0;
+        } else {
+            B = Bg;
+            dBdp = dBg;
+        }
+    }
+
+    void MiscibilityLiveGas::undersatGas(const double press, const double maxR, const int is,
+                                         double& B, double& dBdp, double& mu) const
+    {
+        const std::vector<double>& sat_press = saturated_gas_table_[0];
+        const double dp_section = sat_press[is+1] - sat_press[is];
+        const std::vector<std::vector<double> >& t1 = undersat_gas_tables_[is];
+        const std::vector<std::vector<double> >& t2 = undersat_gas_tables_[is+1];
+        const bool have_undersat = t1[0].size() >= 2;
+        double dummy;
+
+        // Values of both table sections at maxR, when needed.
+        double B1 = 0.0, B2 = 0.0, mu1 = 0.0, mu2 = 0.0;
+        if (have_undersat) {
+            const int ix1 = tableIndex(t1[0], maxR);
+            const int ix2 = tableIndex(t2[0], maxR);
+            B1 = sectionInterpolation(t1[0], t1[1], maxR, ix1, dummy);
+            B2 = sectionInterpolation(t2[0], t2[1], maxR, ix2, dummy);
+            mu1 = sectionInterpolation(t1[0], t1[2], maxR, ix1, dummy);
+            mu2 = sectionInterpolation(t2[0], t2[2], maxR, ix2, dummy);
+        }
+
+        // Derivative.
+        if (have_undersat) {
+            dBdp = (B2 - B1)/dp_section;
+        } else {
+            dBdp = (saturated_gas_table_[1][is+1] - saturated_gas_table_[1][is])/dp_section;
+        }
+
+        // Values.
+        const int ltp = sat_press.size() - 1;
+        if (is == 0 && press < sat_press[0]) {
+            // Extrapolate from first table section
+            const std::vector<std::vector<double> >& t0 = undersat_gas_tables_[0];
+            const int ix = tableIndex(t0[0], maxR);
+            B = sectionInterpolation(t0[0], t0[1], maxR, ix, dummy);
+            mu = sectionInterpolation(t0[0], t0[2], maxR, ix, dummy);
+        } else if (is+1 == ltp && press > sat_press[ltp]) {
+            // Extrapolate from last table section
+            const std::vector<std::vector<double> >& tl = undersat_gas_tables_[ltp];
+            const int ix = tableIndex(tl[0], maxR);
+            B = sectionInterpolation(tl[0], tl[1], maxR, ix, dummy);
+            mu = sectionInterpolation(tl[0], tl[2], maxR, ix, dummy);
+        } else {
+            // Interpolate between table sections
+            const double w = (press - sat_press[is])/dp_section;
+            if (have_undersat) {
+                B = B1 + w*(B2 - B1);
+                mu = mu1 + w*(mu2 - mu1);
+            } else {
+                B = sectionInterpolation(sat_press, saturated_gas_table_[1], press, is, dummy);
+                mu = sectionInterpolation(sat_press, saturated_gas_table_[2], press, is, dummy);
+            }
+        }
+    }
+
+    double MiscibilityLiveGas::saturatedR(const double press) const
+    {
+        if (tabulated_) {
+            return sat_R_(press);
+        }
+        return linearInterpolation(saturated_gas_table_[0], saturated_gas_table_[3], press);
+    }
+
+    double MiscibilityLiveGas::saturatedRDeriv(const double press) const
+    {
+        if (tabulated_) {
+            return sat_R_.derivative(press);
+        }
+        return linearInterpolationDerivative(saturated_gas_table_[0], saturated_gas_table_[3], press);
+    }
+
+    void MiscibilityLiveGas::evalAllTabulated(const double press, const surfvol_t& surfvol,
+                                              double& B, double& dBdp,
+                                              double& R, double& dRdp,
+                                              double& mu) const
+    {
+        const double Rsat = sat_R_(press);
+        const double maxR = surfvol[Liquid]/surfvol[Vapour];
+        const bool saturated = Rsat < maxR;
+
+        // R and dR/dp, as in R() and dRdp().
+        if (surfvol[Liquid] == 0.0) {
+            R = 0.0;
+        } else {
+            R = saturated ? Rsat : maxR;
+        }
+        dRdp = saturated ? sat_R_.derivative(press) : 0.0;
+
+        // B and viscosity, as in miscible_gas().
+        double Bg, dBg;
+        if (saturated) {
+            Bg = sat_B_(press);
+            dBg = sat_B_.derivative(press);
+            mu = sat_mu_(press);
+        } else {
+            double dBgdR;
+            undersat_B_.evaluate(press, maxR, Bg, dBg, dBgdR);
+            mu = undersat_mu_(press, maxR);
+        }
+        if (surfvol[Vapour] == 0.0) {
+            // To handle no-gas case.
+            B = 1.0;
+            dBdp = 0.0;
+        } else {
+            B = Bg;
+            dBdp = dBg;
+        }
+    }
+
+    double MiscibilityLiveGas::miscibleGasTabulated(const double press, const surfvol_t& surfvol,
+                                                    const int item, const bool deriv) const
+    {
+        assert(item == 1 || item == 2);
+        const double maxR = surfvol[Liquid]/surfvol[Vapour];
+        if (sat_R_(press) < maxR) {
+            // Saturated case
+            const Opm::utils::UniformTableLinear<double>& table = (item == 1) ? sat_B_ : sat_mu_;
+            return deriv ? table.derivative(press) : table(press);
+        } else {
+            // Undersaturated case
+            const Opm::utils::UniformTableBilinear<double>& table = (item == 1) ? undersat_B_ : undersat_mu_;
+            return deriv ? table.derivativeX(press, maxR) : table(press, maxR);
+        }
+    }
+
+    double MiscibilityLiveGas::tabulate(const int num_pressure_samples, const int num_ratio_samples)
+    {
+        if (num_pressure_samples < 2 || num_ratio_samples < 2) {
+            OPM_THROW(std::runtime_error, "Need at least two samples in each direction to tabulate PVTG, got "
+                      << num_pressure_samples << " and " << num_ratio_samples);
+        }
+        // Sample the exact tables.
+        tabulated_ = false;
+        const std::vector<double>& sat_press = saturated_gas_table_[0];
+        const std::vector<double>& sat_rv = saturated_gas_table_[3];
+        const int np = num_pressure_samples;
+        const int nr = num_ratio_samples;
+        const double pmin = sat_press.front();
+        const double pmax = sat_press.back();
+        const double dp = (pmax - pmin)/(np - 1);
+
+        // Saturated curves.
+        std::vector<double> rv(np), bg(np), visc(np);
+        for (int i = 0; i < np; ++i) {
+            const double p = pmin + i*dp;
+            rv[i] = linearInterpolation(sat_press, sat_rv, p);
+            bg[i] = linearInterpolation(sat_press, saturated_gas_table_[1], p);
+            visc[i] = linearInterpolation(sat_press, saturated_gas_table_[2], p);
+        }
+        sat_R_ = Opm::utils::UniformTableLinear<double>(pmin, pmax, rv);
+        sat_B_ = Opm::utils::UniformTableLinear<double>(pmin, pmax, bg);
+        sat_mu_ = Opm::utils::UniformTableLinear<double>(pmin, pmax, visc);
+
+        // Undersaturated data, from the driest tabulated gas up to the
+        // largest saturated vaporised oil-gas ratio.
+        double rmin = *std::min_element(sat_rv.begin(), sat_rv.end());
+        for (size_t i = 0; i < undersat_gas_tables_.size(); ++i) {
+            if (!undersat_gas_tables_[i][0].empty()) {
+                rmin = std::min(rmin, undersat_gas_tables_[i][0].front());
+            }
+        }
+        const double rmax = *std::max_element(sat_rv.begin(), sat_rv.end());
+        const double dr = (rmax > rmin) ? (rmax - rmin)/(nr - 1) : 0.0;
+        std::vector<double> u_bg(np*nr), u_visc(np*nr);
+        for (int i = 0; i < np; ++i) {
+            const double p = pmin + i*dp;
+            const int section = tableIndex(sat_press, p);
+            for (int j = 0; j < nr; ++j) {
+                double dummy;
+                undersatGas(p, rmin + j*dr, section, u_bg[i*nr + j], dummy, u_visc[i*nr + j]);
+            }
+        }
+        if (rmax > rmin) {
+            undersat_B_ = Opm::utils::UniformTableBilinear<double>(pmin, pmax, np, rmin, rmax, nr, u_bg);
+            undersat_mu_ = Opm::utils::UniformTableBilinear<double>(pmin, pmax, np, rmin, rmax, nr, u_visc);
+        } else {
+            // Dry gas only, the undersaturated data do not depend on Rv.
+            undersat_B_ = Opm::utils::UniformTableBilinear<double>(pmin, pmax, np, rmin, rmin + 1.0, nr, u_bg);
+            undersat_mu_ = Opm::utils::UniformTableBilinear<double>(pmin, pmax, np, rmin, rmin + 1.0, nr, u_visc);
+        }
+
+        // Measure the deviation at cell midpoints, where it is largest.
+        double max_err = 0.0;
+        for (int i = 0; i < np - 1; ++i) {
+            const double p = pmin + (i + 0.5)*dp;
+            max_err = std::max(max_err, relativeError(sat_R_(p), linearInterpolation(sat_press, sat_rv, p)));
+            max_err = std::max(max_err, relativeError(sat_B_(p), linearInterpolation(sat_press, saturated_gas_table_[1], p)));
+            max_err = std::max(max_err, relativeError(sat_mu_(p), linearInterpolation(sat_press, saturated_gas_table_[2], p)));
+            const int section = tableIndex(sat_press, p);
+            const double rsat = linearInterpolation(sat_press, sat_rv, p);
+            for (int j = 0; j < nr - 1; ++j) {
+                const double r = rmin + (j + 0.5)*dr;
+                if (r > rsat) {
+                    continue; // Saturated, the undersaturated data are not used.
+                }
+                double Bg, dBg, mu;
+                undersatGas(p, r, section, Bg, dBg, mu);
+                max_err = std::max(max_err, relativeError(undersat_B_(p, r), Bg));
+                max_err = std::max(max_err, relativeError(undersat_mu_(p, r), mu));
+            }
+        }
+        tabulated_ = true;
+        return max_err;
+    }
+
     double MiscibilityLiveGas::miscible_gas(double press, const surfvol_t& surfvol, int item,
 					    bool deriv) const
     {
+        if (tabulated_) {
+            return miscibleGasTabulated(press, surfvol, item, deriv);
+        }
 	int section;
 	double R = linearInterpolation(saturated_gas_table_[0],
 					     saturated_gas_table_[3], press,
@@ -36,6 +36,8 @@
      */
 
 #include "MiscibilityProps.hpp"
+#include <opm/core/utility/UniformTableLinear.hpp>
+#include <opm/porsol/common/UniformTableBilinear.hpp>
 #include <opm/parser/eclipse/EclipseState/EclipseState.hpp>
 
 namespace Opm
@@ -78,14 +80,57 @@ namespace Opm
                           std::vector<double>& output_R,
                           std::vector<double>& output_dRdp) const;
 
+        virtual void evalAll(int num,
+                             const PhaseVec* pressures,
+                             const CompVec* surfvol,
+                             int phase,
+                             const PvtBatchOutput& output) const;
+        virtual void evalAll(int region, double press, const surfvol_t& surfvol,
+                             double& B, double& dBdp,
+                             double& R, double& dRdp,
+                             double& mu) const;
+
+        virtual double tabulate(int num_pressure_samples, int num_ratio_samples);
+
     protected:
 	// item:  1=B  2=mu;
 	double miscible_gas(double press, const surfvol_t& surfvol, int item,
 			    bool deriv = false) const;
+
+        // Computes B, dB/dp, R, dR/dp and viscosity at a single point,
+        // with one lookup per table shared by all quantities.
+        void evalAllImpl(double press, const surfvol_t& surfvol,
+                         double& B, double& dBdp,
+                         double& R, double& dRdp,
+                         double& mu) const;
+        // Undersaturated B, dB/dp and viscosity, as in miscible_gas().
+        void undersatGas(double press, double maxR, int section,
+                         double& B, double& dBdp, double& mu) const;
+
+        // Saturated Rv and dRv/dp, from the exact or the resampled table.
+        double saturatedR(double press) const;
+        double saturatedRDeriv(double press) const;
+
+        // Counterparts of evalAllImpl() and miscible_gas() using the
+        // uniformly resampled tables.
+        void evalAllTabulated(double press, const surfvol_t& surfvol,
+                              double& B, double& dBdp,
+                              double& R, double& dRdp,
+                              double& mu) const;
+        double miscibleGasTabulated(double press, const surfvol_t& surfvol, int item,
+                                    bool deriv) const;
 	// PVT properties of wet gas (with vaporised oil)
 	std::vector<std::vector<double> > saturated_gas_table_;	
 	std::vector<std::vector<std::vector<double> > > undersat_gas_tables_;
 
+        // Uniformly resampled tables, used if tabulated_ is true.
+        bool tabulated_;
+        Opm::utils::UniformTableLinear<double> sat_R_;
+        Opm::utils::UniformTableLinear<double> sat_B_;
+        Opm::utils::UniformTableLinear<double> sat_mu_;
+        Opm::utils::UniformTableBilinear<double> undersat_B_;    // (p, Rv)
+        Opm::utils::UniformTableBilinear<double> undersat_mu_;   // (p, Rv)
+
     };
 
 }
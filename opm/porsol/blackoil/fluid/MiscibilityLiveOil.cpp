@@ -51,6 +51,7 @@ namespace Opm
 
     /// Constructor
     MiscibilityLiveOil::MiscibilityLiveOil(const PvtoTable& pvtoTable)
+        : tabulated_(false)
     {
         const auto& saturatedPvtoTable = pvtoTable.getSaturatedTable();
 
@@ -66,7 +67,7 @@ namespace Opm
             saturated_oil_table_[1][i] = 1.0/saturated_oil_table_[1][i];
         }
 
-        undersat_oil_tables_.resize(sz);
+        undersat_oil_tables_.resize(sz, std::vector<std::vector<double> >(3));
         for (int i=0; i<sz; ++i) {
             const auto &undersaturatedPvtoTable = pvtoTable.getUnderSaturatedTable(i);
 
@@ -212,13 +213,10 @@ namespace Opm
     //  Dissolved gas-oil ratio derivative
     double MiscibilityLiveOil::dRdp(int /*region*/, double press, const surfvol_t& surfvol) const
     {
-	double R = linearInterpolation(saturated_oil_table_[0],
-					     saturated_oil_table_[3], press);
+	double R = saturatedR(press);
 	double maxR = surfvol[Vapour]/surfvol[Liquid];
 	if (R < maxR ) {  // Saturated case
-	    return linearInterpolationDerivative(saturated_oil_table_[0],
-					    saturated_oil_table_[3],
-					    press);
+	    return saturatedRDeriv(press);
 	} else {
 	    return 0.0;  // Undersaturated case
 	}	
@@ -283,13 +281,44 @@ namespace Opm
     }
 
 
+    void MiscibilityLiveOil::evalAll(const int num,
+                                     const PhaseVec* pressures,
+                                     const CompVec* surfvol,
+                                     const int phase,
+                                     const PvtBatchOutput& output) const
+    {
+        if (tabulated_) {
+#pragma omp parallel for
+            for (int i = 0; i < num; ++i) {
+                double B, dBdp, R, dRdp, mu;
+                evalAllTabulated(pressures[i][phase], surfvol[i], B, dBdp, R, dRdp, mu);
+                if (output.B) output.B[i][phase] = B;
+                if (output.dBdp) output.dBdp[i][phase] = dBdp;
+                if (output.R) output.R[i][phase] = R;
+                if (output.dRdp) output.dRdp[i][phase] = dRdp;
+                if (output.viscosity) output.viscosity[i][phase] = mu;
+            }
+        } else {
+#pragma omp parallel for
+            for (int i = 0; i < num; ++i) {
+                double B, dBdp, R, dRdp, mu;
+                evalAllImpl(pressures[i][phase], surfvol[i], B, dBdp, R, dRdp, mu);
+                if (output.B) output.B[i][phase] = B;
+                if (output.dBdp) output.dBdp[i][phase] = dBdp;
+                if (output.R) output.R[i][phase] = R;
+                if (output.dRdp) output.dRdp[i][phase] = dRdp;
+                if (output.viscosity) output.viscosity[i][phase] = mu;
+            }
+        }
+    }
+
+
     double MiscibilityLiveOil::evalR(double press, const surfvol_t& surfvol) const
     {
         if (surfvol[Vapour] == 0.0) {
             return 0.0;
         }	
-	double R = linearInterpolation(saturated_oil_table_[0],
-					     saturated_oil_table_[3], press);
+	double R = saturatedR(press);
 	double maxR = surfvol[Vapour]/surfvol[Liquid];
 	if (R < maxR ) {  // Saturated case
 	    return R;
@@ -306,14 +335,11 @@ namespace Opm
             dRdp = 0.0;
             return;
         }
-	R = linearInterpolation(saturated_oil_table_[0],
-                                      saturated_oil_table_[3], press);
+	R = saturatedR(press);
 	double maxR = surfvol[Vapour]/surfvol[Liquid];
 	if (R < maxR ) {
             // Saturated case
-	    dRdp = linearInterpolationDerivative(saturated_oil_table_[0],
-					    saturated_oil_table_[3],
-					    press);
+	    dRdp = saturatedRDeriv(press);
 	} else {
             // Undersaturated case
             R = maxR;
@@ -337,9 +363,237 @@ namespace Opm
     }
 
 
+    void MiscibilityLiveOil::evalAll(int /*region*/, const double press, const surfvol_t& surfvol,
+                                     double& B, double& dBdp,
+                                     double& R, double& dRdp,
+                                     double& mu) const
+    {
+        if (tabulated_) {
+            evalAllTabulated(press, surfvol, B, dBdp, R, dRdp, mu);
+        } else {
+            evalAllImpl(press, surfvol, B, dBdp, R, dRdp, mu);
+        }
+    }
+
+    void MiscibilityLiveOil::evalAllImpl(const double press, const surfvol_t& surfvol,
+                                         double& B, double& dBdp,
+                                         double& R, double& dRdp,
+                                         double& mu) const
+    {
+        // The saturated table interval is shared by all quantities.
+        const std::vector<double>& sat_press = saturated_oil_table_[0];
+        const int section = tableIndex(sat_press, press);
+        double dRsat;
+        const double Rsat = sectionInterpolation(sat_press, saturated_oil_table_[3],
+                                                 press, section, dRsat);
+
+        // R and dR/dp, as in evalRDeriv().
+        if (surfvol[Vapour] == 0.0) {
+            R = 0.0;
+            dRdp = 0.0;
+        } else if (Rsat < surfvol[Vapour]/surfvol[Liquid]) {
+            R = Rsat;
+            dRdp = dRsat;
+        } else {
+            R = surfvol[Vapour]/surfvol[Liquid];
+            dRdp = 0.0;
+        }
+
+        // 1/B and viscosity, as in miscible_oil().
+        const double maxR = (surfvol[Liquid] == 0.0) ? 0.0 : surfvol[Vapour]/surfvol[Liquid];
+        double Binv, dBinv, dmu;
+        if (Rsat < maxR) {
+            // Saturated case
+            Binv = sectionInterpolation(sat_press, saturated_oil_table_[1], press, section, dBinv);
+            mu = sectionInterpolation(sat_press, saturated_oil_table_[2], press, section, dmu);
+        } else {
+            // Undersaturated case
+            undersatOil(press, maxR, Binv, dBinv, mu);
+        }
+        B = 1.0/Binv;
+        dBdp = -B*B*dBinv;
+    }
+
+
+    void MiscibilityLiveOil::undersatOil(const double press, const double maxR,
+                                         double& Binv, double& dBinvdp, double& mu) const
+    {
+        // Interpolate between table sections.
+        const int is = tableIndex(saturated_oil_table_[3], maxR);
+        const double w = (maxR - saturated_oil_table_[3][is]) /
+            (saturated_oil_table_[3][is+1] - saturated_oil_table_[3][is]);
+        const std::vector<std::vector<double> >& t1 = undersat_oil_tables_[is];
+        const std::vector<std::vector<double> >& t2 = undersat_oil_tables_[is+1];
+        assert(t1[0].size() >= 2);
+        assert(t2[0].size() >= 2);
+        const int ix1 = tableIndex(t1[0], press);
+        const int ix2 = tableIndex(t2[0], press);
+        double d1, d2, dmu;
+        const double b1 = sectionInterpolation(t1[0], t1[1], press, ix1, d1);
+        const double b2 = sectionInterpolation(t2[0], t2[1], press, ix2, d2);
+        Binv = b1 + w*(b2 - b1);
+        dBinvdp = d1 + w*(d2 - d1);
+        const double mu1 = sectionInterpolation(t1[0], t1[2], press, ix1, dmu);
+        const double mu2 = sectionInterpolation(t2[0], t2[2], press, ix2, dmu);
+        mu = mu1 + w*(mu2 - mu1);
+    }
+
+
+    double MiscibilityLiveOil::saturatedR(const double press) const
+    {
+        if (tabulated_) {
+            return sat_R_(press);
+        }
+        return linearInterpolation(saturated_oil_table_[0], saturated_oil_table_[3], press);
+    }
+
+
+    double MiscibilityLiveOil::saturatedRDeriv(const double press) const
+    {
+        if (tabulated_) {
+            return sat_R_.derivative(press);
+        }
+        return linearInterpolationDerivative(saturated_oil_table_[0], saturated_oil_table_[3], press);
+    }
+
+
+    void MiscibilityLiveOil::evalAllTabulated(const double press, const surfvol_t& surfvol,
+                                              double& B, double& dBdp,
+                                              double& R, double& dRdp,
+                                              double& mu) const
+    {
+        const double Rsat = sat_R_(press);
+
+        // R and dR/dp, as in evalRDeriv().
+        if (surfvol[Vapour] == 0.0) {
+            R = 0.0;
+            dRdp = 0.0;
+        } else if (Rsat < surfvol[Vapour]/surfvol[Liquid]) {
+            R = Rsat;
+            dRdp = sat_R_.derivative(press);
+        } else {
+            R = surfvol[Vapour]/surfvol[Liquid];
+            dRdp = 0.0;
+        }
+
+        // 1/B and viscosity, as in miscible_oil().
+        const double maxR = (surfvol[Liquid] == 0.0) ? 0.0 : surfvol[Vapour]/surfvol[Liquid];
+        double Binv, dBinv;
+        if (Rsat < maxR) {
+            Binv = sat_Binv_(press);
+            dBinv = sat_Binv_.derivative(press);
+            mu = sat_mu_(press);
+        } else {
+            double dBinvdR;
+            undersat_Binv_.evaluate(press, maxR, Binv, dBinv, dBinvdR);
+            mu = undersat_mu_(press, maxR);
+        }
+        B = 1.0/Binv;
+        dBdp = -B*B*dBinv;
+    }
+
+
+    double MiscibilityLiveOil::miscibleOilTabulated(const double press, const surfvol_t& surfvol,
+                                                    const int item, const bool deriv) const
+    {
+        assert(item == 1 || item == 2);
+        const double Rsat = sat_R_(press);
+        const double maxR = (surfvol[Liquid] == 0.0) ? 0.0 : surfvol[Vapour]/surfvol[Liquid];
+        if (Rsat < maxR) {
+            // Saturated case
+            const Opm::utils::UniformTableLinear<double>& table = (item == 1) ? sat_Binv_ : sat_mu_;
+            return deriv ? table.derivative(press) : table(press);
+        } else {
+            // Undersaturated case
+            const Opm::utils::UniformTableBilinear<double>& table = (item == 1) ? undersat_Binv_ : undersat_mu_;
+            return deriv ? table.derivativeX(press, maxR) : table(press, maxR);
+        }
+    }
+
+
+    double MiscibilityLiveOil::tabulate(const int num_pressure_samples, const int num_ratio_samples)
+    {
+        if (num_pressure_samples < 2 || num_ratio_samples < 2) {
+            OPM_THROW(std::runtime_error, "Need at least two samples in each direction to tabulate PVTO, got "
+                      << num_pressure_samples << " and " << num_ratio_samples);
+        }
+        // Sample the exact tables.
+        tabulated_ = false;
+        const std::vector<double>& sat_press = saturated_oil_table_[0];
+        const std::vector<double>& sat_rs = saturated_oil_table_[3];
+        const int np = num_pressure_samples;
+        const int nr = num_ratio_samples;
+
+        // Saturated curves, over the range of bubble point pressures.
+        const double pmin = sat_press.front();
+        const double psat_max = sat_press.back();
+        const double dp_sat = (psat_max - pmin)/(np - 1);
+        std::vector<double> rs(np), binv(np), visc(np);
+        for (int i = 0; i < np; ++i) {
+            const double p = pmin + i*dp_sat;
+            rs[i] = linearInterpolation(sat_press, sat_rs, p);
+            binv[i] = linearInterpolation(sat_press, saturated_oil_table_[1], p);
+            visc[i] = linearInterpolation(sat_press, saturated_oil_table_[2], p);
+        }
+        sat_R_ = Opm::utils::UniformTableLinear<double>(pmin, psat_max, rs);
+        sat_Binv_ = Opm::utils::UniformTableLinear<double>(pmin, psat_max, binv);
+        sat_mu_ = Opm::utils::UniformTableLinear<double>(pmin, psat_max, visc);
+
+        // Undersaturated data, over all pressures of the (extended) sections.
+        double pmax = psat_max;
+        for (size_t i = 0; i < undersat_oil_tables_.size(); ++i) {
+            pmax = std::max(pmax, undersat_oil_tables_[i][0].back());
+        }
+        // Include dead oil (Rs = 0), which the exact tables extrapolate to.
+        const double rmin = std::min(0.0, sat_rs.front());
+        const double rmax = sat_rs.back();
+        const double dp = (pmax - pmin)/(np - 1);
+        const double dr = (rmax - rmin)/(nr - 1);
+        std::vector<double> u_binv(np*nr), u_visc(np*nr);
+        for (int i = 0; i < np; ++i) {
+            for (int j = 0; j < nr; ++j) {
+                double dummy;
+                undersatOil(pmin + i*dp, rmin + j*dr, u_binv[i*nr + j], dummy, u_visc[i*nr + j]);
+            }
+        }
+        undersat_Binv_ = Opm::utils::UniformTableBilinear<double>(pmin, pmax, np, rmin, rmax, nr, u_binv);
+        undersat_mu_ = Opm::utils::UniformTableBilinear<double>(pmin, pmax, np, rmin, rmax, nr, u_visc);
+
+        // Measure the deviation at cell midpoints, where it is largest.
+        double max_err = 0.0;
+        for (int i = 0; i < np - 1; ++i) {
+            const double p = pmin + (i + 0.5)*dp_sat;
+            max_err = std::max(max_err, relativeError(sat_R_(p), linearInterpolation(sat_press, sat_rs, p)));
+            max_err = std::max(max_err, relativeError(sat_Binv_(p), linearInterpolation(sat_press, saturated_oil_table_[1], p)));
+            max_err = std::max(max_err, relativeError(sat_mu_(p), linearInterpolation(sat_press, saturated_oil_table_[2], p)));
+        }
+        for (int i = 0; i < np - 1; ++i) {
+            const double p = pmin + (i + 0.5)*dp;
+            const double rsat = linearInterpolation(sat_press, sat_rs, p);
+            for (int j = 0; j < nr - 1; ++j) {
+                const double r = rmin + (j + 0.5)*dr;
+                if (r > rsat) {
+                    continue; // Saturated, the undersaturated data are not used.
+                }
+                double Binv, dBinv, mu;
+                undersatOil(p, r, Binv, dBinv, mu);
+                max_err = std::max(max_err, relativeError(undersat_Binv_(p, r), Binv));
+                max_err = std::max(max_err, relativeError(undersat_mu_(p, r), mu));
+            }
+        }
+        tabulated_ = true;
+        return max_err;
+    }
+
+
+
+
     double MiscibilityLiveOil::miscible_oil(double press, const surfvol_t& surfvol,
 					    int item, bool deriv) const
     {
+        if (tabulated_) {
+            return miscibleOilTabulated(press, surfvol, item, deriv);
+        }
 	int section;
 	double R = linearInterpolation(saturated_oil_table_[0],
 					     saturated_oil_table_[3],
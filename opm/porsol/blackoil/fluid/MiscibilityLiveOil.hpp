@@ -36,6 +36,8 @@
      */
 
 #include "MiscibilityProps.hpp"
+#include <opm/core/utility/UniformTableLinear.hpp>
+#include <opm/porsol/common/UniformTableBilinear.hpp>
 
 #include <opm/parser/eclipse/EclipseState/EclipseState.hpp>
 
@@ -79,19 +81,64 @@ namespace Opm
                           std::vector<double>& output_R,
                           std::vector<double>& output_dRdp) const;
 
+        virtual void evalAll(int num,
+                             const PhaseVec* pressures,
+                             const CompVec* surfvol,
+                             int phase,
+                             const PvtBatchOutput& output) const;
+        virtual void evalAll(int region, double press, const surfvol_t& surfvol,
+                             double& B, double& dBdp,
+                             double& R, double& dRdp,
+                             double& mu) const;
+
+        virtual double tabulate(int num_pressure_samples, int num_ratio_samples);
+
     protected:
         double evalR(double press, const surfvol_t& surfvol) const;
         void evalRDeriv(double press, const surfvol_t& surfvol, double& R, double& dRdp) const;
         double evalB(double press, const surfvol_t& surfvol) const;
         void evalBDeriv(double press, const surfvol_t& surfvol, double& B, double& dBdp) const;
 
+        // Computes B, dB/dp, R, dR/dp and viscosity at a single point,
+        // with one lookup per table shared by all quantities.
+        void evalAllImpl(double press, const surfvol_t& surfvol,
+                         double& B, double& dBdp,
+                         double& R, double& dRdp,
+                         double& mu) const;
+
 	// item:  1=B  2=mu;
 	double miscible_oil(double press, const surfvol_t& surfvol, int item,
 			    bool deriv = false) const;
 
+        // Undersaturated 1/B, d(1/B)/dp and viscosity at solution ratio maxR,
+        // interpolated between the tabulated Rs sections.
+        void undersatOil(double press, double maxR,
+                         double& Binv, double& dBinvdp, double& mu) const;
+
+        // Saturated Rs and dRs/dp, from the exact or the resampled table.
+        double saturatedR(double press) const;
+        double saturatedRDeriv(double press) const;
+
+        // Counterparts of evalAllImpl() and miscible_oil() using the
+        // uniformly resampled tables.
+        void evalAllTabulated(double press, const surfvol_t& surfvol,
+                              double& B, double& dBdp,
+                              double& R, double& dRdp,
+                              double& mu) const;
+        double miscibleOilTabulated(double press, const surfvol_t& surfvol, int item,
+                                    bool deriv) const;
+
 	// PVT properties of live oil (with dissolved gas)
 	std::vector<std::vector<double> > saturated_oil_table_;	
 	std::vector<std::vector<std::vector<double> > > undersat_oil_tables_;
+
+        // Uniformly resampled tables, used if tabulated_ is true.
+        bool tabulated_;
+        Opm::utils::UniformTableLinear<double> sat_R_;
+        Opm::utils::UniformTableLinear<double> sat_Binv_;
+        Opm::utils::UniformTableLinear<double> sat_mu_;
+        Opm::utils::UniformTableBilinear<double> undersat_Binv_;   // (p, Rs)
+        Opm::utils::UniformTableBilinear<double> undersat_mu_;     // (p, Rs)
     };
 
 }
@@ -50,4 +50,9 @@ namespace Opm
     {
     }
 
+    double MiscibilityProps::tabulate(int, int)
+    {
+        return 0.0;
+    }
+
 } // namespace Opm
@@ -38,10 +38,30 @@
 #include "BlackoilDefs.hpp"
 #include <vector>
 #include <array>
+#include <algorithm>
+#include <cmath>
 
 namespace Opm
 {
 
+    /// Destination arrays for the fused batch evaluation
+    /// MiscibilityProps::evalAll().  Each non-null pointer must address
+    /// one PhaseVec per evaluation point, and only the entry belonging
+    /// to the evaluated phase is written.  Quantities that are not
+    /// wanted are marked by null pointers.
+    struct PvtBatchOutput
+    {
+        PvtBatchOutput()
+            : B(0), dBdp(0), R(0), dRdp(0), viscosity(0)
+        {
+        }
+        BlackoilDefs::PhaseVec* B;
+        BlackoilDefs::PhaseVec* dBdp;
+        BlackoilDefs::PhaseVec* R;
+        BlackoilDefs::PhaseVec* dRdp;
+        BlackoilDefs::PhaseVec* viscosity;
+    };
+
 
     class MiscibilityProps : public BlackoilDefs
     {
@@ -79,6 +99,52 @@ namespace Opm
                           int phase,
                           std::vector<double>& output_R,
                           std::vector<double>& output_dRdp) const = 0;
+
+        /// Fused batch evaluation. Computes all quantities requested in
+        /// output for num points in a single (OpenMP parallel) pass,
+        /// sharing table lookups between the quantities.
+        virtual void evalAll(int num,
+                             const PhaseVec* pressures,
+                             const CompVec* surfvol,
+                             int phase,
+                             const PvtBatchOutput& output) const = 0;
+
+        /// Fused evaluation at a single point: B, dB/dp, R, dR/dp and
+        /// viscosity from one shared table lookup.
+        virtual void evalAll(int region, double press, const surfvol_t& surfvol,
+                             double& B, double& dBdp,
+                             double& R, double& dRdp,
+                             double& mu) const = 0;
+
+        /// Switch to evaluation from tables resampled on uniform grids of
+        /// num_pressure_samples pressures and num_ratio_samples solution
+        /// ratios, so that lookups need no searching. Returns the largest
+        /// relative deviation from the exact tables found at the midpoints
+        /// of the uniform grid. The default does nothing and returns zero,
+        /// which is right for properties that are not table-driven or
+        /// are tabulated uniformly already.
+        virtual double tabulate(int num_pressure_samples, int num_ratio_samples);
+
+    protected:
+        /// Linear interpolation (or extrapolation) of yv at x within the
+        /// table interval [xv[ix], xv[ix+1]], e.g. as found by tableIndex().
+        /// The slope of the interval is returned in deriv.
+        static double sectionInterpolation(const std::vector<double>& xv,
+                                           const std::vector<double>& yv,
+                                           const double x,
+                                           const int ix,
+                                           double& deriv)
+        {
+            deriv = (yv[ix + 1] - yv[ix])/(xv[ix + 1] - xv[ix]);
+            return yv[ix] + deriv*(x - xv[ix]);
+        }
+
+        /// Relative deviation of approx from exact, used to report the
+        /// accuracy of resampled tables.
+        static double relativeError(const double approx, const double exact)
+        {
+            return std::fabs(approx - exact)/std::max(std::fabs(exact), 1e-20);
+        }
     };
 
 } // namespace Opm
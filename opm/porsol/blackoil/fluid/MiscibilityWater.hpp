@@ -198,6 +198,41 @@ namespace Opm
             output_dRdp.resize(num, 0.0);
         }
 
+        virtual void evalAll(const int num,
+                             const PhaseVec* pressures,
+                             const CompVec* surfvol,
+                             const int phase,
+                             const PvtBatchOutput& output) const
+        {
+#pragma omp parallel for
+            for (int i = 0; i < num; ++i) {
+                double B, dBdp, R, dRdp, mu;
+                MiscibilityWater::evalAll(0, pressures[i][phase], surfvol[i], B, dBdp, R, dRdp, mu);
+                if (output.B) output.B[i][phase] = B;
+                if (output.dBdp) output.dBdp[i][phase] = dBdp;
+                if (output.R) output.R[i][phase] = R;
+                if (output.dRdp) output.dRdp[i][phase] = dRdp;
+                if (output.viscosity) output.viscosity[i][phase] = mu;
+            }
+        }
+
+        virtual void evalAll(int /*region*/, double press, const surfvol_t& /*surfvol*/,
+                             double& B, double& dBdp,
+                             double& R, double& dRdp,
+                             double& mu) const
+        {
+            B = ref_B_;
+            if (comp_) {
+                // Computing a polynomial approximation to the exponential.
+                double x = comp_*(press - ref_press_);
+                B = ref_B_/(1.0 + x + 0.5*x*x);
+            }
+            dBdp = comp_ ? -comp_*B : 0.0;
+            R = 0.0;
+            dRdp = 0.0;
+            mu = viscosity_;
+        }
+
     private:
         double ref_press_;
         double ref_B_;
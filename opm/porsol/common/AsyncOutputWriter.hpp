@@ -0,0 +1,168 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_ASYNCOUTPUTWRITER_HEADER_INCLUDED
+#define OPM_ASYNCOUTPUTWRITER_HEADER_INCLUDED
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Opm
+{
+
+    /// Runs output jobs, either immediately or in order on a single
+    /// background thread. Jobs must own (or share) the data they write,
+    /// since the caller continues while they run. At most max_pending
+    /// jobs are queued, submit() blocks when the queue is full, so that
+    /// memory use stays bounded if output is slower than simulation.
+    /// An exception thrown by a job is rethrown by the next call to
+    /// submit() or finish(). After finish(), jobs are run immediately.
+    class AsyncOutputWriter
+    {
+    public:
+        explicit AsyncOutputWriter(const bool asynchronous = false, const int max_pending = 2)
+            : asynchronous_(asynchronous), max_pending_(max_pending < 1 ? 1 : max_pending),
+              stopping_(false), stopped_(false), busy_(false)
+        {
+            if (asynchronous_) {
+                thread_ = std::thread(&AsyncOutputWriter::run, this);
+            }
+        }
+
+        ~AsyncOutputWriter()
+        {
+            try {
+                finish();
+            } catch (...) {
+                // Destructors must not throw, the error is lost.
+            }
+        }
+
+        /// Queue a job (or run it now if not asynchronous).
+        void submit(std::function<void()> job)
+        {
+            if (!asynchronous_) {
+                job();
+                return;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            rethrowError();
+            space_.wait(lock, [this]() { return stopped_ || int(jobs_.size()) < max_pending_; });
+            if (stopped_) {
+                // The background thread is gone, all earlier jobs are done.
+                lock.unlock();
+                job();
+                return;
+            }
+            jobs_.push_back(std::move(job));
+            work_.notify_one();
+        }
+
+        /// Wait until all queued jobs are written.
+        void wait()
+        {
+            if (!asynchronous_) {
+                return;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            idle_.wait(lock, [this]() { return stopped_ || (jobs_.empty() && !busy_); });
+            rethrowError();
+        }
+
+        /// Write all queued jobs and stop the background thread.
+        void finish()
+        {
+            if (thread_.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stopping_ = true;
+                }
+                work_.notify_one();
+                thread_.join();
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            rethrowError();
+        }
+
+    private:
+        bool asynchronous_;
+        int max_pending_;
+        bool stopping_;
+        bool stopped_;   // The background thread has exited.
+        bool busy_;
+        std::deque<std::function<void()> > jobs_;
+        std::exception_ptr error_;
+        std::mutex mutex_;
+        std::condition_variable work_;
+        std::condition_variable space_;
+        std::condition_variable idle_;
+        std::thread thread_;
+
+        AsyncOutputWriter(const AsyncOutputWriter&);
+        AsyncOutputWriter& operator=(const AsyncOutputWriter&);
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (;;) {
+                work_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+                if (jobs_.empty()) {
+                    break;  // Stopping and nothing left to write.
+                }
+                std::function<void()> job = std::move(jobs_.front());
+                jobs_.pop_front();
+                busy_ = true;
+                space_.notify_one();
+                lock.unlock();
+                try {
+                    job();
+                } catch (...) {
+                    lock.lock();
+                    if (!error_) {
+                        error_ = std::current_exception();
+                    }
+                    lock.unlock();
+                }
+                lock.lock();
+                busy_ = false;
+                idle_.notify_all();
+            }
+            stopped_ = true;
+            idle_.notify_all();
+            space_.notify_all();
+        }
+
+        // Call with mutex_ held.
+        void rethrowError()
+        {
+            if (error_) {
+                std::exception_ptr e = error_;
+                error_ = std::exception_ptr();
+                std::rethrow_exception(e);
+            }
+        }
+    };
+
+} // namespace Opm
+
+#endif // OPM_ASYNCOUTPUTWRITER_HEADER_INCLUDED
@@ -0,0 +1,261 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_FIELDARENA_HEADER_INCLUDED
+#define OPM_FIELDARENA_HEADER_INCLUDED
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace Opm
+{
+
+    class FieldArena;
+
+    /// A contiguous array of entries owned by a FieldArena, or a view of
+    /// an array owned by someone else. It has the element access part of
+    /// the std::vector interface, but cannot be resized on its own, and
+    /// copying it copies the view, not the entries.
+    template <typename T>
+    class FieldArray
+    {
+    public:
+        typedef T value_type;
+        typedef T* iterator;
+        typedef const T* const_iterator;
+
+        FieldArray()
+            : data_(0), size_(0)
+        {
+        }
+
+        /// View of size entries at data, not owned by any arena.
+        FieldArray(T* data, const std::size_t size)
+            : data_(data), size_(size)
+        {
+        }
+
+        std::size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+        T& operator[](const std::size_t i)
+        {
+            assert(i < size_);
+            return data_[i];
+        }
+        const T& operator[](const std::size_t i) const
+        {
+            assert(i < size_);
+            return data_[i];
+        }
+
+        T* data() { return data_; }
+        const T* data() const { return data_; }
+        iterator begin() { return data_; }
+        iterator end() { return data_ + size_; }
+        const_iterator begin() const { return data_; }
+        const_iterator end() const { return data_ + size_; }
+
+    private:
+        friend class FieldArena;
+        T* data_;
+        std::size_t size_;
+    };
+
+
+    /// Storage for a group of FieldArrays of equal size, in a single
+    /// allocation with every array starting on a cache line. The owner
+    /// of the arrays lists them with a member template
+    ///
+    ///     template <class Op> void forEachField(Op& op)
+    ///
+    /// calling op(field) for every field, always in the same order.
+    /// The storage only grows, so that repeated evaluations on the
+    /// same grid do not allocate. Entry types must be trivially
+    /// destructible, as for the Dune::FieldVector and FieldMatrix
+    /// types of the fluid data.
+    class FieldArena
+    {
+    public:
+        enum { CacheLine = 64 };
+
+        FieldArena()
+            : capacity_(0), size_(0)
+        {
+        }
+
+        std::size_t size() const { return size_; }
+        std::size_t capacity() const { return capacity_; }
+
+        /// Set the size of all fields of owner to num. Existing entries
+        /// are kept, like std::vector::resize(), but entries beyond the
+        /// old size are only value-initialized when the storage grows.
+        template <class Owner>
+        void resize(Owner& owner, const std::size_t num)
+        {
+            if (num > capacity_) {
+                layout(owner, num, num, base(), capacity_, std::min(size_, num));
+            } else if (num != size_) {
+                SetSize op(num);
+                owner.forEachField(op);
+                size_ = num;
+            }
+        }
+
+        /// Make the fields of owner a copy of those laid out by other.
+        /// Owners call this from their copy constructor and assignment.
+        template <class Owner>
+        void assign(Owner& owner, const FieldArena& other)
+        {
+            assert(&other != this);
+            layout(owner, std::max(capacity_, other.size_), other.size_,
+                   other.base(), other.capacity_, other.size_);
+        }
+
+    private:
+        std::vector<char> buffer_;
+        std::size_t capacity_;
+        std::size_t size_;
+
+        FieldArena(const FieldArena&);
+        FieldArena& operator=(const FieldArena&);
+
+        template <typename T>
+        static std::size_t paddedBytes(const std::size_t num)
+        {
+            static_assert(CacheLine % alignof(T) == 0, "Field entries must fit the cache line alignment.");
+            static_assert(std::is_trivially_destructible<T>::value, "FieldArena does not run destructors.");
+            return (num*sizeof(T) + CacheLine - 1)/CacheLine*CacheLine;
+        }
+
+        char* base()
+        {
+            return buffer_.empty() ? 0 : alignedBase(&buffer_[0]);
+        }
+        const char* base() const
+        {
+            return buffer_.empty() ? 0 : alignedBase(const_cast<char*>(&buffer_[0]));
+        }
+        static char* alignedBase(char* p)
+        {
+            const std::size_t misalign = reinterpret_cast<std::size_t>(p) % CacheLine;
+            return misalign == 0 ? p : p + (CacheLine - misalign);
+        }
+
+        template <typename T>
+        static void bind(FieldArray<T>& field, T* data, const std::size_t num)
+        {
+            field.data_ = data;
+            field.size_ = num;
+        }
+
+        struct SetSize
+        {
+            explicit SetSize(const std::size_t n) : num(n) {}
+            template <typename T>
+            void operator()(FieldArray<T>& field) const
+            {
+                bind(field, field.data(), num);
+            }
+            std::size_t num;
+        };
+
+        struct Measure
+        {
+            explicit Measure(const std::size_t n) : capacity(n), bytes(0) {}
+            template <typename T>
+            void operator()(FieldArray<T>&)
+            {
+                bytes += paddedBytes<T>(capacity);
+            }
+            std::size_t capacity;
+            std::size_t bytes;
+        };
+
+        // Binds every field to its place in the layout of dst with the
+        // given capacity, and copies count entries per field from the
+        // layout of src with capacity src_capacity.
+        struct Relocate
+        {
+            template <typename T>
+            void operator()(FieldArray<T>& field)
+            {
+                T* d = reinterpret_cast<T*>(dst + dst_offset);
+                if (construct) {
+                    for (std::size_t i = 0; i < capacity; ++i) {
+                        new (d + i) T();
+                    }
+                }
+                if (count > 0) {
+                    const T* s = reinterpret_cast<const T*>(src + src_offset);
+                    std::copy(s, s + count, d);
+                }
+                bind(field, d, num);
+                dst_offset += paddedBytes<T>(capacity);
+                src_offset += paddedBytes<T>(src_capacity);
+            }
+            char* dst;
+            std::size_t capacity;
+            std::size_t num;
+            bool construct;
+            const char* src;
+            std::size_t src_capacity;
+            std::size_t count;
+            std::size_t dst_offset;
+            std::size_t src_offset;
+        };
+
+        template <class Owner>
+        void layout(Owner& owner, const std::size_t capacity, const std::size_t num,
+                    const char* src, const std::size_t src_capacity, const std::size_t count)
+        {
+            std::vector<char> buffer;
+            Relocate op;
+            op.construct = capacity != capacity_;
+            if (op.construct) {
+                Measure measure(capacity);
+                owner.forEachField(measure);
+                buffer.resize(measure.bytes + CacheLine);
+                op.dst = alignedBase(&buffer[0]);
+            } else {
+                op.dst = base();
+            }
+            op.capacity = capacity;
+            op.num = num;
+            op.src = src;
+            op.src_capacity = src_capacity;
+            op.count = count;
+            op.dst_offset = 0;
+            op.src_offset = 0;
+            owner.forEachField(op);
+            if (op.construct) {
+                buffer_.swap(buffer);
+                capacity_ = capacity;
+            }
+            size_ = num;
+        }
+    };
+
+} // namespace Opm
+
+#endif // OPM_FIELDARENA_HEADER_INCLUDED
@@ -0,0 +1,323 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_METRICS_HEADER_INCLUDED
+#define OPM_METRICS_HEADER_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace Opm
+{
+
+    /// Named timers, counters and histograms, cheap enough to leave on.
+    /// Looking up a metric by name takes a lock, updating it does not
+    /// (atomics only), so a metric may be updated from any thread. The
+    /// references returned stay valid for the life of the registry.
+    ///
+    /// Solvers record into MetricsRegistry::current(), which is the
+    /// registry installed for the calling thread by a
+    /// ScopedMetricsRegistry, or the global one. Metrics updated inside
+    /// OpenMP parallel regions go to the global registry, so solvers
+    /// record outside of them.
+    class MetricsRegistry
+    {
+    public:
+        /// Accumulated wall clock time and number of intervals.
+        class Timer
+        {
+        public:
+            Timer() : nanoseconds_(0), count_(0) {}
+            void add(const double seconds)
+            {
+                nanoseconds_ += std::int64_t(seconds*1e9);
+                ++count_;
+            }
+            double seconds() const { return 1e-9*nanoseconds_.load(); }
+            std::int64_t count() const { return count_.load(); }
+        private:
+            std::atomic<std::int64_t> nanoseconds_;
+            std::atomic<std::int64_t> count_;
+        };
+
+        class Counter
+        {
+        public:
+            Counter() : value_(0) {}
+            void add(const std::int64_t n = 1) { value_ += n; }
+            std::int64_t value() const { return value_.load(); }
+        private:
+            std::atomic<std::int64_t> value_;
+        };
+
+        /// Count, sum, min and max, and counts in power of two buckets:
+        /// bucket k holds values in [2^(k - Offset - 1), 2^(k - Offset)),
+        /// bucket 0 also all smaller values, including zero and negative
+        /// ones, and the last bucket all larger values.
+        class Histogram
+        {
+        public:
+            enum { NumBuckets = 64, Offset = 31 };
+            Histogram()
+                : count_(0), sum_(0.0),
+                  min_(std::numeric_limits<double>::infinity()),
+                  max_(-std::numeric_limits<double>::infinity())
+            {
+                for (int k = 0; k < NumBuckets; ++k) {
+                    buckets_[k] = 0;
+                }
+            }
+            void add(const double x)
+            {
+                ++count_;
+                ++buckets_[bucket(x)];
+                atomicUpdate(sum_, x, [](double a, double b) { return a + b; });
+                atomicUpdate(min_, x, [](double a, double b) { return b < a ? b : a; });
+                atomicUpdate(max_, x, [](double a, double b) { return b > a ? b : a; });
+            }
+            std::int64_t count() const { return count_.load(); }
+            double sum() const { return sum_.load(); }
+            double min() const { return min_.load(); }
+            double max() const { return max_.load(); }
+            std::int64_t bucketCount(const int k) const { return buckets_[k].load(); }
+            /// Upper bound of bucket k.
+            static double bucketLimit(const int k) { return std::ldexp(1.0, k - Offset); }
+            static int bucket(const double x)
+            {
+                if (!(x > 0.0)) {
+                    return 0;
+                }
+                int e;
+                std::frexp(x, &e);  // x in [2^(e-1), 2^e)
+                const int k = e + Offset;
+                return k < 0 ? 0 : (k >= NumBuckets ? NumBuckets - 1 : k);
+            }
+        private:
+            std::atomic<std::int64_t> count_;
+            std::atomic<double> sum_;
+            std::atomic<double> min_;
+            std::atomic<double> max_;
+            std::atomic<std::int64_t> buckets_[NumBuckets];
+
+            template <class Op>
+            static void atomicUpdate(std::atomic<double>& a, const double x, Op op)
+            {
+                double old = a.load();
+                while (!a.compare_exchange_weak(old, op(old, x))) {
+                }
+            }
+        };
+
+        MetricsRegistry() {}
+
+        Timer& timer(const std::string& name) { return get(timers_, name); }
+        Counter& counter(const std::string& name) { return get(counters_, name); }
+        Histogram& histogram(const std::string& name) { return get(histograms_, name); }
+
+        /// Remove all metrics. References obtained before are invalid.
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            timers_.clear();
+            counters_.clear();
+            histograms_.clear();
+        }
+
+        /// Write all metrics as a JSON object, with the entries of info
+        /// (for instance the case name) as strings under "info".
+        void writeJson(std::ostream& os,
+                       const std::map<std::string, std::string>& info = std::map<std::string, std::string>()) const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const std::streamsize old_precision = os.precision(15);
+            os << "{\n  \"info\": {";
+            const char* sep = "\n";
+            for (auto it = info.begin(); it != info.end(); ++it) {
+                os << sep << "    ";
+                writeString(os, it->first);
+                os << ": ";
+                writeString(os, it->second);
+                sep = ",\n";
+            }
+            os << (info.empty() ? "},\n" : "\n  },\n");
+
+            os << "  \"timers\": {";
+            sep = "\n";
+            for (auto it = timers_.begin(); it != timers_.end(); ++it) {
+                os << sep << "    ";
+                writeString(os, it->first);
+                os << ": {\"count\": " << it->second->count()
+                   << ", \"seconds\": " << it->second->seconds() << '}';
+                sep = ",\n";
+            }
+            os << (timers_.empty() ? "},\n" : "\n  },\n");
+
+            os << "  \"counters\": {";
+            sep = "\n";
+            for (auto it = counters_.begin(); it != counters_.end(); ++it) {
+                os << sep << "    ";
+                writeString(os, it->first);
+                os << ": " << it->second->value();
+                sep = ",\n";
+            }
+            os << (counters_.empty() ? "},\n" : "\n  },\n");
+
+            os << "  \"histograms\": {";
+            sep = "\n";
+            for (auto it = histograms_.begin(); it != histograms_.end(); ++it) {
+                const Histogram& h = *it->second;
+                os << sep << "    ";
+                writeString(os, it->first);
+                os << ": {\"count\": " << h.count() << ", \"sum\": " << h.sum();
+                if (h.count() > 0) {
+                    os << ", \"min\": " << h.min() << ", \"max\": " << h.max();
+                }
+                os << ", \"buckets\": [";
+                const char* bsep = "";
+                for (int k = 0; k < Histogram::NumBuckets; ++k) {
+                    if (h.bucketCount(k) > 0) {
+                        os << bsep << "{\"lt\": " << Histogram::bucketLimit(k)
+                           << ", \"count\": " << h.bucketCount(k) << '}';
+                        bsep = ", ";
+                    }
+                }
+                os << "]}";
+                sep = ",\n";
+            }
+            os << (histograms_.empty() ? "}\n" : "\n  }\n");
+            os << "}\n";
+            os.precision(old_precision);
+        }
+
+        /// The registry of processes that do not install their own.
+        static MetricsRegistry& global()
+        {
+            static MetricsRegistry registry;
+            return registry;
+        }
+
+        /// The registry installed for this thread, or global().
+        static MetricsRegistry& current()
+        {
+            MetricsRegistry* r = currentPointer();
+            return r ? *r : global();
+        }
+
+    private:
+        friend class ScopedMetricsRegistry;
+        mutable std::mutex mutex_;
+        std::map<std::string, std::unique_ptr<Timer> > timers_;
+        std::map<std::string, std::unique_ptr<Counter> > counters_;
+        std::map<std::string, std::unique_ptr<Histogram> > histograms_;
+
+        MetricsRegistry(const MetricsRegistry&);
+        MetricsRegistry& operator=(const MetricsRegistry&);
+
+        static MetricsRegistry*& currentPointer()
+        {
+            static thread_local MetricsRegistry* registry = 0;
+            return registry;
+        }
+
+        template <class Metric>
+        Metric& get(std::map<std::string, std::unique_ptr<Metric> >& metrics, const std::string& name)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::unique_ptr<Metric>& m = metrics[name];
+            if (!m) {
+                m.reset(new Metric);
+            }
+            return *m;
+        }
+
+        static void writeString(std::ostream& os, const std::string& s)
+        {
+            static const char hex[] = "0123456789abcdef";
+            os << '"';
+            for (std::size_t i = 0; i < s.size(); ++i) {
+                const unsigned char c = s[i];
+                if (c == '"' || c == '\\') {
+                    os << '\\' << c;
+                } else if (c < 0x20) {
+                    os << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+                } else {
+                    os << c;
+                }
+            }
+            os << '"';
+        }
+    };
+
+
+    /// Makes a registry current() for the calling thread, for its
+    /// lifetime.
+    class ScopedMetricsRegistry
+    {
+    public:
+        explicit ScopedMetricsRegistry(MetricsRegistry& registry)
+            : previous_(MetricsRegistry::currentPointer())
+        {
+            MetricsRegistry::currentPointer() = &registry;
+        }
+        ~ScopedMetricsRegistry()
+        {
+            MetricsRegistry::currentPointer() = previous_;
+        }
+    private:
+        MetricsRegistry* previous_;
+        ScopedMetricsRegistry(const ScopedMetricsRegistry&);
+        ScopedMetricsRegistry& operator=(const ScopedMetricsRegistry&);
+    };
+
+
+    /// Adds the wall clock time of its lifetime to a timer.
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(MetricsRegistry::Timer& timer)
+            : timer_(timer), start_(std::chrono::steady_clock::now())
+        {
+        }
+        /// A timer of MetricsRegistry::current().
+        explicit ScopedTimer(const std::string& name)
+            : timer_(MetricsRegistry::current().timer(name)), start_(std::chrono::steady_clock::now())
+        {
+        }
+        ~ScopedTimer()
+        {
+            timer_.add(std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+        }
+    private:
+        MetricsRegistry::Timer& timer_;
+        std::chrono::steady_clock::time_point start_;
+        ScopedTimer(const ScopedTimer&);
+        ScopedTimer& operator=(const ScopedTimer&);
+    };
+
+} // namespace Opm
+
+#endif // OPM_METRICS_HEADER_INCLUDED
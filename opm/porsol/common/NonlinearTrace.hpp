@@ -0,0 +1,223 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_NONLINEARTRACE_HEADER_INCLUDED
+#define OPM_NONLINEARTRACE_HEADER_INCLUDED
+
+#include <opm/common/ErrorMacros.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Opm
+{
+
+    /// In-memory trace of nonlinear solver iterations. The last
+    /// capacity iteration records are kept in a ring buffer, which
+    /// costs no I/O and no allocation after construction. Full
+    /// residual vectors are only kept when requested, for the current
+    /// solve. flush() appends the records and residuals of the current
+    /// solve to a binary file; solvers call it at the end of a solve
+    /// when residuals were captured, and when a solve fails.
+    ///
+    /// File format, little-endian as written by the host, one block
+    /// per flush():
+    ///   uint32 magic 0x4352544e ("NTRC"), uint32 version (1),
+    ///   int32 solve number, int32 status, int32 number of records,
+    ///   records: int32 solve, int32 iteration, int32 linear iterations,
+    ///            7 doubles: residual, flux change, pressure change,
+    ///            max relative volume discrepancy, linear setup time,
+    ///            linear solve time, step length,
+    ///   int32 number of residual vectors,
+    ///   vectors: int32 iteration, int64 size, size doubles.
+    class NonlinearTrace
+    {
+    public:
+        /// One nonlinear iteration. Quantities a solver does not
+        /// compute are left at -1.
+        struct Record
+        {
+            Record()
+                : solve(-1), iteration(-1), linear_iterations(-1),
+                  residual(-1.0), flux_change(-1.0), pressure_change(-1.0),
+                  max_rel_voldiscr(-1.0), linear_setup_time(-1.0),
+                  linear_solve_time(-1.0), step_length(-1.0)
+            {
+            }
+            int solve;
+            int iteration;
+            int linear_iterations;
+            double residual;
+            double flux_change;
+            double pressure_change;
+            double max_rel_voldiscr;
+            double linear_setup_time;
+            double linear_solve_time;
+            double step_length;
+        };
+
+        enum { Magic = 0x4352544e, Version = 1 };
+
+        NonlinearTrace()
+            : capture_residuals_(false), solve_(-1), next_(0), size_(0), solve_begin_(0), file_started_(false)
+        {
+        }
+
+        /// capacity records are kept, 0 disables the trace. If
+        /// capture_residuals is true, residual vectors given to
+        /// residual() are kept until the next flush().
+        void init(const int capacity, const bool capture_residuals, const std::string& filename)
+        {
+            ring_.assign(capacity > 0 ? capacity : 0, Record());
+            capture_residuals_ = capture_residuals;
+            filename_ = filename;
+            solve_ = -1;
+            next_ = 0;
+            size_ = 0;
+            solve_begin_ = 0;
+            residuals_.clear();
+            file_started_ = false;
+        }
+
+        /// Write to filename from the next flush() on, starting a new file.
+        void setFilename(const std::string& filename)
+        {
+            filename_ = filename;
+            file_started_ = false;
+        }
+
+        bool enabled() const { return !ring_.empty(); }
+        bool capturesResiduals() const { return capture_residuals_; }
+        int capacity() const { return ring_.size(); }
+
+        /// Start a new solve.
+        void beginSolve()
+        {
+            ++solve_;
+            solve_begin_ = size_;
+            residuals_.clear();
+        }
+
+        /// Number of the current solve, from 0.
+        int solveNumber() const { return solve_; }
+
+        /// Add the record of an iteration, overwriting the oldest when
+        /// the buffer is full. The solve number is filled in.
+        void record(Record rec)
+        {
+            if (ring_.empty()) {
+                return;
+            }
+            rec.solve = solve_;
+            ring_[next_] = rec;
+            next_ = (next_ + 1) % ring_.size();
+            ++size_;
+        }
+
+        /// Keep the residual of an iteration, if residuals are captured.
+        void residual(const int iteration, const std::vector<double>& res)
+        {
+            if (capture_residuals_) {
+                residuals_.push_back(std::make_pair(iteration, res));
+            }
+        }
+
+        /// Number of records kept.
+        int size() const
+        {
+            return size_ < ring_.size() ? int(size_) : int(ring_.size());
+        }
+
+        /// Record i of those kept, 0 being the oldest.
+        const Record& operator[](const int i) const
+        {
+            const std::size_t first = size_ < ring_.size() ? 0 : next_;
+            return ring_[(first + i) % ring_.size()];
+        }
+
+        /// Append the records and residuals of the current solve (as
+        /// far as they are still in the buffer) to the file, with the
+        /// given status code.
+        void flush(const int status)
+        {
+            if (filename_.empty()) {
+                return;
+            }
+            std::ofstream os(filename_.c_str(), file_started_ ? std::ios::binary | std::ios::app
+                                                              : std::ios::binary | std::ios::trunc);
+            if (!os) {
+                OPM_THROW(std::runtime_error, "Could not open trace file " << filename_);
+            }
+            file_started_ = true;
+            const int kept = size();
+            const int num = std::min(size_ - solve_begin_, std::size_t(kept));
+            write<std::uint32_t>(os, Magic);
+            write<std::uint32_t>(os, Version);
+            write<std::int32_t>(os, solve_);
+            write<std::int32_t>(os, status);
+            write<std::int32_t>(os, num);
+            for (int i = kept - num; i < kept; ++i) {
+                const Record& r = (*this)[i];
+                write<std::int32_t>(os, r.solve);
+                write<std::int32_t>(os, r.iteration);
+                write<std::int32_t>(os, r.linear_iterations);
+                const double values[7] = { r.residual, r.flux_change, r.pressure_change, r.max_rel_voldiscr,
+                                           r.linear_setup_time, r.linear_solve_time, r.step_length };
+                os.write(reinterpret_cast<const char*>(values), sizeof(values));
+            }
+            write<std::int32_t>(os, residuals_.size());
+            for (std::size_t v = 0; v < residuals_.size(); ++v) {
+                const std::vector<double>& res = residuals_[v].second;
+                write<std::int32_t>(os, residuals_[v].first);
+                write<std::int64_t>(os, res.size());
+                if (!res.empty()) {
+                    os.write(reinterpret_cast<const char*>(&res[0]), res.size()*sizeof(double));
+                }
+            }
+            residuals_.clear();
+            if (!os) {
+                OPM_THROW(std::runtime_error, "Could not write trace file " << filename_);
+            }
+        }
+
+    private:
+        std::vector<Record> ring_;
+        bool capture_residuals_;
+        std::string filename_;
+        int solve_;
+        std::size_t next_;
+        std::size_t size_;        // Records added in total.
+        std::size_t solve_begin_; // Value of size_ when the current solve began.
+        std::vector<std::pair<int, std::vector<double> > > residuals_;
+        bool file_started_;
+
+        template <typename T>
+        static void write(std::ostream& os, const T value)
+        {
+            os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+    };
+
+} // namespace Opm
+
+#endif // OPM_NONLINEARTRACE_HEADER_INCLUDED
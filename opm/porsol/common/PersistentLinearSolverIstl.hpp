@@ -0,0 +1,289 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_PERSISTENTLINEARSOLVERISTL_HEADER_INCLUDED
+#define OPM_PERSISTENTLINEARSOLVERISTL_HEADER_INCLUDED
+
+#include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <opm/core/utility/StopWatch.hpp>
+#include <opm/common/ErrorMacros.hpp>
+
+#include <dune/common/fvector.hh>
+#include <dune/common/fmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+#include <dune/istl/paamg/amg.hh>
+#include <dune/istl/paamg/pinfo.hh>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace Opm
+{
+
+    /// Solver for a sequence of linear systems in CSR format that share
+    /// their sparsity pattern, such as the Newton systems of a nonlinear
+    /// pressure solve. Unlike LinearSolverIstl, the ISTL matrix is kept
+    /// between calls and only its values are updated, and the AMG
+    /// hierarchy is reused as a (slightly stale) preconditioner until the
+    /// iteration count grows by more than a given factor from the count
+    /// right after it was built, or the solver fails to converge.
+    ///
+    /// linsolver_type selects the method as for LinearSolverIstl:
+    ///   0  CG with ILU0,
+    ///   1  CG with AMG (the default),
+    ///   2  BiCGSTAB with ILU0.
+    /// The ILU0 factorization depends on the values and is recomputed
+    /// for every system. Other types are not supported and throw.
+    ///
+    /// Parameters (with defaults):
+    ///   linsolver_type                (1)
+    ///   linsolver_residual_tolerance  (1e-8)
+    ///   linsolver_max_iterations      (0, meaning the system size)
+    ///   linsolver_verbosity           (0)
+    ///   linsolver_smooth_steps        (2)
+    ///   linsolver_prolongate_factor   (1.6)
+    ///   linsolver_reuse_amg           (true)
+    ///   linsolver_rebuild_factor      (2.0)
+    class PersistentLinearSolverIstl
+    {
+    public:
+        struct LinearSolverReport
+        {
+            LinearSolverReport()
+                : converged(false), iterations(0), residual_reduction(0.0),
+                  setup_time(0.0), solve_time(0.0), rebuilt(false)
+            {
+            }
+            bool converged;
+            int iterations;
+            double residual_reduction;
+            double setup_time;   // Seconds spent updating the matrix and the preconditioner.
+            double solve_time;   // Seconds spent in the Krylov solver.
+            bool rebuilt;        // True if the preconditioner was (re)built.
+        };
+
+        enum LinsolverType { CG_ILU0 = 0, CG_AMG = 1, BiCGStab_ILU0 = 2 };
+
+        explicit PersistentLinearSolverIstl(const Opm::parameter::ParameterGroup& param)
+            : rebuild_needed_(true), iterations_after_rebuild_(0)
+        {
+            const int type = param.getDefault("linsolver_type", int(CG_AMG));
+            if (type != CG_ILU0 && type != CG_AMG && type != BiCGStab_ILU0) {
+                OPM_THROW(std::runtime_error, "PersistentLinearSolverIstl: unsupported linsolver_type " << type
+                          << ", use 0 (CG_ILU0), 1 (CG_AMG) or 2 (BiCGStab_ILU0).");
+            }
+            type_ = LinsolverType(type);
+            residual_tolerance_ = param.getDefault("linsolver_residual_tolerance", 1e-8);
+            max_iterations_ = param.getDefault("linsolver_max_iterations", 0);
+            verbosity_ = param.getDefault("linsolver_verbosity", 0);
+            smooth_steps_ = param.getDefault("linsolver_smooth_steps", 2);
+            prolongate_factor_ = param.getDefault("linsolver_prolongate_factor", 1.6);
+            reuse_amg_ = param.getDefault("linsolver_reuse_amg", true);
+            rebuild_factor_ = param.getDefault("linsolver_rebuild_factor", 2.0);
+        }
+
+        LinsolverType type() const
+        {
+            return type_;
+        }
+
+        /// Solve the system given by the CSR arrays (ia, ja, sa) of size
+        /// n with nnz nonzeros, for the right hand side rhs.
+        LinearSolverReport solve(const int n,
+                                 const int nnz,
+                                 const int* ia,
+                                 const int* ja,
+                                 const double* sa,
+                                 const double* rhs,
+                                 double* solution)
+        {
+            LinearSolverReport report;
+            Opm::time::StopWatch clock;
+            clock.start();
+            if (!sameStructure(n, nnz, ia, ja)) {
+                buildStructure(n, nnz, ia, ja);
+                rebuild_needed_ = true;
+            }
+            updateValues(nnz, sa);
+            if (type_ != CG_AMG || rebuild_needed_ || !reuse_amg_ || !amg_) {
+                buildPreconditioner();
+                report.rebuilt = true;
+            }
+            clock.stop();
+            report.setup_time = clock.secsSinceStart();
+
+            Vector b(n);
+            std::copy(rhs, rhs + n, &b[0][0]);
+            clock.start();
+            Dune::InverseOperatorResult result = krylovSolve(b);
+            if (!result.converged && !report.rebuilt) {
+                // Stale hierarchy, rebuild and try again.
+                clock.stop();
+                report.solve_time = clock.secsSinceStart();
+                Opm::time::StopWatch setup_clock;
+                setup_clock.start();
+                buildPreconditioner();
+                setup_clock.stop();
+                report.setup_time += setup_clock.secsSinceStart();
+                report.rebuilt = true;
+                std::copy(rhs, rhs + n, &b[0][0]);
+                clock.start();
+                result = krylovSolve(b);
+            }
+            clock.stop();
+            report.solve_time += clock.secsSinceStart();
+
+            std::copy(&x_[0][0], &x_[0][0] + n, solution);
+            report.converged = result.converged;
+            report.iterations = result.iterations;
+            report.residual_reduction = result.reduction;
+
+            // Rebuild next time if convergence has degraded too much.
+            if (report.rebuilt) {
+                iterations_after_rebuild_ = std::max(result.iterations, 1);
+                rebuild_needed_ = false;
+            } else if (result.iterations > rebuild_factor_*iterations_after_rebuild_) {
+                rebuild_needed_ = true;
+            }
+            return report;
+        }
+
+    private:
+        typedef Dune::FieldVector<double, 1> VectorBlock;
+        typedef Dune::FieldMatrix<double, 1, 1> MatrixBlock;
+        typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+        typedef Dune::BlockVector<VectorBlock> Vector;
+        typedef Dune::MatrixAdapter<Matrix, Vector, Vector> Operator;
+        typedef Dune::SeqILU0<Matrix, Vector, Vector> Smoother;
+        typedef Dune::Amg::CoarsenCriterion<Dune::Amg::SymmetricCriterion<Matrix, Dune::Amg::FirstDiagonal> > Criterion;
+        typedef Dune::Amg::AMG<Operator, Vector, Smoother, Dune::Amg::SequentialInformation> Precond;
+
+        LinsolverType type_;
+        double residual_tolerance_;
+        int max_iterations_;
+        int verbosity_;
+        int smooth_steps_;
+        double prolongate_factor_;
+        bool reuse_amg_;
+        double rebuild_factor_;
+
+        std::vector<int> ia_;
+        std::vector<int> ja_;
+        // Address of the matrix entry of every CSR nonzero.
+        std::vector<double*> value_ptr_;
+        Matrix A_;
+        Vector x_;
+        std::unique_ptr<Operator> op_;
+        std::unique_ptr<Precond> amg_;
+        std::unique_ptr<Smoother> ilu_;
+        bool rebuild_needed_;
+        int iterations_after_rebuild_;
+
+        bool sameStructure(const int n, const int nnz, const int* ia, const int* ja) const
+        {
+            return int(ia_.size()) == n + 1 && int(ja_.size()) == nnz
+                && std::equal(ia_.begin(), ia_.end(), ia)
+                && std::equal(ja_.begin(), ja_.end(), ja);
+        }
+
+        void buildStructure(const int n, const int nnz, const int* ia, const int* ja)
+        {
+            ia_.assign(ia, ia + n + 1);
+            ja_.assign(ja, ja + nnz);
+            A_ = Matrix();
+            A_.setSize(n, n, nnz);
+            A_.setBuildMode(Matrix::row_wise);
+            for (Matrix::CreateIterator row = A_.createbegin(); row != A_.createend(); ++row) {
+                const int i = row.index();
+                for (int k = ia[i]; k < ia[i + 1]; ++k) {
+                    row.insert(ja[k]);
+                }
+            }
+            value_ptr_.resize(nnz);
+            for (int i = 0; i < n; ++i) {
+                for (int k = ia[i]; k < ia[i + 1]; ++k) {
+                    value_ptr_[k] = &A_[i][ja[k]][0][0];
+                }
+            }
+            x_.resize(n);
+            op_.reset(new Operator(A_));
+            amg_.reset();
+            ilu_.reset();
+        }
+
+        void updateValues(const int nnz, const double* sa)
+        {
+            A_ = 0.0;
+            for (int k = 0; k < nnz; ++k) {
+                *value_ptr_[k] += sa[k];
+            }
+        }
+
+        void buildPreconditioner()
+        {
+            if (type_ != CG_AMG) {
+                ilu_.reset(new Smoother(A_, 1.0));
+                return;
+            }
+            Precond::SmootherArgs smoother_args;
+            smoother_args.relaxationFactor = 1.0;
+            Criterion criterion;
+            criterion.setDebugLevel(verbosity_);
+            criterion.setProlongationDampingFactor(prolongate_factor_);
+            criterion.setBeta(1e-10);
+            amg_.reset(new Precond(*op_, criterion, smoother_args,
+                                   1, smooth_steps_, smooth_steps_));
+        }
+
+        Dune::InverseOperatorResult krylovSolve(Vector& b)
+        {
+            if (type_ == CG_AMG) {
+                return krylovSolve(*amg_, b);
+            } else {
+                return krylovSolve(*ilu_, b);
+            }
+        }
+
+        template <class Preconditioner>
+        Dune::InverseOperatorResult krylovSolve(Preconditioner& precond, Vector& b)
+        {
+            const int maxit = max_iterations_ > 0 ? max_iterations_ : int(A_.N());
+            Dune::InverseOperatorResult result;
+            x_ = 0.0;
+            if (type_ == BiCGStab_ILU0) {
+                Dune::BiCGSTABSolver<Vector> linsolve(*op_, precond, residual_tolerance_,
+                                                      maxit, verbosity_);
+                linsolve.apply(x_, b, result);
+            } else {
+                Dune::CGSolver<Vector> linsolve(*op_, precond, residual_tolerance_,
+                                                maxit, verbosity_);
+                linsolve.apply(x_, b, result);
+            }
+            return result;
+        }
+    };
+
+} // namespace Opm
+
+#endif // OPM_PERSISTENTLINEARSOLVERISTL_HEADER_INCLUDED
@@ -0,0 +1,157 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_UNIFORMTABLEBILINEAR_HEADER_INCLUDED
+#define OPM_UNIFORMTABLEBILINEAR_HEADER_INCLUDED
+
+#include <opm/common/ErrorMacros.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace Opm
+{
+    namespace utils
+    {
+
+        /// @brief Bilinear interpolation in a table sampled on a uniform
+        /// grid over [xmin, xmax] x [ymin, ymax]. This is the
+        /// two-dimensional counterpart of UniformTableLinear, and uses
+        /// the same (ClosedRange) policy outside the domain: arguments
+        /// are moved to the nearest point of the domain.
+        template <typename T>
+        class UniformTableBilinear
+        {
+        public:
+            /// @brief Default constructor, creates an empty table.
+            UniformTableBilinear()
+                : xmin_(0.0), xmax_(0.0), ymin_(0.0), ymax_(0.0),
+                  nx_(0), ny_(0), dx_(0.0), dy_(0.0)
+            {
+            }
+
+            /// @brief Construct from samples.
+            /// @param values the nx*ny samples, with values[i*ny + j]
+            ///        being the sample at (xmin + i*dx, ymin + j*dy).
+            UniformTableBilinear(const double xmin, const double xmax, const int nx,
+                                 const double ymin, const double ymax, const int ny,
+                                 const std::vector<T>& values)
+                : xmin_(xmin), xmax_(xmax), ymin_(ymin), ymax_(ymax),
+                  nx_(nx), ny_(ny), values_(values)
+            {
+                if (nx < 2 || ny < 2 || xmax <= xmin || ymax <= ymin) {
+                    OPM_THROW(std::runtime_error, "UniformTableBilinear needs at least 2x2 samples on a non-empty domain.");
+                }
+                if (int(values.size()) != nx*ny) {
+                    OPM_THROW(std::runtime_error, "UniformTableBilinear: got " << values.size()
+                              << " samples, expected " << nx*ny);
+                }
+                dx_ = (xmax - xmin)/(nx - 1);
+                dy_ = (ymax - ymin)/(ny - 1);
+            }
+
+            /// @brief Build a table by sampling a function f(x, y).
+            template <class Function>
+            static UniformTableBilinear sample(const double xmin, const double xmax, const int nx,
+                                               const double ymin, const double ymax, const int ny,
+                                               const Function& f)
+            {
+                std::vector<T> values(nx*ny);
+                const double dx = (xmax - xmin)/(nx - 1);
+                const double dy = (ymax - ymin)/(ny - 1);
+                for (int i = 0; i < nx; ++i) {
+                    for (int j = 0; j < ny; ++j) {
+                        values[i*ny + j] = f(xmin + i*dx, ymin + j*dy);
+                    }
+                }
+                return UniformTableBilinear(xmin, xmax, nx, ymin, ymax, ny, values);
+            }
+
+            /// @brief Interpolated value at (x, y).
+            T operator()(const double x, const double y) const
+            {
+                T value, dfdx, dfdy;
+                evaluate(x, y, value, dfdx, dfdy);
+                return value;
+            }
+
+            /// @brief Interpolated value and partial derivatives at (x, y).
+            /// The derivatives are those of the bilinear interpolant in
+            /// the grid cell containing (x, y).
+            void evaluate(const double x, const double y,
+                          T& value, T& dfdx, T& dfdy) const
+            {
+                int i, j;
+                double tx, ty;
+                locate(x, xmin_, xmax_, dx_, nx_, i, tx);
+                locate(y, ymin_, ymax_, dy_, ny_, j, ty);
+                const T f00 = values_[i*ny_ + j];
+                const T f01 = values_[i*ny_ + j + 1];
+                const T f10 = values_[(i + 1)*ny_ + j];
+                const T f11 = values_[(i + 1)*ny_ + j + 1];
+                const T fy0 = f00 + tx*(f10 - f00);
+                const T fy1 = f01 + tx*(f11 - f01);
+                value = fy0 + ty*(fy1 - fy0);
+                dfdx = ((f10 - f00) + ty*((f11 - f01) - (f10 - f00)))/dx_;
+                dfdy = (fy1 - fy0)/dy_;
+            }
+
+            /// @brief Partial derivative with respect to x at (x, y).
+            T derivativeX(const double x, const double y) const
+            {
+                T value, dfdx, dfdy;
+                evaluate(x, y, value, dfdx, dfdy);
+                return dfdx;
+            }
+
+            /// @brief Partial derivative with respect to y at (x, y).
+            T derivativeY(const double x, const double y) const
+            {
+                T value, dfdx, dfdy;
+                evaluate(x, y, value, dfdx, dfdy);
+                return dfdy;
+            }
+
+            bool empty() const
+            {
+                return values_.empty();
+            }
+
+        private:
+            double xmin_, xmax_, ymin_, ymax_;
+            int nx_, ny_;
+            double dx_, dy_;
+            std::vector<T> values_;
+
+            // Find the interval index and the local coordinate in [0, 1]
+            // of the (closed range) point x. Written so that a NaN
+            // argument ends up at xmin rather than at an invalid index.
+            static void locate(const double xparam, const double xmin, const double xmax,
+                               const double dx, const int n, int& index, double& t)
+            {
+                const double x = (xparam >= xmin) ? ((xparam <= xmax) ? xparam : xmax) : xmin;
+                const double pos = (x - xmin)/dx;
+                index = std::min(int(pos), n - 2);
+                t = pos - index;
+            }
+        };
+
+    } // namespace utils
+} // namespace Opm
+
+#endif // OPM_UNIFORMTABLEBILINEAR_HEADER_INCLUDED
@@ -42,6 +42,7 @@
 #include <opm/core/utility/Units.hpp>
 #include <dune/grid/common/Volumes.hpp>
 #include <opm/core/utility/StopWatch.hpp>
+#include <opm/porsol/common/Metrics.hpp>
 #include <opm/porsol/common/ImplicitTransportDefs.hpp>
 #include <opm/core/pressure/tpfa/trans_tpfa.h>
 
@@ -319,6 +320,10 @@ namespace Opm
             repeats +=1;
         }
         clock.stop();
+        MetricsRegistry& metrics = MetricsRegistry::current();
+        metrics.timer("transport.euler_upstream_implicit").add(clock.secsSinceStart());
+        metrics.counter("transport.euler_upstream_implicit.substeps").add(nr_transport_steps);
+        metrics.counter("transport.euler_upstream_implicit.repeats").add(repeats);
         std::cout << "EulerUpstreamImplicite used  " << repeats
                   << " repeats and " << nr_transport_steps <<" steps"<< std::endl;
 #ifdef VERBOSE
@@ -45,6 +45,7 @@
 #include <dune/grid/common/Volumes.hpp>
 #include <opm/porsol/euler/CflCalculator.hpp>
 #include <opm/core/utility/StopWatch.hpp>
+#include <opm/porsol/common/Metrics.hpp>
 
 #include <cassert>
 #include <cmath>
@@ -212,6 +213,10 @@ namespace Opm
 	    }
 	}
         clock.stop();
+        MetricsRegistry& metrics = MetricsRegistry::current();
+        metrics.timer("transport.euler_upstream").add(clock.secsSinceStart());
+        metrics.counter("transport.euler_upstream.substeps").add(nr_transport_steps);
+        metrics.counter("transport.euler_upstream.repeats").add(repeats);
 #ifdef VERBOSE
         std::cout << "Seconds taken by transport solver: " << clock.secsSinceStart() << std::endl;
 #endif // VERBOSE
@@ -41,6 +41,7 @@
 #include <opm/core/utility/Units.hpp>
 #include <opm/core/utility/RootFinders.hpp>
 #include <opm/core/utility/StopWatch.hpp>
+#include <opm/porsol/common/Metrics.hpp>
 #include <dune/grid/common/Volumes.hpp>
 #include <opm/porsol/common/ReservoirPropertyFixedMobility.hpp>
 #include <opm/porsol/euler/MatchSaturatedVolumeFunctor.hpp>
@@ -223,6 +224,9 @@ namespace Opm
 
         // Stop timer and optionally print seconds taken.
         clock.stop();
+        MetricsRegistry& metrics = MetricsRegistry::current();
+        metrics.timer("transport.implicit_capillarity").add(clock.secsSinceStart());
+        metrics.histogram("transport.implicit_capillarity.root_iterations").add(iterations_used);
 #ifdef VERBOSE
         std::cout << "Seconds taken by transport solver: " << clock.secsSinceStart() << std::endl;
 #endif // VERBOSE
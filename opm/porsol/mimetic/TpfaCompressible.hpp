@@ -23,15 +23,23 @@
 
 #include <opm/porsol/mimetic/TpfaCompressibleAssembler.hpp>
 #include <opm/porsol/blackoil/BlackoilFluid.hpp>
-#include <opm/core/linalg/LinearSolverIstl.hpp>
+#include <opm/porsol/common/PersistentLinearSolverIstl.hpp>
 #include <opm/porsol/common/BoundaryConditions.hpp>
+#include <opm/porsol/common/Metrics.hpp>
+#include <opm/porsol/common/NonlinearTrace.hpp>
 
 #include <opm/common/ErrorMacros.hpp>
 #include <opm/core/utility/SparseTable.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <deque>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <utility>
 
 namespace Opm
 {
@@ -50,7 +58,8 @@ namespace Opm
         /// @brief
         ///    Default constructor. Does nothing.
         TpfaCompressible()
-            : pgrid_(0), prock_(0), pfluid_(0)
+            : pgrid_(0), prock_(0), pfluid_(0),
+              num_nonlinear_iterations_(0), rel_voldiscr_(-1.0)
         {
         }
 
@@ -80,7 +89,7 @@ namespace Opm
                 OPM_THROW(std::runtime_error, "Unhandled number of components: " << nc);
             }
             inflow_mixture_ = mix;
-            linsolver_.reset(new LinearSolverIstl(param));
+            linsolver_.reset(new PersistentLinearSolverIstl(param));
             flux_rel_tol_ = param.getDefault("flux_rel_tol", 1e-5);
             press_rel_tol_ = param.getDefault("press_rel_tol", 1e-5);
             max_num_iter_ = param.getDefault("max_num_iter", 15);
@@ -88,9 +97,42 @@ namespace Opm
             relax_time_voldiscr_ = param.getDefault("relax_time_voldiscr", 0.0);
             relax_weight_pressure_iteration_ = param.getDefault("relax_weight_pressure_iteration", 1.0);
             experimental_jacobian_ = param.getDefault("experimental_jacobian", false);
+            // Newton with the pressure derivatives of the flux
+            // coefficients, see addCoefficientDerivatives(). The
+            // Jacobian is then not symmetric, so it needs linsolver_type
+            // 2 (BiCGStab_ILU0).
+            full_jacobian_ = param.getDefault("full_jacobian", false);
+            if (full_jacobian_ && linsolver_->type() != PersistentLinearSolverIstl::BiCGStab_ILU0) {
+                OPM_THROW(std::runtime_error, "full_jacobian gives a nonsymmetric system, which CG cannot solve. "
+                          "Use linsolver_type=2 (BiCGStab_ILU0), got " << linsolver_->type() << ".");
+            }
             nonlinear_residual_tolerance_ = param.getDefault("nonlinear_residual_tolerance", 0.0);
+            // Iteration records are kept in memory (trace_capacity of
+            // them), and written to trace_file when a solve fails. With
+            // output_residual the residual vectors are also kept, and
+            // written at the end of every solve. BlackoilSimulator puts
+            // the file in its output directory, see setTraceFile().
             output_residual_ = param.getDefault("output_residual", false);
+            trace_.init(param.getDefault("trace_capacity", output_residual_ ? 256 : 0), output_residual_,
+                        param.getDefault<std::string>("trace_file", "pressure-trace.bin"));
             voldisc_factor_ = param.getDefault("voldisc_factor", 1.0);
+            // Globalization of the Newton iteration (used when
+            // nonlinear_residual_tolerance > 0).
+            line_search_ = param.getDefault("line_search", false);
+            line_search_max_cuts_ = param.getDefault("line_search_max_cuts", 5);
+            line_search_armijo_ = param.getDefault("line_search_armijo", 1e-4);
+            line_search_reduction_ = param.getDefault("line_search_reduction", 0.5);
+            if (line_search_reduction_ <= 0.0 || line_search_reduction_ >= 1.0) {
+                OPM_THROW(std::runtime_error, "line_search_reduction must be in (0, 1), got " << line_search_reduction_);
+            }
+            // Anderson acceleration of the fixed point iteration (used
+            // when nonlinear_residual_tolerance == 0).
+            anderson_depth_ = param.getDefault("anderson_depth", 0);
+            if (anderson_depth_ < 0) {
+                OPM_THROW(std::runtime_error, "anderson_depth must be nonnegative, got " << anderson_depth_);
+            }
+            anderson_max_condition_ = param.getDefault("anderson_max_condition", 1e10);
+            anderson_max_coefficient_ = param.getDefault("anderson_max_coefficient", 1e3);
         }
 
 
@@ -155,7 +197,8 @@ namespace Opm
             for (int i = 0; i < grid.numCells(); ++i) {
                 poro_[i] = rock.porosity(i);
             }
-            // Initialize 
+            // Initialize, reusing the grid, transmissibility and well
+            // structures of the previous setup() where possible.
             psolver_.init(grid, wells, perm, &poro_[0], grav);
 
             // Build bctypes_ and bcvalues_.
@@ -189,25 +232,55 @@ namespace Opm
                 }
             }
 
-            // Setup unchanging well data structures.
-            perf_wells_.clear();
-            perf_cells_.clear();
-            perf_A_.clear();
-            perf_mob_.clear();
-            perf_sat_.clear();
+            // Setup unchanging well data structures, unless the well
+            // topology is that of the previous setup().
+            std::vector<int> perf_wells;
+            std::vector<int> perf_cells;
             int num_wells = pwells_->numWells();
             for (int well = 0; well < num_wells; ++well) {
                 int num_perf = pwells_->numPerforations(well);
                 for (int perf = 0; perf < num_perf; ++perf) {
                     int cell = pwells_->wellCell(well, perf);
-                    perf_wells_.push_back(well);
-                    perf_cells_.push_back(cell);
+                    perf_wells.push_back(well);
+                    perf_cells.push_back(cell);
                 }
             }
-            int num_perf = perf_wells_.size();
-            perf_A_.resize(num_perf*numPhases*numComponents);
-            perf_mob_.resize(num_perf*numPhases);
-            perf_sat_.resize(num_perf);
+            if (perf_wells != perf_wells_ || perf_cells != perf_cells_) {
+                perf_wells_.swap(perf_wells);
+                perf_cells_.swap(perf_cells);
+                int num_perf = perf_wells_.size();
+                perf_A_.assign(num_perf*numPhases*numComponents, 0.0);
+                perf_mob_.assign(num_perf*numPhases, 0.0);
+                perf_sat_.assign(num_perf, PhaseVec(0.0));
+            }
+        }
+
+
+
+
+        /// @brief
+        ///    Update well controls and targets, for instance between
+        ///    report steps, without redoing the rest of setup().
+        ///
+        /// @param [in] wells
+        ///    Well specifications, with the same wells and
+        ///    perforations as given to setup().
+        ///
+        void updateWellControls(const WellsInterface& wells)
+        {
+            pwells_ = &wells;
+            psolver_.updateWellControls(wells);
+        }
+
+
+
+        /// @brief
+        ///    Write the iteration trace to the given file instead of
+        ///    trace_file, for instance to put it in an output directory.
+        ///
+        void setTraceFile(const std::string& filename)
+        {
+            trace_.setFilename(filename);
         }
 
 
@@ -237,6 +310,7 @@ namespace Opm
         {
             computeFluidProps(cell_pressure, face_pressure, well_perf_pressure, cell_z, dt);
             double rel_voldiscr = *std::max_element(fp_.relvoldiscr.begin(), fp_.relvoldiscr.end());
+            rel_voldiscr_ = rel_voldiscr;
             if (rel_voldiscr > max_relative_voldiscr_) {
                 std::cout << "    Relative volume discrepancy too large: " << rel_voldiscr << std::endl;
                 return false;
@@ -246,6 +320,26 @@ namespace Opm
             }
         }
 
+        /// Max relative volume discrepancy found by the last call to
+        /// volumeDiscrepancyAcceptable().
+        double relativeVolumeDiscrepancy() const
+        {
+            return rel_voldiscr_;
+        }
+
+        /// Cell saturations of the last fluid property evaluation, after
+        /// volumeDiscrepancyAcceptable() those of the end-of-step state.
+        const FieldArray<typename FluidInterface::PhaseVec>& cellSaturations() const
+        {
+            return fp_.cell_data.saturation;
+        }
+
+        /// Number of nonlinear iterations used by the last call to solve().
+        int numNonlinearIterations() const
+        {
+            return num_nonlinear_iterations_;
+        }
+
         enum ReturnCode { SolveOk, VolumeDiscrepancyTooLarge, FailedToConverge };
 
 
@@ -296,52 +390,100 @@ namespace Opm
                          std::vector<double>& well_perf_fluxes,
                          const std::vector<double>& src,
                          const double dt)
+        {
+            return solve(cell_pressure, face_pressure, cell_z,
+                         well_bhp_pressures, well_perf_pressures, well_perf_fluxes,
+                         cell_pressure, face_pressure, face_flux,
+                         well_bhp_pressures, well_perf_pressures, well_perf_fluxes,
+                         src, dt);
+        }
+
+
+
+        /// @brief
+        ///    As above, but with separate input (start of step) and
+        ///    output (end of step) variables, so that a caller can keep
+        ///    the start state intact without copying it. The output
+        ///    variables are resized as needed, and only written if
+        ///    SolveOk is returned. Input and output may be the same
+        ///    objects.
+        ReturnCode solve(const std::vector<typename FluidInterface::PhaseVec>& cell_pressure_in,
+                         const std::vector<typename FluidInterface::PhaseVec>& face_pressure_in,
+                         const std::vector<typename FluidInterface::CompVec>& cell_z,
+                         const std::vector<double>& well_bhp_pressures_in,
+                         const std::vector<double>& well_perf_pressures_in,
+                         const std::vector<double>& well_perf_fluxes_in,
+                         std::vector<typename FluidInterface::PhaseVec>& cell_pressure,
+                         std::vector<typename FluidInterface::PhaseVec>& face_pressure,
+                         std::vector<double>& face_flux,
+                         std::vector<double>& well_bhp_pressures,
+                         std::vector<double>& well_perf_pressures,
+                         std::vector<double>& well_perf_fluxes,
+                         const std::vector<double>& src,
+                         const double dt)
         {
             // Set up initial state.
             // \TODO We are currently using Liquid phase pressure,
             //       what is correct with capillary pressure?
             SolverState state;
-            int num_cells = cell_pressure.size();
-            int num_faces = face_pressure.size();
+            int num_cells = cell_pressure_in.size();
+            int num_faces = face_pressure_in.size();
             state.cell_pressure.resize(num_cells);
             for (int cell = 0; cell < num_cells; ++cell) {
-                state.cell_pressure[cell] = cell_pressure[cell][FluidInterface::Liquid];
+                state.cell_pressure[cell] = cell_pressure_in[cell][FluidInterface::Liquid];
             }
             state.face_pressure.resize(num_faces);
             for (int face = 0; face < num_faces; ++face) {
-                state.face_pressure[face] = face_pressure[face][FluidInterface::Liquid];
+                state.face_pressure[face] = face_pressure_in[face][FluidInterface::Liquid];
             }
             state.face_flux.clear();
             state.face_flux.resize(num_faces);
-            state.well_bhp_pressure = well_bhp_pressures;
-            state.well_perf_pressure = well_perf_pressures;
-            state.well_perf_flux = well_perf_fluxes;
+            state.well_bhp_pressure = well_bhp_pressures_in;
+            state.well_perf_pressure = well_perf_pressures_in;
+            state.well_perf_flux = well_perf_fluxes_in;
 
             // Run solver.
+            ScopedTimer timer("flow.pressure_solve");
             ReturnCode retcode;
-            if (nonlinear_residual_tolerance_ == 0.0) {
-                // Old version.
-                retcode = solveImpl(cell_z, src, dt, state);
-            } else {
-                // New version using residual reduction as
-                // convergence criterion.
-                retcode = solveImplNew(cell_z, src, dt, state);
+            trace_.beginSolve();
+            try {
+                if (nonlinear_residual_tolerance_ == 0.0) {
+                    // Old version.
+                    retcode = solveImpl(cell_z, src, dt, state);
+                } else {
+                    // New version using residual reduction as
+                    // convergence criterion.
+                    retcode = solveImplNew(cell_z, src, dt, state);
+                }
+            } catch (...) {
+                if (trace_.enabled()) {
+                    trace_.flush(-1);
+                }
+                throw;
+            }
+            if (trace_.enabled() && (retcode != SolveOk || trace_.capturesResiduals())) {
+                trace_.flush(retcode);
+            }
+            if (retcode != SolveOk) {
+                MetricsRegistry::current().counter("flow.failures").add();
             }
 
             // Copy results to output variables.
             if (retcode == SolveOk) {
                 // \TODO Currently all phase pressures will be equal,
                 //       what is correct with capillary pressure?
+                cell_pressure.resize(num_cells);
+                face_pressure.resize(num_faces);
                 for (int cell = 0; cell < num_cells; ++cell) {
                     cell_pressure[cell] = state.cell_pressure[cell];
                 }
                 for (int face = 0; face < num_faces; ++face) {
                     face_pressure[face] = state.face_pressure[face];
                 }
-                face_flux = state.face_flux;
-                well_bhp_pressures = state.well_bhp_pressure;
-                well_perf_pressures = state.well_perf_pressure;
-                well_perf_fluxes = state.well_perf_flux;
+                face_flux.swap(state.face_flux);
+                well_bhp_pressures.swap(state.well_bhp_pressure);
+                well_perf_pressures.swap(state.well_perf_pressure);
+                well_perf_fluxes.swap(state.well_perf_flux);
             }
             return retcode;
         }
@@ -378,7 +520,8 @@ namespace Opm
         Opm::AllFluidData fp_;
         std::vector<double> poro_;
         PressureAssembler psolver_;
-        std::unique_ptr<LinearSolverIstl> linsolver_;
+        std::unique_ptr<PersistentLinearSolverIstl> linsolver_;
+        PersistentLinearSolverIstl::LinearSolverReport linsolver_report_;
         std::vector<PressureAssembler::FlowBCTypes> bctypes_;
         std::vector<double> bcvalues_;
 
@@ -390,9 +533,18 @@ namespace Opm
         double relax_time_voldiscr_;
         double relax_weight_pressure_iteration_;
         bool experimental_jacobian_;
+        bool full_jacobian_;
         bool output_residual_;
         double nonlinear_residual_tolerance_;
         double voldisc_factor_;
+        bool line_search_;
+        int line_search_max_cuts_;
+        double line_search_armijo_;
+        double line_search_reduction_;
+        int anderson_depth_;
+        double anderson_max_condition_;
+        double anderson_max_coefficient_;
+        NonlinearTrace trace_;
 
         typedef typename FluidInterface::PhaseVec PhaseVec;
         typedef typename FluidInterface::CompVec CompVec;
@@ -409,6 +561,8 @@ namespace Opm
         // Only intended to avoid extra allocations.
         mutable std::vector<PhaseVec> helper_cell_pressure_;
         mutable std::vector<PhaseVec> helper_face_pressure_;
+        std::vector<PhaseVec> cell_dsdp_;
+        std::vector<PhaseVec> cell_drhodp_;
 
         struct SolverState
         {
@@ -420,6 +574,14 @@ namespace Opm
             std::vector<double> well_perf_flux;
         };
 
+        // Nonlinear iteration history and statistics.
+        std::deque<SolverState> anderson_x_;  // Iterates x_k.
+        std::deque<SolverState> anderson_g_;  // Fixed point maps G(x_k).
+        double last_step_length_;
+        int num_line_search_cuts_;
+        int num_nonlinear_iterations_;
+        double rel_voldiscr_;
+
 
         void computeFluidProps(const std::vector<typename FluidInterface::PhaseVec>& phase_pressure,
                                const std::vector<typename FluidInterface::PhaseVec>& phase_pressure_face,
@@ -427,6 +589,7 @@ namespace Opm
                                const std::vector<typename FluidInterface::CompVec>& cell_z,
                                const double dt)
         {
+            ScopedTimer timer("fluid.properties.flow");
             fp_.computeNew(*pgrid_, *prock_, *pfluid_, gravity_, phase_pressure, phase_pressure_face, cell_z, inflow_mixture_, dt);
             // Properties at well perforations.
             // \TODO only need to recompute this once per pressure update.
@@ -547,6 +710,175 @@ namespace Opm
                     }
                 }
             }
+            if (full_jacobian_) {
+                addCoefficientDerivatives(cell_pressure_scalar, linsys);
+            }
+        }
+
+
+
+        // Phase volumes of the component volumes m, that is A^{-1} m,
+        // with the block structure of A used in BlackoilFluid.
+        static PhaseVec phaseVolumes(const PhaseVec& B, const PhaseVec& R, const CompVec& m)
+        {
+            const double detR = 1.0 - R[FluidInterface::Vapour]*R[FluidInterface::Liquid];
+            PhaseVec u;
+            u[FluidInterface::Aqua] = B[FluidInterface::Aqua]*m[FluidInterface::Water];
+            u[FluidInterface::Vapour] = B[FluidInterface::Vapour]
+                *(m[FluidInterface::Gas] - R[FluidInterface::Liquid]*m[FluidInterface::Oil])/detR;
+            u[FluidInterface::Liquid] = B[FluidInterface::Liquid]
+                *(m[FluidInterface::Oil] - R[FluidInterface::Vapour]*m[FluidInterface::Gas])/detR;
+            return u;
+        }
+
+
+
+        // Add to entry (row, col) of the system matrix, which must be
+        // in its sparsity pattern.
+        static void addToEntry(PressureAssembler::LinearSystem& linsys,
+                               const int row, const int col, const double value)
+        {
+            for (int i = linsys.ia[row]; i < linsys.ia[row + 1]; ++i) {
+                if (linsys.ja[i] == col) {
+                    linsys.sa[i] += value;
+                    return;
+                }
+            }
+            OPM_THROW(std::logic_error, "Entry (" << row << ", " << col << ") not in the pressure system.");
+        }
+
+
+
+        // The cfs_tpfa matrix is the Jacobian of the volume discrepancy
+        // residual with the flux coefficients frozen. The outflow of
+        // cell k through face f is
+        //     sigma_k e^T A_k^{-1} A_f v_f,   v_f = T_f lambda_f (p_0 - p_1 + gravcap_f),
+        // where sigma_k is 1 if k is the first cell of f, -1 otherwise.
+        // This adds the pressure derivatives of the coefficients:
+        // e^T A_k^{-1} (its derivative is -c_k^T A_k^{-1}, with c_k the
+        // phase compressibilities), the upwind mobilities (through the
+        // saturation derivatives) and the phase densities of the
+        // gravity term. The face A_f, evaluated at face pressures, the
+        // pressure dependence of viscosities and the well perforation
+        // terms are still linearized with frozen coefficients.
+        void addCoefficientDerivatives(const std::vector<double>& cell_pressure,
+                                       PressureAssembler::LinearSystem& linsys)
+        {
+            const AllFluidStates& cd = fp_.cell_data;
+            const FaceFluidData& fd = fp_.face_data;
+            const std::vector<double>& trans = psolver_.faceTransmissibilities();
+            const std::vector<int>& face_cells = fp_.faceCells();
+            const std::vector<double>& gravity_dz = fp_.faceGravityDz();
+            const CompVec rho_s = pfluid_->surfaceDensities();
+            const int num_cells = pgrid_->numCells();
+
+            // Pressure derivatives of cell saturations and phase
+            // densities. With u = A^{-1} z, du/dp = -A^{-1} (dA/dp) u.
+            cell_dsdp_.resize(num_cells);
+            cell_drhodp_.resize(num_cells);
+#pragma omp parallel for schedule(static)
+            for (int cell = 0; cell < num_cells; ++cell) {
+                const PhaseVec& B = cd.formation_volume_factor[cell];
+                const PhaseVec& dB = cd.formation_volume_factor_deriv[cell];
+                const PhaseVec& R = cd.solution_factor[cell];
+                const PhaseVec& dR = cd.solution_factor_deriv[cell];
+                const PhaseVec& u = cd.phase_volume_density[cell];
+                const PhaseVec& s = cd.saturation[cell];
+                // dA/dp, transposed as the state matrix.
+                typename FluidInterface::PhaseToCompMatrix dAt(0.0);
+                dAt[FluidInterface::Aqua][FluidInterface::Water] = -dB[FluidInterface::Aqua]/(B[FluidInterface::Aqua]*B[FluidInterface::Aqua]);
+                dAt[FluidInterface::Vapour][FluidInterface::Gas] = -dB[FluidInterface::Vapour]/(B[FluidInterface::Vapour]*B[FluidInterface::Vapour]);
+                dAt[FluidInterface::Liquid][FluidInterface::Oil] = -dB[FluidInterface::Liquid]/(B[FluidInterface::Liquid]*B[FluidInterface::Liquid]);
+                dAt[FluidInterface::Liquid][FluidInterface::Gas] = dAt[FluidInterface::Liquid][FluidInterface::Oil]*R[FluidInterface::Liquid]
+                    + dR[FluidInterface::Liquid]/B[FluidInterface::Liquid];
+                dAt[FluidInterface::Vapour][FluidInterface::Oil] = dAt[FluidInterface::Vapour][FluidInterface::Gas]*R[FluidInterface::Vapour]
+                    + dR[FluidInterface::Vapour]/B[FluidInterface::Vapour];
+                CompVec dAu(0.0);
+                for (int phase = 0; phase < numPhases; ++phase) {
+                    for (int comp = 0; comp < numComponents; ++comp) {
+                        dAu[comp] += dAt[phase][comp]*u[phase];
+                    }
+                }
+                PhaseVec du = phaseVolumes(B, R, dAu);
+                du *= -1.0;
+                double dtot = 0.0;
+                for (int phase = 0; phase < numPhases; ++phase) {
+                    dtot += du[phase];
+                }
+                const double tot = cd.total_phase_volume_density[cell];
+                for (int phase = 0; phase < numPhases; ++phase) {
+                    cell_dsdp_[cell][phase] = (du[phase] - s[phase]*dtot)/tot;
+                    cell_drhodp_[cell][phase] = 0.0;
+                    for (int comp = 0; comp < numComponents; ++comp) {
+                        cell_drhodp_[cell][phase] += dAt[phase][comp]*rho_s[comp];
+                    }
+                }
+            }
+
+            // Face contributions, to the rows of both cells.
+            const int num_faces = pgrid_->numFaces();
+            for (int face = 0; face < num_faces; ++face) {
+                const int* c = &face_cells[2*face];
+                double p[2];
+                bool flow = true;
+                for (int j = 0; j < 2; ++j) {
+                    if (c[j] >= 0) {
+                        p[j] = cell_pressure[c[j]];
+                    } else if (bctypes_[face] == PressureAssembler::FBC_PRESSURE) {
+                        p[j] = bcvalues_[face];
+                    } else {
+                        flow = false;
+                    }
+                }
+                if (!flow) {
+                    continue;
+                }
+                const typename FluidInterface::PhaseToCompMatrix& Aft = fd.state_matrix[face];
+                const PhaseVec& lambda = fd.mobility[face];
+                PhaseVec dpot;
+                CompVec compflux(0.0);
+                for (int phase = 0; phase < numPhases; ++phase) {
+                    dpot[phase] = p[0] + fd.gravity_potential[face][phase] - p[1];
+                    for (int comp = 0; comp < numComponents; ++comp) {
+                        compflux[comp] += Aft[phase][comp]*trans[face]*lambda[phase]*dpot[phase];
+                    }
+                }
+                for (int j = 0; j < 2; ++j) {
+                    const int k = c[j];
+                    if (k < 0) {
+                        continue;
+                    }
+                    const double sigma = j == 0 ? 1.0 : -1.0;
+                    const PhaseVec& B = cd.formation_volume_factor[k];
+                    const PhaseVec& R = cd.solution_factor[k];
+                    // Derivative of e^T A_k^{-1}.
+                    addToEntry(linsys, k, k, -sigma*(cd.phase_compressibility[k]*phaseVolumes(B, R, compflux)));
+                    for (int phase = 0; phase < numPhases; ++phase) {
+                        CompVec phase_comp;
+                        for (int comp = 0; comp < numComponents; ++comp) {
+                            phase_comp[comp] = Aft[phase][comp];
+                        }
+                        const PhaseVec w = phaseVolumes(B, R, phase_comp);
+                        const double coef = sigma*(w[0] + w[1] + w[2])*trans[face];
+                        // Upwind mobility, unless the potentials are
+                        // equal (averaged) or the upwind side is outside.
+                        if (dpot[phase] != 0.0) {
+                            const int up = c[dpot[phase] > 0.0 ? 0 : 1];
+                            if (up >= 0) {
+                                const double dlambda = cd.mobility_deriv[up][phase]*cell_dsdp_[up];
+                                addToEntry(linsys, k, up, coef*dpot[phase]*dlambda);
+                            }
+                        }
+                        // Phase densities in the gravity term.
+                        for (int jj = 0; jj < 2; ++jj) {
+                            if (c[jj] >= 0 && gravity_dz[2*face + jj] != 0.0) {
+                                const double dgrav = (jj == 0 ? 1.0 : -1.0)*cell_drhodp_[c[jj]][phase]*gravity_dz[2*face + jj];
+                                addToEntry(linsys, k, c[jj], coef*lambda[phase]*dgrav);
+                            }
+                        }
+                    }
+                }
+            }
         }
 
 
@@ -701,6 +1033,277 @@ namespace Opm
 
 
 
+        // Solve s with the given right hand side into s.x, setting
+        // linsolver_report_ and adding the solve to the metrics.
+        void solveLinearSystem(const PressureAssembler::LinearSystem& s, const double* rhs)
+        {
+            linsolver_report_ = linsolver_->solve(s.n, s.nnz, s.ia, s.ja, s.sa, rhs, s.x);
+            MetricsRegistry& metrics = MetricsRegistry::current();
+            metrics.histogram("flow.linear_iterations").add(linsolver_report_.iterations);
+            metrics.timer("flow.linear_setup").add(linsolver_report_.setup_time);
+            metrics.timer("flow.linear_solve").add(linsolver_report_.solve_time);
+            if (linsolver_report_.rebuilt) {
+                metrics.counter("flow.amg_rebuilds").add();
+            }
+        }
+
+
+
+        // Appends linear iterations and the setup vs. solve timing of
+        // the last linear solve to the current iteration output line.
+        // A '*' marks iterations where the AMG hierarchy was rebuilt.
+        void printLinearSolverReport() const
+        {
+            const PersistentLinearSolverIstl::LinearSolverReport& r = linsolver_report_;
+            std::cout << std::setw(10) << r.iterations << (r.rebuilt ? '*' : ' ')
+                      << std::setw(12) << r.setup_time
+                      << std::setw(13) << r.solve_time;
+        }
+
+
+
+        // Max relative volume discrepancy of the last fluid property
+        // evaluation, only computed when tracing.
+        double traceVolumeDiscrepancy() const
+        {
+            if (!trace_.enabled() || fp_.relvoldiscr.empty()) {
+                return -1.0;
+            }
+            return *std::max_element(fp_.relvoldiscr.begin(), fp_.relvoldiscr.end());
+        }
+
+
+
+        // Add a record of nonlinear iteration iter to the trace.
+        void traceIteration(const int iter, const double residual,
+                            const std::pair<double, double>& rel_changes,
+                            const double max_rel_voldiscr, const double step_length)
+        {
+            if (!trace_.enabled()) {
+                return;
+            }
+            NonlinearTrace::Record rec;
+            rec.iteration = iter;
+            rec.linear_iterations = linsolver_report_.iterations;
+            rec.residual = residual;
+            rec.flux_change = rel_changes.first;
+            rec.pressure_change = rel_changes.second;
+            rec.max_rel_voldiscr = max_rel_voldiscr;
+            rec.linear_setup_time = linsolver_report_.setup_time;
+            rec.linear_solve_time = linsolver_report_.solve_time;
+            rec.step_length = step_length;
+            trace_.record(rec);
+        }
+
+
+
+        // y <- y + a*x, for all state variables.
+        static void addScaledState(const double a, const SolverState& x, SolverState& y)
+        {
+            addScaled(a, x.cell_pressure, y.cell_pressure);
+            addScaled(a, x.face_pressure, y.face_pressure);
+            addScaled(a, x.face_flux, y.face_flux);
+            addScaled(a, x.well_bhp_pressure, y.well_bhp_pressure);
+            addScaled(a, x.well_perf_pressure, y.well_perf_pressure);
+            addScaled(a, x.well_perf_flux, y.well_perf_flux);
+        }
+
+        static void addScaled(const double a, const std::vector<double>& x, std::vector<double>& y)
+        {
+            assert(x.size() == y.size());
+            for (int i = 0; i < int(x.size()); ++i) {
+                y[i] += a*x[i];
+            }
+        }
+
+        // out <- a + w*(b - a), for all state variables.
+        static void interpolateState(const double w, const SolverState& a, const SolverState& b,
+                                     SolverState& out)
+        {
+            out = a;
+            addScaledState(-w, a, out);
+            addScaledState(w, b, out);
+        }
+
+        static double maxNorm(const std::vector<double>& v)
+        {
+            double m = 0.0;
+            for (int i = 0; i < int(v.size()); ++i) {
+                m = std::max(m, std::fabs(v[i]));
+            }
+            return m;
+        }
+
+
+
+        // Anderson acceleration of the fixed point iteration x <- G(x)
+        // in solveImpl(). On input, g = G(x), on output g is the mixed
+        // iterate. The mixing coefficients are found by least squares
+        // on the cell pressure part of the fixed point residual
+        // G(x) - x, and then applied to all state variables (like
+        // relaxState() does). The relaxation weight is used as the
+        // mixing parameter. The least squares problem is solved by QR.
+        // While its condition estimate exceeds anderson_max_condition_
+        // or a coefficient exceeds anderson_max_coefficient_, the
+        // oldest history entry is dropped; with no history left, this
+        // is the plain (relaxed) update.
+        void andersonMix(const SolverState& x, SolverState& g)
+        {
+            anderson_x_.push_back(x);
+            anderson_g_.push_back(g);
+            if (int(anderson_x_.size()) > anderson_depth_ + 1) {
+                anderson_x_.pop_front();
+                anderson_g_.pop_front();
+            }
+            int m = anderson_x_.size() - 1;
+            const double beta = relax_weight_pressure_iteration_;
+            if (m == 0) {
+                if (beta != 1.0) {
+                    relaxState(beta, x, g);
+                }
+                return;
+            }
+
+            // Residuals f_i = G(x_i) - x_i and their differences.
+            const int num_cells = x.cell_pressure.size();
+            std::vector<std::vector<double> > f(m + 1, std::vector<double>(num_cells));
+            for (int i = 0; i <= m; ++i) {
+                for (int cell = 0; cell < num_cells; ++cell) {
+                    f[i][cell] = anderson_g_[i].cell_pressure[cell] - anderson_x_[i].cell_pressure[cell];
+                }
+            }
+            // min |f_m - sum_j gamma_j (f_{j+1} - f_j)|, by modified
+            // Gram-Schmidt QR of the differences (r is upper triangular,
+            // row major).
+            std::vector<std::vector<double> > q;
+            std::vector<double> r;
+            std::vector<double> gamma;
+            while (m > 0) {
+                q.assign(m, std::vector<double>(num_cells));
+                r.assign(m*m, 0.0);
+                double rmin = 1e100;
+                double rmax = 0.0;
+                for (int j = 0; j < m; ++j) {
+                    for (int cell = 0; cell < num_cells; ++cell) {
+                        q[j][cell] = f[j + 1][cell] - f[j][cell];
+                    }
+                    for (int k = 0; k < j; ++k) {
+                        double dot = 0.0;
+                        for (int cell = 0; cell < num_cells; ++cell) {
+                            dot += q[k][cell]*q[j][cell];
+                        }
+                        r[k*m + j] = dot;
+                        for (int cell = 0; cell < num_cells; ++cell) {
+                            q[j][cell] -= dot*q[k][cell];
+                        }
+                    }
+                    double norm = 0.0;
+                    for (int cell = 0; cell < num_cells; ++cell) {
+                        norm += q[j][cell]*q[j][cell];
+                    }
+                    norm = std::sqrt(norm);
+                    r[j*m + j] = norm;
+                    if (norm > 0.0) {
+                        for (int cell = 0; cell < num_cells; ++cell) {
+                            q[j][cell] /= norm;
+                        }
+                    }
+                    rmin = std::min(rmin, norm);
+                    rmax = std::max(rmax, norm);
+                }
+                // The ratio of the largest to the smallest diagonal
+                // entry of r is a lower bound for the condition number.
+                bool ok = rmin > 0.0 && rmax <= anderson_max_condition_*rmin;
+                if (ok) {
+                    // gamma = r^-1 q^T f_m.
+                    gamma.assign(m, 0.0);
+                    for (int j = m - 1; j >= 0; --j) {
+                        double sum = 0.0;
+                        for (int cell = 0; cell < num_cells; ++cell) {
+                            sum += q[j][cell]*f[m][cell];
+                        }
+                        for (int k = j + 1; k < m; ++k) {
+                            sum -= r[j*m + k]*gamma[k];
+                        }
+                        gamma[j] = sum/r[j*m + j];
+                        ok = ok && std::fabs(gamma[j]) <= anderson_max_coefficient_;
+                    }
+                }
+                if (ok) {
+                    break;
+                }
+                // Drop the oldest entry and try again.
+                anderson_x_.pop_front();
+                anderson_g_.pop_front();
+                f.erase(f.begin());
+                --m;
+            }
+            if (m == 0) {
+                if (beta != 1.0) {
+                    relaxState(beta, x, g);
+                }
+                return;
+            }
+
+            // x_bar = x_m - sum_j gamma_j (x_{j+1} - x_j), same for g_bar.
+            SolverState x_bar = x;
+            SolverState g_bar = g;
+            for (int j = 0; j < m; ++j) {
+                addScaledState(-gamma[j], anderson_x_[j + 1], x_bar);
+                addScaledState(gamma[j], anderson_x_[j], x_bar);
+                addScaledState(-gamma[j], anderson_g_[j + 1], g_bar);
+                addScaledState(gamma[j], anderson_g_[j], g_bar);
+            }
+            interpolateState(beta, x_bar, g_bar, g);
+        }
+
+
+
+        // Backtracking line search along the Newton direction from
+        // start_state to newton_state, on the max norm of the volume
+        // discrepancy residual of computeResidualJacobian(). Starts
+        // with twice the previously accepted step length (capped at a
+        // full step), so that damping adapts from step to step. On
+        // return, state, linsys and residual belong to the accepted
+        // step, and the step length is returned.
+        double lineSearch(const std::vector<typename FluidInterface::CompVec>& cell_z,
+                          const std::vector<double>& src,
+                          const double dt,
+                          const std::vector<double>& voldiscr_initial,
+                          const std::vector<double>& cell_pressure_initial,
+                          const SolverState& start_state,
+                          const SolverState& newton_state,
+                          const double start_residual,
+                          SolverState& state,
+                          PressureAssembler::LinearSystem& linsys,
+                          std::vector<double>& residual)
+        {
+            double alpha = std::min(1.0, 2.0*last_step_length_);
+            for (int cut = 0; ; ++cut) {
+                if (alpha == 1.0) {
+                    state = newton_state;
+                } else {
+                    interpolateState(alpha, start_state, newton_state, state);
+                    computeWellPerfPressures(state.well_perf_flux, state.well_bhp_pressure,
+                                             perf_gpot_, state.well_perf_pressure);
+                }
+                computeFluidPropsScalarPress(state.cell_pressure, state.face_pressure, state.well_perf_pressure, cell_z, dt);
+                computeResidualJacobian(voldiscr_initial, state.cell_pressure, cell_pressure_initial,
+                                        state.well_bhp_pressure, src, dt, linsys, residual);
+                const double trial_residual = maxNorm(residual);
+                if (trial_residual <= (1.0 - line_search_armijo_*alpha)*start_residual
+                    || cut == line_search_max_cuts_) {
+                    break;
+                }
+                alpha *= line_search_reduction_;
+                ++num_line_search_cuts_;
+            }
+            last_step_length_ = alpha;
+            return alpha;
+        }
+
+
+
         // Implements the main nonlinear loop of the pressure solver.
         ReturnCode solveImpl(const std::vector<typename FluidInterface::CompVec>& cell_z,
                              const std::vector<double>& src,
@@ -711,10 +1314,13 @@ namespace Opm
             std::vector<double> cell_pressure_initial = state.cell_pressure;
             std::vector<double> voldiscr_initial;
             SolverState start_state;
+            anderson_x_.clear();
+            anderson_g_.clear();
 
             // ------------  Main iteration loop -------------
             for (int iter = 0; iter < max_num_iter_; ++iter) {
                 start_state = state;
+                num_nonlinear_iterations_ = iter + 1;
                 // (Re-)compute fluid properties.
                 computeFluidPropsScalarPress(state.cell_pressure, state.face_pressure, state.well_perf_pressure, cell_z, dt);
 
@@ -731,28 +1337,21 @@ namespace Opm
                     computeWellPotentials(perf_gpot_);
                 }
 
-                if (experimental_jacobian_) {
+                const double max_rel_voldiscr = traceVolumeDiscrepancy();
+                double trace_residual = -1.0;
+                if (experimental_jacobian_ || full_jacobian_) {
                     // Compute residual and jacobian.
                     PressureAssembler::LinearSystem s;
                     std::vector<double> residual;
                     computeResidualJacobian(voldiscr_initial, state.cell_pressure, cell_pressure_initial,
                                             state.well_bhp_pressure, src, dt, s, residual);
 
-                    if (output_residual_) {
-                        // Temporary hack to get output of residual.
-                        static int psolve_iter = -1;
-                        if (iter == 0) {
-                            ++psolve_iter;
-                        }
-                        std::ostringstream oss;
-                        oss << "residual-" << psolve_iter << '-' << iter << ".dat";
-                        std::ofstream outres(oss.str().c_str());
-                        std::copy(residual.begin(), residual.end(), std::ostream_iterator<double>(outres, "\n"));
-                    }
+                    trace_.residual(iter, residual);
+                    trace_residual = maxNorm(residual);
 
                     // Solve system for dp, that is, we use residual as the rhs.
-                    LinearSolverIstl::LinearSolverReport result
-                        = linsolver_->solve(s.n, s.nnz, s.ia, s.ja, s.sa, &residual[0], s.x);
+                    solveLinearSystem(s, &residual[0]);
+                    const PersistentLinearSolverIstl::LinearSolverReport& result = linsolver_report_;
                     if (!result.converged) {
                         OPM_THROW(std::runtime_error, "Linear solver failed to converge in " << result.iterations << " iterations.\n"
                               << "Residual reduction achieved is " << result.residual_reduction << '\n');
@@ -785,7 +1384,8 @@ namespace Opm
                     PressureAssembler::LinearSystem s;
                     psolver_.linearSystem(s);
                     // Solve system.
-                    LinearSolverIstl::LinearSolverReport res = linsolver_->solve(s.n, s.nnz, s.ia, s.ja, s.sa, s.b, s.x);
+                    solveLinearSystem(s, s.b);
+                    const PersistentLinearSolverIstl::LinearSolverReport& res = linsolver_report_;
                     if (!res.converged) {
                         OPM_THROW(std::runtime_error, "Linear solver failed to converge in " << res.iterations << " iterations.\n"
                               << "Residual reduction achieved is " << res.residual_reduction << '\n');
@@ -796,8 +1396,10 @@ namespace Opm
                 psolver_.computePressuresAndFluxes(state.cell_pressure, state.face_pressure, state.face_flux,
                                                    state.well_bhp_pressure, state.well_perf_flux);
 
-                // Relaxation
-                if (relax_weight_pressure_iteration_ != 1.0) {
+                // Relaxation, or Anderson mixing with the previous iterates.
+                if (anderson_depth_ > 0) {
+                    andersonMix(start_state, state);
+                } else if (relax_weight_pressure_iteration_ != 1.0) {
                     relaxState(relax_weight_pressure_iteration_, start_state, state);
                 }
 
@@ -814,13 +1416,17 @@ namespace Opm
 
                 // Test for convergence.
                 if (iter == 0) {
-                    std::cout << "Iteration      Rel. flux change     Rel. pressure change\n";
+                    std::cout << "Iteration      Rel. flux change     Rel. pressure change"
+                              << "   Lin. its   Setup time   Solve time\n";
                 }
                 std::cout.precision(5);
                 std::cout << std::setw(6) << iter
                           << std::setw(24) << flux_rel_difference
-                          << std::setw(24) << press_rel_difference << std::endl;
+                          << std::setw(24) << press_rel_difference;
+                printLinearSolverReport();
+                std::cout << std::endl;
                 std::cout.precision(16);
+                traceIteration(iter, trace_residual, rel_changes, max_rel_voldiscr, 1.0);
 
                 if (flux_rel_difference < flux_rel_tol_ || press_rel_difference < press_rel_tol_) {
                     std::cout << "Pressure solver converged. Number of iterations: " << iter + 1 << '\n' << std::endl;
@@ -845,12 +1451,23 @@ namespace Opm
             std::vector<double> cell_pressure_initial = state.cell_pressure;
             std::vector<double> voldiscr_initial;
             SolverState start_state;
+            SolverState newton_state;
+            PressureAssembler::LinearSystem s;
+            std::vector<double> residual;
+            // True if the line search left fluid properties, system and
+            // residual evaluated at the current state.
+            bool have_residual = false;
+            last_step_length_ = 0.5;
+            num_line_search_cuts_ = 0;
 
             // ------------  Main iteration loop -------------
             for (int iter = 0; iter < max_num_iter_; ++iter) {
                 start_state = state;
+                num_nonlinear_iterations_ = iter + 1;
                 // (Re-)compute fluid properties.
-                computeFluidPropsScalarPress(state.cell_pressure, state.face_pressure, state.well_perf_pressure, cell_z, dt);
+                if (!have_residual) {
+                    computeFluidPropsScalarPress(state.cell_pressure, state.face_pressure, state.well_perf_pressure, cell_z, dt);
+                }
 
                 // Initialization for the first iteration only.
                 if (iter == 0) {
@@ -866,29 +1483,20 @@ namespace Opm
                 }
 
                 // Compute residual and jacobian.
-                PressureAssembler::LinearSystem s;
-                std::vector<double> residual;
-                computeResidualJacobian(voldiscr_initial, state.cell_pressure, cell_pressure_initial,
-                                        state.well_bhp_pressure, src, dt, s, residual);
-                if (output_residual_) {
-                    // Temporary hack to get output of residual.
-                    static int psolve_iter = -1;
-                    if (iter == 0) {
-                        ++psolve_iter;
-                    }
-                    std::ostringstream oss;
-                    oss << "residual-" << psolve_iter << '-' << iter << ".dat";
-                    std::ofstream outres(oss.str().c_str());
-                    std::copy(residual.begin(), residual.end(), std::ostream_iterator<double>(outres, "\n"));
+                if (!have_residual) {
+                    computeResidualJacobian(voldiscr_initial, state.cell_pressure, cell_pressure_initial,
+                                            state.well_bhp_pressure, src, dt, s, residual);
                 }
+                have_residual = false;
+                trace_.residual(iter, residual);
 
                 // Find the maxnorm of the residual.
-                double maxres = std::max(std::fabs(*std::max_element(residual.begin(), residual.end())),
-                                         std::fabs(*std::min_element(residual.begin(), residual.end())));
+                double maxres = maxNorm(residual);
+                const double max_rel_voldiscr = traceVolumeDiscrepancy();
 
                 // Solve system for dp, that is, we use residual as the rhs.
-                LinearSolverIstl::LinearSolverReport result
-                    = linsolver_->solve(s.n, s.nnz, s.ia, s.ja, s.sa, &residual[0], s.x);
+                solveLinearSystem(s, &residual[0]);
+                const PersistentLinearSolverIstl::LinearSolverReport& result = linsolver_report_;
                 if (!result.converged) {
                     OPM_THROW(std::runtime_error, "Linear solver failed to converge in " << result.iterations << " iterations.\n"
                           << "Residual reduction achieved is " << result.residual_reduction << '\n');
@@ -907,23 +1515,36 @@ namespace Opm
                 psolver_.computePressuresAndFluxes(state.cell_pressure, state.face_pressure, state.face_flux,
                                                    state.well_bhp_pressure, state.well_perf_flux);
 
-                // Relaxation
-                if (relax_weight_pressure_iteration_ != 1.0) {
-                    double ww = relax_weight_pressure_iteration_;
-                    for (int cell = 0; cell < num_cells; ++cell) {
-                        state.cell_pressure[cell] = ww*state.cell_pressure[cell] + (1.0-ww)*start_state.cell_pressure[cell];
-                    }
-                    if (iter > 0) {
-                        for (int face = 0; face < num_faces; ++face) {
-                            state.face_pressure[face] = ww*state.face_pressure[face] + (1.0-ww)*start_state.face_pressure[face];
-                            state.face_flux[face] = ww*state.face_flux[face] + (1.0-ww)*start_state.face_flux[face];
+                double step_length = 1.0;
+                if (line_search_) {
+                    // Compute well_perf_pressure of the full step, then
+                    // backtrack. This also evaluates the residual of the
+                    // next iteration.
+                    computeWellPerfPressures(state.well_perf_flux, state.well_bhp_pressure,
+                                             perf_gpot_, state.well_perf_pressure);
+                    newton_state = state;
+                    step_length = lineSearch(cell_z, src, dt, voldiscr_initial, cell_pressure_initial,
+                                             start_state, newton_state, maxres, state, s, residual);
+                    have_residual = true;
+                } else {
+                    // Relaxation
+                    if (relax_weight_pressure_iteration_ != 1.0) {
+                        double ww = relax_weight_pressure_iteration_;
+                        for (int cell = 0; cell < num_cells; ++cell) {
+                            state.cell_pressure[cell] = ww*state.cell_pressure[cell] + (1.0-ww)*start_state.cell_pressure[cell];
+                        }
+                        if (iter > 0) {
+                            for (int face = 0; face < num_faces; ++face) {
+                                state.face_pressure[face] = ww*state.face_pressure[face] + (1.0-ww)*start_state.face_pressure[face];
+                                state.face_flux[face] = ww*state.face_flux[face] + (1.0-ww)*start_state.face_flux[face];
+                            }
                         }
                     }
-                }
 
-                // Compute state.well_perf_pressure.
-                computeWellPerfPressures(state.well_perf_flux, state.well_bhp_pressure,
-                                         perf_gpot_, state.well_perf_pressure);
+                    // Compute state.well_perf_pressure.
+                    computeWellPerfPressures(state.well_perf_flux, state.well_bhp_pressure,
+                                             perf_gpot_, state.well_perf_pressure);
+                }
 
                 // Compute relative changes for pressure and flux.
                 std::pair<double, double> rel_changes
@@ -934,17 +1555,32 @@ namespace Opm
 
                 // Test for convergence.
                 if (iter == 0) {
-                    std::cout << "Iteration      Rel. flux change     Rel. pressure change             Residual\n";
+                    std::cout << "Iteration      Rel. flux change     Rel. pressure change             Residual"
+                              << "   Lin. its   Setup time   Solve time";
+                    if (line_search_) {
+                        std::cout << "   Step length";
+                    }
+                    std::cout << '\n';
                 }
                 std::cout.precision(5);
                 std::cout << std::setw(6) << iter
                           << std::setw(24) << flux_rel_difference
                           << std::setw(24) << press_rel_difference
-                          << std::setw(24) << maxres << std::endl;
+                          << std::setw(24) << maxres;
+                printLinearSolverReport();
+                if (line_search_) {
+                    std::cout << std::setw(14) << step_length;
+                }
+                std::cout << std::endl;
                 std::cout.precision(16);
+                traceIteration(iter, maxres, rel_changes, max_rel_voldiscr, step_length);
 
                 if (maxres < nonlinear_residual_tolerance_) {
-                    std::cout << "Pressure solver converged. Number of iterations: " << iter + 1 << '\n' << std::endl;
+                    std::cout << "Pressure solver converged. Number of iterations: " << iter + 1;
+                    if (line_search_) {
+                        std::cout << " (line search cuts: " << num_line_search_cuts_ << ')';
+                    }
+                    std::cout << '\n' << std::endl;
                     return SolveOk;
                 }
             }
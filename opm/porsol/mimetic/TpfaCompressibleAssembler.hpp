@@ -28,7 +28,9 @@
 #include <opm/core/pressure/legacy_well.h>
 #include <opm/core/pressure/tpfa/compr_quant.h>
 #include <dune/grid/common/GridAdapter.hpp>
+#include <algorithm>
 #include <stdexcept>
+#include <vector>
 
 
 
@@ -41,7 +43,7 @@ public:
     /// @brief
     ///     Default constructor, does nothing.
     TpfaCompressibleAssembler()
-        :  state_(Uninitialized), data_(0), bc_(0)
+        :  state_(Uninitialized), data_(0), cached_grid_(0), bc_(0), wells_changed_(false)
     {
         wells_.number_of_wells = 0;
     }
@@ -61,7 +63,11 @@ public:
 
 
     /// @brief
-    ///     Initialize the solver's structures for a given grid, for well setup also call initWells().
+    ///     Initialize the solver's structures for a given grid and wells.
+    ///     May be called again, for instance when rerunning a schedule:
+    ///     only the parts whose input changed are recomputed, see the
+    ///     other init() overload. If only well controls change, call
+    ///     updateWellControls() instead.
     /// @tparam Grid This must conform to the SimpleGrid concept.
     /// @tparam Wells This must conform to the SimpleWells concept.
     /// @param grid The grid object.
@@ -78,7 +84,12 @@ public:
     }
 
     /// @brief
-    ///     Initialize the solver's structures for a given grid, for well setup also call initWells().
+    ///     Initialize the solver's structures for a given grid.
+    ///     The grid structures and cfs_tpfa data are kept from the
+    ///     previous call if the grid object and well topology are the
+    ///     same, transmissibilities if also the permeabilities are
+    ///     equal, and pore volumes if also the porosities are equal.
+    ///     A grid that is modified in place is not detected.
     /// @tparam Grid This must conform to the SimpleGrid concept.
     /// @param grid The grid object.
     /// @param perm Permeability. It should contain dim*dim entries (a full tensor) for each cell.
@@ -86,39 +97,57 @@ public:
     template <class Grid>
     void init(const Grid& grid, const double* perm, const double* porosity, const typename Grid::Vector& gravity)
     {
-        // Build C grid structure.
-        grid_.init(grid);
-
-        // Initialize data.
-        int num_phases = 3;
-        well_t* w = 0;
-        if (wells_.number_of_wells != 0) {
-            w = &wells_;
-        }
-        data_ = cfs_tpfa_construct(grid_.c_grid(), w, num_phases);
-        if (!data_) {
-            throw std::runtime_error("Failed to initialize cfs_tpfa solver.");
+        const int num_cells = grid.numCells();
+        const bool same_grid = state_ != Uninitialized && &grid == cached_grid_
+            && num_cells == grid_.c_grid()->number_of_cells
+            && grid.numFaces() == int(grid_.numFaces());
+        if (!same_grid) {
+            // Build C grid structure.
+            grid_.init(grid);
+            cached_grid_ = &grid;
+            ncf_.resize(num_cells);
+            cell_volume_.resize(num_cells);
+            for (int cell = 0; cell < num_cells; ++cell) {
+                ncf_[cell] = grid.numCellFaces(cell);
+                cell_volume_[cell] = grid.cellVolume(cell);
+            }
         }
 
-        // Compute half-transmissibilities
-        int num_cells = grid.numCells();
-        int ngconn  = grid_.c_grid()->cell_facepos[num_cells];
-        ncf_.resize(num_cells);
-        for (int cell = 0; cell < num_cells; ++cell) {
-            int num_local_faces = grid.numCellFaces(cell);
-            ncf_[cell] = num_local_faces;
+        // Initialize data, which depends on the well topology.
+        if (!same_grid || wells_changed_ || data_ == 0) {
+            cfs_tpfa_destroy(data_);
+            int num_phases = 3;
+            well_t* w = 0;
+            if (wells_.number_of_wells != 0) {
+                w = &wells_;
+            }
+            data_ = cfs_tpfa_construct(grid_.c_grid(), w, num_phases);
+            if (!data_) {
+                throw std::runtime_error("Failed to initialize cfs_tpfa solver.");
+            }
+            wells_changed_ = false;
         }
-        htrans_.resize(ngconn);
-        tpfa_htrans_compute(grid_.c_grid(), perm, &htrans_[0]);
 
-        // Compute transmissibilities.
-        trans_.resize(grid_.numFaces());
-        tpfa_trans_compute(grid_.c_grid(), &htrans_[0], &trans_[0]);
+        const int perm_size = Grid::dimension*Grid::dimension*num_cells;
+        if (!same_grid || !std::equal(perm, perm + perm_size, perm_.begin())) {
+            perm_.assign(perm, perm + perm_size);
+            // Compute half-transmissibilities
+            int ngconn  = grid_.c_grid()->cell_facepos[num_cells];
+            htrans_.resize(ngconn);
+            tpfa_htrans_compute(grid_.c_grid(), perm, &htrans_[0]);
+
+            // Compute transmissibilities.
+            trans_.resize(grid_.numFaces());
+            tpfa_trans_compute(grid_.c_grid(), &htrans_[0], &trans_[0]);
+        }
 
-        // Compute pore volumes.
-        porevol_.resize(num_cells);
-        for (int i = 0; i < num_cells; ++i) {
-            porevol_[i] = porosity[i]*grid.cellVolume(i);
+        if (!same_grid || !std::equal(porosity, porosity + num_cells, porosity_.begin())) {
+            porosity_.assign(porosity, porosity + num_cells);
+            // Compute pore volumes.
+            porevol_.resize(num_cells);
+            for (int i = 0; i < num_cells; ++i) {
+                porevol_[i] = porosity[i]*cell_volume_[i];
+            }
         }
 
         // Set gravity.
@@ -132,6 +161,28 @@ public:
 
 
 
+    /// @brief
+    ///     Update the well types, controls and targets, keeping the
+    ///     well topology and completion data set up by init().
+    /// @tparam Wells This must conform to the SimpleWells concept.
+    /// @param w The well object, with the same wells as given to init().
+    template <class Wells>
+    void updateWellControls(const Wells& w)
+    {
+        const int num_wells = w.numWells();
+        if (num_wells != wells_.number_of_wells) {
+            throw std::runtime_error("Error in TpfaCompressibleAssembler::updateWellControls(): "
+                                     "The number of wells changed, call init() instead.");
+        }
+        for (int i = 0; i < num_wells; ++i) {
+            wctrl_type_storage_[i] = (w.type(i) == Wells::Injector) ? INJECTOR : PRODUCER;
+            wctrl_ctrl_storage_[i] = (w.control(i) == Wells::Rate) ? RATE : BHP;
+            wctrl_target_storage_[i] = w.target(i);
+        }
+    }
+
+
+
     /// Boundary condition types.
     enum FlowBCTypes { FBC_UNSET    = BC_NOFLOW      ,
                        FBC_PRESSURE = BC_PRESSURE    ,
@@ -405,6 +456,12 @@ private:
     GridAdapter grid_;
     // Number of faces per cell.
     std::vector<int> ncf_;
+    // The grid of the cached grid structures, and its cell volumes.
+    const void* cached_grid_;
+    std::vector<double> cell_volume_;
+    // Input of the cached transmissibilities and pore volumes.
+    std::vector<double> perm_;
+    std::vector<double> porosity_;
     // Transmissibility storage.
     std::vector<double> htrans_;
     std::vector<double> trans_;
@@ -420,8 +477,10 @@ private:
     // Boundary conditions.
     FlowBoundaryConditions *bc_;
 
-    // Well data
+    // Well data. wells_changed_ is set when the well topology
+    // changes, and data_ must be rebuilt.
     well_t wells_;
+    bool wells_changed_;
     std::vector<int> well_connpos_storage_;
     std::vector<int> well_cells_storage_;
     well_control_t wctrl_;
@@ -445,29 +504,38 @@ private:
     void initWells(const Wells& w)
     {
         int num_wells = w.numWells();
-        if (num_wells == 0) {
-            wells_.number_of_wells = 0;
-            return;
-        }
-        wctrl_type_storage_.resize(num_wells);
-        wctrl_ctrl_storage_.resize(num_wells);
-        wctrl_target_storage_.resize(num_wells);
+        std::vector<int> connpos;
+        std::vector<int> cells;
+        std::vector<double> prodind;
+        connpos.reserve(num_wells + 1);
         for (int i = 0; i < num_wells; ++i) {
-            wctrl_type_storage_[i] = (w.type(i) == Wells::Injector) ? INJECTOR : PRODUCER;
-            wctrl_ctrl_storage_[i] = (w.control(i) == Wells::Rate) ? RATE : BHP;
-            wctrl_target_storage_[i] = w.target(i);
             int num_perf = w.numPerforations(i);
-            well_connpos_storage_.push_back(well_cells_storage_.size());
+            connpos.push_back(cells.size());
             for (int j = 0; j < num_perf; ++j) {
-                well_cells_storage_.push_back(w.wellCell(i, j));
-                well_prodind_storage_.push_back(w.wellIndex(i, j));
+                cells.push_back(w.wellCell(i, j));
+                prodind.push_back(w.wellIndex(i, j));
             }
         }
-        well_connpos_storage_.push_back(well_cells_storage_.size());
-        int tot_num_perf = well_prodind_storage_.size();
-        well_gpot_storage_.resize(tot_num_perf*3);
-        well_A_storage_.resize(3*3*tot_num_perf);
-        well_phasemob_storage_.resize(3*tot_num_perf);
+        connpos.push_back(cells.size());
+        if (num_wells == 0) {
+            wells_changed_ = wells_changed_ || wells_.number_of_wells != 0;
+            wells_.number_of_wells = 0;
+            return;
+        }
+        if (num_wells != wells_.number_of_wells
+            || connpos != well_connpos_storage_ || cells != well_cells_storage_) {
+            well_connpos_storage_.swap(connpos);
+            well_cells_storage_.swap(cells);
+            wctrl_type_storage_.resize(num_wells);
+            wctrl_ctrl_storage_.resize(num_wells);
+            wctrl_target_storage_.resize(num_wells);
+            int tot_num_perf = well_cells_storage_.size();
+            well_gpot_storage_.resize(tot_num_perf*3);
+            well_A_storage_.resize(3*3*tot_num_perf);
+            well_phasemob_storage_.resize(3*tot_num_perf);
+            wells_changed_ = true;
+        }
+        well_prodind_storage_.swap(prodind);
         // Setup 'wells_'
         wells_.number_of_wells = num_wells;
         wells_.well_connpos = &well_connpos_storage_[0];
@@ -476,6 +544,7 @@ private:
         wctrl_.type = &wctrl_type_storage_[0];
         wctrl_.ctrl = &wctrl_ctrl_storage_[0];
         wctrl_.target = &wctrl_target_storage_[0];
+        updateWellControls(w);
         // Setup 'wcompl_'
         wcompl_.WI = &well_prodind_storage_[0];
         wcompl_.gpot = &well_gpot_storage_[0];
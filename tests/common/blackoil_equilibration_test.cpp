@@ -0,0 +1,234 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#if defined(HAVE_DYNAMIC_BOOST_TEST)
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+
+#define BOOST_TEST_MODULE BlackoilEquilibrationTest
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+#include <opm/porsol/blackoil/BlackoilInitialization.hpp>
+#include <opm/porsol/blackoil/fluid/BlackoilDefs.hpp>
+
+#include <cmath>
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+    // A column of cells at the given depths.
+    struct ColumnGrid
+    {
+        typedef Dune::FieldVector<double, 3> Vector;
+        std::vector<double> depth;
+        int numCells() const { return depth.size(); }
+        Vector cellCentroid(const int cell) const
+        {
+            Vector c(0.0);
+            c[2] = depth[cell];
+            return c;
+        }
+    };
+
+    // Every component is its own phase, with reservoir volume per
+    // surface volume exp(-c (p - p_ref)).
+    struct ExpFluid : public BlackoilDefs
+    {
+        struct FluidState
+        {
+            double total_phase_volume_density_;
+        };
+        CompVec rho;
+        CompVec c;
+        double p_ref;
+
+        double volumeFactor(const int comp, const double p) const
+        {
+            return std::exp(-c[comp]*(p - p_ref));
+        }
+        FluidState computeState(const PhaseVec& p, const CompVec& z) const
+        {
+            FluidState state;
+            state.total_phase_volume_density_ = 0.0;
+            for (int comp = 0; comp < numComponents; ++comp) {
+                state.total_phase_volume_density_ += z[comp]*volumeFactor(comp, p[0]);
+            }
+            return state;
+        }
+        CompVec surfaceDensities() const
+        {
+            return rho;
+        }
+    };
+
+    struct State
+    {
+        std::vector<BlackoilDefs::PhaseVec> cell_pressure_;
+        std::vector<BlackoilDefs::CompVec> cell_z_;
+    };
+
+    struct Simulator
+    {
+        typedef ColumnGrid Grid;
+        typedef ExpFluid Fluid;
+        typedef ::State State;
+    };
+
+    const double g = 9.80665;
+
+    ExpFluid fluid()
+    {
+        ExpFluid f;
+        f.rho[BlackoilDefs::Water] = 1000.0;
+        f.rho[BlackoilDefs::Oil] = 800.0;
+        f.rho[BlackoilDefs::Gas] = 1.0;
+        f.c[BlackoilDefs::Water] = 4e-10;
+        f.c[BlackoilDefs::Oil] = 1e-9;
+        f.c[BlackoilDefs::Gas] = 5e-8;
+        f.p_ref = 1e7;
+        return f;
+    }
+
+    // Exact solution of dp/dd = rho/B(p) g for one component,
+    // through (d0, p0).
+    double exactPressure(const ExpFluid& f, const int comp, const double d0, const double p0, const double d)
+    {
+        const double c = f.c[comp];
+        return f.p_ref - std::log(std::exp(-c*(p0 - f.p_ref)) - c*f.rho[comp]*g*(d - d0))/c;
+    }
+
+    ColumnGrid column(const double top, const double bottom, const int num)
+    {
+        ColumnGrid grid;
+        for (int i = 0; i < num; ++i) {
+            grid.depth.push_back(top + (bottom - top)*(i + 0.5)/num);
+        }
+        return grid;
+    }
+
+    Dune::FieldVector<double, 3> gravity()
+    {
+        Dune::FieldVector<double, 3> gvec(0.0);
+        gvec[2] = g;
+        return gvec;
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(oil_column_matches_exact_profile)
+{
+    const ExpFluid f = fluid();
+    const ColumnGrid grid = column(1000.0, 3000.0, 400);
+    parameter::ParameterGroup param;
+    param.insertParameter("datum_depth", "1500");
+    param.insertParameter("datum_pressure", "250");
+
+    State state;
+    EquilibrationInitialization<Simulator> init;
+    init.init(param, grid, f, gravity(), state);
+
+    BOOST_REQUIRE_EQUAL(int(state.cell_pressure_.size()), grid.numCells());
+    const double p0 = 250e5;
+    for (int cell = 0; cell < grid.numCells(); ++cell) {
+        const double p = exactPressure(f, BlackoilDefs::Oil, 1500.0, p0, grid.depth[cell]);
+        BOOST_CHECK_CLOSE(state.cell_pressure_[cell][0], p, 1e-6);
+        // The pore volume is filled with oil.
+        BOOST_CHECK_CLOSE(state.cell_z_[cell][BlackoilDefs::Oil]*f.volumeFactor(BlackoilDefs::Oil, p), 1.0, 1e-6);
+        BOOST_CHECK_EQUAL(state.cell_z_[cell][BlackoilDefs::Water], 0.0);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(contacts_split_the_profile)
+{
+    ExpFluid f = fluid();
+    f.c = 0.0;
+    const ColumnGrid grid = column(0.0, 300.0, 300);
+    parameter::ParameterGroup param;
+    param.insertParameter("datum_depth", "150");
+    param.insertParameter("datum_pressure", "200");
+    param.insertParameter("go_contact_depth", "100");
+    param.insertParameter("wo_contact_depth", "200");
+    param.insertParameter("connate_water_saturation", "0.2");
+    param.insertParameter("residual_oil_saturation", "0.25");
+
+    State state;
+    EquilibrationInitialization<Simulator> init;
+    init.init(param, grid, f, gravity(), state);
+
+    // Incompressible phases, the pressure is piecewise linear.
+    const double p0 = 200e5;
+    const double rho_gas = 0.8*f.rho[BlackoilDefs::Gas] + 0.2*f.rho[BlackoilDefs::Water];
+    const double rho_oil = 0.8*f.rho[BlackoilDefs::Oil] + 0.2*f.rho[BlackoilDefs::Water];
+    const double rho_water = 0.75*f.rho[BlackoilDefs::Water] + 0.25*f.rho[BlackoilDefs::Oil];
+    const double p_goc = p0 - rho_oil*g*50.0;
+    const double p_woc = p0 + rho_oil*g*50.0;
+    for (int cell = 0; cell < grid.numCells(); ++cell) {
+        const double d = grid.depth[cell];
+        const BlackoilDefs::CompVec& z = state.cell_z_[cell];
+        double p;
+        if (d < 100.0) {
+            p = p_goc + rho_gas*g*(d - 100.0);
+            BOOST_CHECK_CLOSE(z[BlackoilDefs::Gas], 0.8, 1e-10);
+            BOOST_CHECK_EQUAL(z[BlackoilDefs::Oil], 0.0);
+        } else if (d < 200.0) {
+            p = p0 + rho_oil*g*(d - 150.0);
+            BOOST_CHECK_CLOSE(z[BlackoilDefs::Oil], 0.8, 1e-10);
+            BOOST_CHECK_EQUAL(z[BlackoilDefs::Gas], 0.0);
+        } else {
+            p = p_woc + rho_water*g*(d - 200.0);
+            BOOST_CHECK_CLOSE(z[BlackoilDefs::Water], 0.75, 1e-10);
+            BOOST_CHECK_CLOSE(z[BlackoilDefs::Oil], 0.25, 1e-10);
+        }
+        BOOST_CHECK_CLOSE(state.cell_pressure_[cell][0], p, 1e-10);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(regions_are_equilibrated_separately)
+{
+    const ExpFluid f = fluid();
+    const ColumnGrid grid = column(1000.0, 2000.0, 100);
+    std::vector<int> region(grid.numCells());
+    for (int cell = 0; cell < grid.numCells(); ++cell) {
+        region[cell] = cell % 2;
+    }
+    parameter::ParameterGroup param;
+    param.insertParameter("datum_depth", "1000");
+    param.insertParameter("datum_pressure", "150");
+    param.insertParameter("datum_pressure_2", "180");
+
+    State state;
+    EquilibrationInitialization<Simulator> init;
+    init.setRegions(region);
+    init.init(param, grid, f, gravity(), state);
+
+    for (int cell = 0; cell < grid.numCells(); ++cell) {
+        const double p0 = region[cell] == 0 ? 150e5 : 180e5;
+        const double p = exactPressure(f, BlackoilDefs::Oil, 1000.0, p0, grid.depth[cell]);
+        BOOST_CHECK_CLOSE(state.cell_pressure_[cell][0], p, 1e-6);
+    }
+}
@@ -0,0 +1,136 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#if defined(HAVE_DYNAMIC_BOOST_TEST)
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+
+#define BOOST_TEST_MODULE BlackoilEquilibriumTest
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+#include <opm/porsol/blackoil/BlackoilFluid.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+    double uniform(const double lo, const double hi)
+    {
+        return lo + (hi - lo)*double(std::rand())/RAND_MAX;
+    }
+
+    // PVT values in the ranges of a live oil, wet gas case. The number
+    // of cells is not a multiple of the block size. The states refer
+    // to p and z.
+    void randomStates(std::vector<BlackoilDefs::PhaseVec>& p,
+                      std::vector<BlackoilDefs::CompVec>& z,
+                      AllFluidStates& states)
+    {
+        const int num = 3*BlackoilFluid::EquilibriumBlockSize + 17;
+        std::srand(1234);
+        p.assign(num, BlackoilDefs::PhaseVec(uniform(1e7, 3e7)));
+        z.resize(num);
+        states.setInput(p, z);
+        states.resize(num);
+        for (int i = 0; i < num; ++i) {
+            BlackoilDefs::PhaseVec& B = states.formation_volume_factor[i];
+            BlackoilDefs::PhaseVec& dB = states.formation_volume_factor_deriv[i];
+            BlackoilDefs::PhaseVec& R = states.solution_factor[i];
+            BlackoilDefs::PhaseVec& dR = states.solution_factor_deriv[i];
+            BlackoilDefs::CompVec& zi = z[i];
+            B[BlackoilDefs::Aqua] = uniform(0.98, 1.02);
+            B[BlackoilDefs::Liquid] = uniform(1.1, 1.6);
+            B[BlackoilDefs::Vapour] = uniform(0.003, 0.02);
+            dB[BlackoilDefs::Aqua] = -uniform(1e-10, 5e-10);
+            dB[BlackoilDefs::Liquid] = -uniform(1e-9, 1e-8);
+            dB[BlackoilDefs::Vapour] = -uniform(1e-10, 1e-9);
+            R[BlackoilDefs::Aqua] = 0.0;
+            R[BlackoilDefs::Liquid] = uniform(50.0, 200.0);
+            R[BlackoilDefs::Vapour] = uniform(0.0, 1e-4);
+            dR[BlackoilDefs::Aqua] = 0.0;
+            dR[BlackoilDefs::Liquid] = uniform(1e-7, 1e-6);
+            dR[BlackoilDefs::Vapour] = uniform(0.0, 1e-11);
+            zi[BlackoilDefs::Water] = uniform(0.0, 0.5);
+            zi[BlackoilDefs::Oil] = uniform(0.1, 0.6);
+            zi[BlackoilDefs::Gas] = zi[BlackoilDefs::Oil]*R[BlackoilDefs::Liquid] + uniform(0.0, 50.0);
+        }
+    }
+
+    void checkClose(const FieldArray<double>& a, const FieldArray<double>& b)
+    {
+        BOOST_REQUIRE_EQUAL(a.size(), b.size());
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            BOOST_CHECK_CLOSE(a[i], b[i], 1e-8);
+        }
+    }
+
+    template <class Vec>
+    void checkClose(const FieldArray<Vec>& a, const FieldArray<Vec>& b)
+    {
+        BOOST_REQUIRE_EQUAL(a.size(), b.size());
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            for (int j = 0; j < int(Vec::dimension); ++j) {
+                // Some entries are exactly zero, compare with an absolute
+                // tolerance relative to the largest entry.
+                const double scale = std::max(a[i].infinity_norm(), b[i].infinity_norm());
+                BOOST_CHECK_SMALL(a[i][j] - b[i][j], 1e-10*scale);
+            }
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(batch_equilibrium_matches_per_cell)
+{
+    std::vector<BlackoilDefs::PhaseVec> p;
+    std::vector<BlackoilDefs::CompVec> z;
+    AllFluidStates per_cell;
+    randomStates(p, z, per_cell);
+    AllFluidStates batch = per_cell;
+
+    BlackoilFluid fluid;
+    fluid.computePvtDepending(per_cell);
+    fluid.setBatchEquilibrium(true);
+    fluid.computePvtDepending(batch);
+
+    const int num = per_cell.state_matrix.size();
+    BOOST_REQUIRE_EQUAL(int(batch.state_matrix.size()), num);
+    for (int i = 0; i < num; ++i) {
+        for (int phase = 0; phase < BlackoilDefs::numPhases; ++phase) {
+            for (int comp = 0; comp < BlackoilDefs::numComponents; ++comp) {
+                BOOST_CHECK_EQUAL(batch.state_matrix[i][phase][comp], per_cell.state_matrix[i][phase][comp]);
+            }
+        }
+    }
+    checkClose(batch.phase_volume_density, per_cell.phase_volume_density);
+    checkClose(batch.total_phase_volume_density, per_cell.total_phase_volume_density);
+    checkClose(batch.saturation, per_cell.saturation);
+    checkClose(batch.phase_compressibility, per_cell.phase_compressibility);
+    checkClose(batch.total_compressibility, per_cell.total_compressibility);
+    checkClose(batch.experimental_term, per_cell.experimental_term);
+}
@@ -0,0 +1,186 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#if defined(HAVE_DYNAMIC_BOOST_TEST)
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+
+#define BOOST_TEST_MODULE BlackoilTransportTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/porsol/blackoil/BlackoilFluid.hpp>
+#include <opm/porsol/blackoil/BlackoilWells.hpp>
+#include <opm/porsol/blackoil/ComponentTransport.hpp>
+#include <opm/porsol/common/Metrics.hpp>
+#include <opm/porsol/common/Rock.hpp>
+
+#include <dune/grid/CpGrid.hpp>
+
+#include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <opm/core/utility/Units.hpp>
+#include <opm/parser/eclipse/Parser/Parser.hpp>
+#include <opm/parser/eclipse/Parser/ParseContext.hpp>
+#include <opm/parser/eclipse/Deck/Deck.hpp>
+
+#include <array>
+#include <string>
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+    typedef Dune::CpGrid Grid;
+    typedef Rock<Grid::dimension> TestRock;
+
+    // Dead oil, dry gas and water, with straight line relative
+    // permeabilities and no capillary pressure.
+    const char* deck_string =
+        "RUNSPEC\n"
+        "DIMENS\n 5 1 1 /\n"
+        "OIL\nWATER\nGAS\nMETRIC\n"
+        "TABDIMS\n/\n"
+        "GRID\n"
+        "DX\n 5*10 /\nDY\n 5*10 /\nDZ\n 5*10 /\nTOPS\n 5*1000 /\nPORO\n 5*0.2 /\n"
+        "PROPS\n"
+        "SWOF\n 0.1 0.0 1.0 0.0\n 1.0 1.0 0.0 0.0 /\n"
+        "SGOF\n 0.0 0.0 1.0 0.0\n 0.9 1.0 0.0 0.0 /\n"
+        "PVDO\n 100 1.02 1.0\n 300 1.00 1.0 /\n"
+        "PVDG\n 100 0.010 0.02\n 300 0.004 0.02 /\n"
+        "PVTW\n 200 1.0 4e-5 0.5 0 /\n"
+        "DENSITY\n 800 1000 1 /\n";
+
+    // The perforations and report of BlackoilWells, set directly.
+    struct TestWells
+    {
+        typedef BlackoilWells::Perforation Perforation;
+        typedef BlackoilWells::WellReport WellReport;
+        std::vector<Perforation> perfs;
+        mutable WellReport report;
+        const std::vector<Perforation>& perforations() const { return perfs; }
+        WellReport& wellReport() const { return report; }
+    };
+
+    typedef ExplicitCompositionalTransport<Grid, TestRock, BlackoilFluid, TestWells> Transport;
+
+    const double q = 1e-4;      // Reservoir volume rate (m^3/s).
+    const double p = 200e5;     // Uniform pressure (Pa).
+
+    // Water injected in the first cell of a row of five and produced
+    // from the last, through an oil filled reservoir. Runs a
+    // transport step of about ten stable steps and returns the
+    // report.
+    BlackoilWells::WellReport runTransport(const int multirate_levels)
+    {
+        ParseContext parseContext;
+        ParserPtr parser(new Parser());
+        DeckConstPtr deck = parser->parseString(deck_string, parseContext);
+        BlackoilFluid fluid;
+        fluid.init(deck);
+
+        Grid grid;
+        std::array<int, 3> dims = {{ 5, 1, 1 }};
+        std::array<double, 3> cellsz = {{ 10.0, 10.0, 10.0 }};
+        grid.createCartesian(dims, cellsz);
+        TestRock rock;
+        rock.init(grid.numCells(), 0.2, unit::convert::from(100.0, prefix::milli*unit::darcy));
+
+        const int num_cells = grid.numCells();
+        const int num_faces = grid.numFaces();
+        TestWells wells;
+        TestWells::Perforation perf;
+        perf.cell = 0;
+        perf.flux = q;
+        perf.pressure = p;
+        perf.injection_mixture = BlackoilDefs::CompVec(0.0);
+        perf.injection_mixture[BlackoilDefs::Water] = 1.0;
+        wells.perfs.push_back(perf);
+        perf.cell = num_cells - 1;
+        perf.flux = -q;
+        wells.perfs.push_back(perf);
+
+        std::vector<double> face_flux(num_faces, 0.0);
+        for (int face = 0; face < num_faces; ++face) {
+            const int c0 = grid.faceCell(face, 0);
+            const int c1 = grid.faceCell(face, 1);
+            if (c0 >= 0 && c1 >= 0) {
+                face_flux[face] = c1 > c0 ? q : -q;
+            }
+        }
+        const std::vector<double> face_trans(num_faces, 1.0);
+        const Grid::Vector gravity(0.0);
+
+        parameter::ParameterGroup param;
+        param.insertParameter("multirate_levels", std::to_string(multirate_levels));
+        Transport transport;
+        transport.init(param);
+        transport.setup(grid, rock, fluid, wells, face_trans, gravity);
+
+        BlackoilDefs::CompVec z(0.0);
+        z[BlackoilDefs::Water] = 0.2;
+        z[BlackoilDefs::Oil] = 0.8/1.01;
+        std::vector<BlackoilDefs::CompVec> cell_z(num_cells, z);
+        const BlackoilDefs::PhaseVec pv(p);
+        const std::vector<BlackoilDefs::PhaseVec> cell_pressure(num_cells, pv);
+        const std::vector<BlackoilDefs::PhaseVec> face_pressure(num_faces, pv);
+        // A pore volume is 200 m^3, so a stable step is of the order
+        // of 1e6 seconds.
+        const double dt = 1e7;
+        MetricsRegistry metrics;
+        ScopedMetricsRegistry scope(metrics);
+        const double used = transport.transport(pv, z, face_flux, cell_pressure, face_pressure,
+                                                dt, 1e100, cell_z);
+        BOOST_CHECK_EQUAL(used, dt);
+        BOOST_CHECK(metrics.counter("transport.substeps").value() > 1);
+        return wells.wellReport();
+    }
+
+    void checkReport(const BlackoilWells::WellReport& report)
+    {
+        BOOST_REQUIRE_EQUAL(report.cellId.size(), 2u);
+        BOOST_REQUIRE_EQUAL(report.massRate.size(), report.cellId.size());
+        BOOST_CHECK_EQUAL(report.perfPressure.size(), report.cellId.size());
+        BOOST_CHECK_EQUAL(report.cellPressure.size(), report.cellId.size());
+        BOOST_CHECK_EQUAL(report.cellId[0], 0);
+        BOOST_CHECK_EQUAL(report.cellId[1], 4);
+        // Water only is injected, at q/Bw.
+        BOOST_CHECK(report.massRate[0][BlackoilDefs::Water] > 0.5*q);
+        BOOST_CHECK_EQUAL(report.massRate[0][BlackoilDefs::Oil], 0.0);
+        for (int comp = 0; comp < BlackoilDefs::numComponents; ++comp) {
+            BOOST_CHECK(report.massRate[1][comp] <= 0.0);
+        }
+        BOOST_CHECK(report.massRate[1][BlackoilDefs::Oil] < 0.0);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(report_is_aligned_after_several_steps)
+{
+    checkReport(runTransport(1));
+}
+
+
+BOOST_AUTO_TEST_CASE(multirate_report_is_aligned_after_several_macro_steps)
+{
+    checkReport(runTransport(3));
+}
@@ -0,0 +1,130 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#if defined(HAVE_DYNAMIC_BOOST_TEST)
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+
+#define BOOST_TEST_MODULE MetricsTest
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+#include <opm/porsol/common/Metrics.hpp>
+
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Opm;
+
+
+BOOST_AUTO_TEST_CASE(concurrent_updates_are_not_lost)
+{
+    MetricsRegistry metrics;
+    const int num_threads = 4;
+    const int num_adds = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.push_back(std::thread([&metrics, num_adds]() {
+                    for (int i = 0; i < num_adds; ++i) {
+                        metrics.counter("adds").add();
+                        metrics.histogram("values").add(i % 8);
+                        metrics.timer("work").add(1e-3);
+                    }
+                }));
+    }
+    for (int t = 0; t < num_threads; ++t) {
+        threads[t].join();
+    }
+    BOOST_CHECK_EQUAL(metrics.counter("adds").value(), num_threads*num_adds);
+    const MetricsRegistry::Histogram& h = metrics.histogram("values");
+    BOOST_CHECK_EQUAL(h.count(), num_threads*num_adds);
+    BOOST_CHECK_CLOSE(h.sum(), num_threads*num_adds*3.5, 1e-12);
+    BOOST_CHECK_EQUAL(h.min(), 0.0);
+    BOOST_CHECK_EQUAL(h.max(), 7.0);
+    BOOST_CHECK_EQUAL(metrics.timer("work").count(), num_threads*num_adds);
+    BOOST_CHECK_CLOSE(metrics.timer("work").seconds(), num_threads*num_adds*1e-3, 1e-6);
+}
+
+
+BOOST_AUTO_TEST_CASE(histogram_buckets_are_powers_of_two)
+{
+    typedef MetricsRegistry::Histogram H;
+    BOOST_CHECK_EQUAL(H::bucket(0.0), 0);
+    BOOST_CHECK_EQUAL(H::bucket(-1.0), 0);
+    BOOST_CHECK_EQUAL(H::bucket(1.0), H::bucket(1.5));
+    BOOST_CHECK_EQUAL(H::bucket(2.0), H::bucket(1.0) + 1);
+    BOOST_CHECK_EQUAL(H::bucket(1e300), int(H::NumBuckets) - 1);
+    for (double x = 1e-6; x < 1e6; x *= 3.0) {
+        const int k = H::bucket(x);
+        BOOST_CHECK(x < H::bucketLimit(k));
+        BOOST_CHECK(x >= 0.5*H::bucketLimit(k));
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(scoped_registry_is_current)
+{
+    MetricsRegistry metrics;
+    BOOST_CHECK(&MetricsRegistry::current() == &MetricsRegistry::global());
+    {
+        ScopedMetricsRegistry scope(metrics);
+        BOOST_CHECK(&MetricsRegistry::current() == &metrics);
+        ScopedTimer timer("scope");
+    }
+    BOOST_CHECK(&MetricsRegistry::current() == &MetricsRegistry::global());
+    BOOST_CHECK_EQUAL(metrics.timer("scope").count(), 1);
+}
+
+
+BOOST_AUTO_TEST_CASE(json_report)
+{
+    MetricsRegistry metrics;
+    metrics.counter("steps").add(3);
+    metrics.timer("solve").add(0.5);
+    metrics.histogram("iterations").add(4.0);
+    metrics.histogram("empty");
+    std::map<std::string, std::string> info;
+    info["case"] = "a \"quoted\"\tname";
+    std::ostringstream os;
+    metrics.writeJson(os, info);
+    const std::string expected =
+        "{\n"
+        "  \"info\": {\n"
+        "    \"case\": \"a \\\"quoted\\\"\\u0009name\"\n"
+        "  },\n"
+        "  \"timers\": {\n"
+        "    \"solve\": {\"count\": 1, \"seconds\": 0.5}\n"
+        "  },\n"
+        "  \"counters\": {\n"
+        "    \"steps\": 3\n"
+        "  },\n"
+        "  \"histograms\": {\n"
+        "    \"empty\": {\"count\": 0, \"sum\": 0, \"buckets\": []},\n"
+        "    \"iterations\": {\"count\": 1, \"sum\": 4, \"min\": 4, \"max\": 4, \"buckets\": [{\"lt\": 8, \"count\": 1}]}\n"
+        "  }\n"
+        "}\n";
+    BOOST_CHECK_EQUAL(os.str(), expected);
+}
@@ -0,0 +1,183 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#if defined(HAVE_DYNAMIC_BOOST_TEST)
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+
+#define BOOST_TEST_MODULE NonlinearTraceTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/porsol/common/NonlinearTrace.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+    NonlinearTrace::Record iteration(const int iter)
+    {
+        NonlinearTrace::Record rec;
+        rec.iteration = iter;
+        rec.residual = 1.0/(iter + 1);
+        return rec;
+    }
+
+    template <typename T>
+    T read(std::istream& is)
+    {
+        T value;
+        is.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+
+    // A flushed block: header, then the solve and iteration numbers of
+    // its records.
+    struct Block
+    {
+        std::int32_t solve;
+        std::int32_t status;
+        std::vector<std::pair<int, int> > records;
+        std::int32_t num_residuals;
+    };
+
+    std::vector<Block> readBlocks(const std::string& filename)
+    {
+        std::ifstream is(filename.c_str(), std::ios::binary);
+        std::vector<Block> blocks;
+        while (is.peek() != EOF) {
+            BOOST_REQUIRE_EQUAL(read<std::uint32_t>(is), std::uint32_t(NonlinearTrace::Magic));
+            BOOST_REQUIRE_EQUAL(read<std::uint32_t>(is), std::uint32_t(NonlinearTrace::Version));
+            Block b;
+            b.solve = read<std::int32_t>(is);
+            b.status = read<std::int32_t>(is);
+            const int num = read<std::int32_t>(is);
+            for (int i = 0; i < num; ++i) {
+                const int solve = read<std::int32_t>(is);
+                const int iter = read<std::int32_t>(is);
+                read<std::int32_t>(is);
+                double values[7];
+                is.read(reinterpret_cast<char*>(values), sizeof(values));
+                b.records.push_back(std::make_pair(solve, iter));
+            }
+            b.num_residuals = read<std::int32_t>(is);
+            for (int v = 0; v < b.num_residuals; ++v) {
+                read<std::int32_t>(is);
+                const std::int64_t size = read<std::int64_t>(is);
+                is.ignore(size*sizeof(double));
+            }
+            BOOST_REQUIRE(is);
+            blocks.push_back(b);
+        }
+        return blocks;
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(ring_keeps_the_newest_records)
+{
+    NonlinearTrace trace;
+    trace.init(4, false, "");
+    BOOST_CHECK(trace.enabled());
+    trace.beginSolve();
+    for (int iter = 0; iter < 3; ++iter) {
+        trace.record(iteration(iter));
+    }
+    BOOST_CHECK_EQUAL(trace.size(), 3);
+    BOOST_CHECK_EQUAL(trace[0].iteration, 0);
+    for (int iter = 3; iter < 10; ++iter) {
+        trace.record(iteration(iter));
+    }
+    // Wrapped around: the last four, oldest first.
+    BOOST_REQUIRE_EQUAL(trace.size(), 4);
+    for (int i = 0; i < 4; ++i) {
+        BOOST_CHECK_EQUAL(trace[i].iteration, 6 + i);
+        BOOST_CHECK_EQUAL(trace[i].solve, 0);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(disabled_trace_records_nothing)
+{
+    NonlinearTrace trace;
+    trace.init(0, false, "");
+    BOOST_CHECK(!trace.enabled());
+    trace.beginSolve();
+    trace.record(iteration(0));
+    BOOST_CHECK_EQUAL(trace.size(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(flush_writes_the_current_solve)
+{
+    const std::string filename = "nonlineartrace_test.bin";
+    NonlinearTrace trace;
+    trace.init(5, true, filename);
+
+    // Solve 0 is kept in full.
+    trace.beginSolve();
+    for (int iter = 0; iter < 3; ++iter) {
+        trace.record(iteration(iter));
+        trace.residual(iter, std::vector<double>(2, 1.0));
+    }
+    trace.flush(0);
+
+    // Solve 1 has more iterations than the ring holds, only the last
+    // five are written.
+    trace.beginSolve();
+    for (int iter = 0; iter < 7; ++iter) {
+        trace.record(iteration(iter));
+    }
+    trace.flush(2);
+
+    // Solve 2 is not flushed.
+    trace.beginSolve();
+    trace.record(iteration(0));
+
+    const std::vector<Block> blocks = readBlocks(filename);
+    std::remove(filename.c_str());
+    BOOST_REQUIRE_EQUAL(blocks.size(), 2u);
+
+    BOOST_CHECK_EQUAL(blocks[0].solve, 0);
+    BOOST_CHECK_EQUAL(blocks[0].status, 0);
+    BOOST_REQUIRE_EQUAL(blocks[0].records.size(), 3u);
+    for (int i = 0; i < 3; ++i) {
+        BOOST_CHECK_EQUAL(blocks[0].records[i].first, 0);
+        BOOST_CHECK_EQUAL(blocks[0].records[i].second, i);
+    }
+    BOOST_CHECK_EQUAL(blocks[0].num_residuals, 3);
+
+    BOOST_CHECK_EQUAL(blocks[1].solve, 1);
+    BOOST_CHECK_EQUAL(blocks[1].status, 2);
+    BOOST_REQUIRE_EQUAL(blocks[1].records.size(), 5u);
+    for (int i = 0; i < 5; ++i) {
+        BOOST_CHECK_EQUAL(blocks[1].records[i].first, 1);
+        BOOST_CHECK_EQUAL(blocks[1].records[i].second, 2 + i);
+    }
+    BOOST_CHECK_EQUAL(blocks[1].num_residuals, 0);
+}
@@ -0,0 +1,84 @@
+/*
+  Copyright 2011 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "config.h"
+
+#if defined(HAVE_DYNAMIC_BOOST_TEST)
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+#define BOOST_TEST_MODULE UniformTableBilinearTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/porsol/common/UniformTableBilinear.hpp>
+
+#include <vector>
+
+using namespace Opm::utils;
+
+namespace
+{
+    // Bilinear, hence reproduced exactly by the table.
+    struct Plane
+    {
+        double operator()(const double x, const double y) const
+        {
+            return 1.0 + 2.0*x - 3.0*y + 0.5*x*y;
+        }
+    };
+}
+
+BOOST_AUTO_TEST_CASE(exact_for_bilinear)
+{
+    UniformTableBilinear<double> t = UniformTableBilinear<double>::sample(0.0, 2.0, 5, -1.0, 1.0, 3, Plane());
+    Plane f;
+    const double tol = 1e-12;
+    for (double x = 0.05; x < 2.0; x += 0.3) {
+        for (double y = -0.95; y < 1.0; y += 0.25) {
+            double value, dfdx, dfdy;
+            t.evaluate(x, y, value, dfdx, dfdy);
+            BOOST_CHECK_CLOSE(value, f(x, y), tol);
+            BOOST_CHECK_CLOSE(dfdx, 2.0 + 0.5*y, tol);
+            BOOST_CHECK_CLOSE(dfdy, -3.0 + 0.5*x, tol);
+            BOOST_CHECK_CLOSE(t.derivativeX(x, y), dfdx, tol);
+            BOOST_CHECK_CLOSE(t.derivativeY(x, y), dfdy, tol);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(closed_range)
+{
+    UniformTableBilinear<double> t = UniformTableBilinear<double>::sample(0.0, 2.0, 5, -1.0, 1.0, 3, Plane());
+    Plane f;
+    const double tol = 1e-12;
+    BOOST_CHECK_CLOSE(t(-1.0, 0.5), f(0.0, 0.5), tol);
+    BOOST_CHECK_CLOSE(t(3.0, 0.5), f(2.0, 0.5), tol);
+    BOOST_CHECK_CLOSE(t(1.0, -2.0), f(1.0, -1.0), tol);
+    BOOST_CHECK_CLOSE(t(1.0, 2.0), f(1.0, 1.0), tol);
+    BOOST_CHECK_CLOSE(t(2.0, 1.0), f(2.0, 1.0), tol);
+}
+
+BOOST_AUTO_TEST_CASE(bad_input)
+{
+    BOOST_CHECK(UniformTableBilinear<double>().empty());
+    std::vector<double> values(6, 0.0);
+    BOOST_CHECK_THROW(UniformTableBilinear<double>(0.0, 1.0, 2, 0.0, 1.0, 2, values), std::exception);
+    BOOST_CHECK_THROW(UniformTableBilinear<double>(0.0, 1.0, 1, 0.0, 1.0, 6, values), std::exception);
+    BOOST_CHECK_NO_THROW(UniformTableBilinear<double>(0.0, 1.0, 2, 0.0, 1.0, 3, values));
+}